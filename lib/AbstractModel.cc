@@ -32,6 +32,7 @@
 #include "AbstractModel.h"
 #include "Binstream.h"
 #include "ExtendedResidue.h"
+#include "Parallel.h"
 #include "Pdbstream.h"
 #include "Residue.h"
 #include "ResidueType.h"
@@ -43,12 +44,14 @@ namespace mccore
 {
 
   AbstractModel::AbstractModel (const ResidueFactoryMethod *fm)
-    : residueFM (0 == fm ? new ExtendedResidueFM () : fm->clone ())
+    : residueFM (0 == fm ? new ExtendedResidueFM () : fm->clone ()),
+      resIdIndexSize ((size_type) -1)
   { }
 
   
   AbstractModel::AbstractModel (const AbstractModel &right)
-    : residueFM (right.residueFM->clone ())
+    : residueFM (right.residueFM->clone ()),
+      resIdIndexSize ((size_type) -1)
   { }
 
 
@@ -65,10 +68,134 @@ namespace mccore
       {
 	delete residueFM;
 	residueFM = right.residueFM->clone ();
+	_index_invalidate ();
       }
     return *this;
   }
 
+
+  void
+  AbstractModel::_swap (AbstractModel &right)
+  {
+    std::swap (residueFM, right.residueFM);
+    resIdIndex.swap (right.resIdIndex);
+    std::swap (resIdIndexSize, right.resIdIndexSize);
+    resIdErased.swap (right.resIdErased);
+  }
+
+
+  void
+  AbstractModel::_index_insert (const ResId &id, size_type pos)
+  {
+    if (pos + 1 == size () && resIdIndexSize == pos)
+      {
+	// -- every erased position is before the last one
+	resIdIndex.insert (make_pair (id, pos + resIdErased.size ()));
+	resIdIndexSize = size ();
+      }
+    else
+      _index_invalidate ();
+  }
+
+
+  void
+  AbstractModel::_index_erase (size_type pos)
+  {
+    if (resIdIndexSize == size ())
+      {
+	map< ResId, size_type >::iterator it;
+	vector< size_type >::iterator eIt;
+	size_type indexed = pos;
+
+	for (eIt = resIdErased.begin (); resIdErased.end () != eIt && *eIt <= indexed; ++eIt)
+	  ++indexed;
+	it = resIdIndex.find ((*this)[pos].getResId ());
+	if (resIdIndex.end () != it && indexed == it->second)
+	  {
+	    if (resIdIndex.size () != size ())
+	      {
+		// -- a duplicated id may be left, found by a rebuild
+		_index_invalidate ();
+		return;
+	      }
+	    resIdIndex.erase (it);
+	  }
+	resIdErased.insert (eIt, indexed);
+	--resIdIndexSize;
+
+	// -- an erasure costs as much as the recorded ones: the index is
+	//    rewritten when they cost as much as the rewrite
+	if (resIdErased.size () * resIdErased.size () >= size ())
+	  _index_compact ();
+      }
+    else
+      _index_invalidate ();
+  }
+
+
+  void
+  AbstractModel::_index_compact () const
+  {
+    map< ResId, size_type >::iterator it;
+
+    if (! resIdErased.empty ())
+      {
+	for (it = resIdIndex.begin (); resIdIndex.end () != it; ++it)
+	  it->second = _index_position (it->second);
+	resIdErased.clear ();
+      }
+  }
+
+
+  AbstractModel::size_type
+  AbstractModel::_index_position (size_type indexed) const
+  {
+    return indexed - (lower_bound (resIdErased.begin (), resIdErased.end (), indexed)
+		      - resIdErased.begin ());
+  }
+
+
+  void
+  AbstractModel::_index_update () const
+  {
+    if (resIdIndexSize != size ())
+      reindex ();
+  }
+
+
+  AbstractModel::size_type
+  AbstractModel::_index_find (const ResId &id) const
+  {
+    map< ResId, size_type >::const_iterator it;
+
+    _index_update ();
+    if (resIdIndex.end () == (it = resIdIndex.find (id)))
+      return size ();
+    if (id != (*this)[_index_position (it->second)].getResId ())
+      {
+	// -- stale entry, ids were modified in place
+	reindex ();
+	if (resIdIndex.end () == (it = resIdIndex.find (id)))
+	  return size ();
+      }
+    return _index_position (it->second);
+  }
+
+
+  void
+  AbstractModel::reindex () const
+  {
+    const_iterator it;
+    size_type pos;
+
+    // -- the first residue of a duplicated id is kept, as a linear scan would
+    resIdIndex.clear ();
+    resIdErased.clear ();
+    for (it = begin (), pos = 0; end () != it; ++it, ++pos)
+      resIdIndex.insert (make_pair (it->getResId (), pos));
+    resIdIndexSize = size ();
+  }
+
   
   void
   AbstractModel::setResidueFM (const ResidueFactoryMethod *fm)
@@ -81,28 +208,14 @@ namespace mccore
   AbstractModel::iterator
   AbstractModel::find (const ResId &id)
   {
-    iterator it;
-
-    for (it = begin (); it != end (); ++it)
-      if (id == it->getResId ())
-	{
-	  return it;
-	}
-    return it;
+    return iterator (begin () + _index_find (id));
   }
 
 
   AbstractModel::const_iterator
   AbstractModel::find (const ResId &id) const
   {
-    const_iterator it;
-
-    for (it = begin (); it != end (); ++it)
-      if (id == it->getResId ())
-	{
-	  return it;
-	}
-    return it;
+    return const_iterator (begin () + _index_find (id));
   }
   
 
@@ -111,9 +224,8 @@ namespace mccore
   {
     iterator it;
 
-    for (it = begin (); it != end (); ++it)
-      if (id == it->getResId ())
-	return it;
+    if (end () != (it = find (id)))
+      return it;
 
     NoSuchElementException ex ("", __FILE__, __LINE__);
     ex << "residue \"" << id << "\" not found in model";
@@ -128,9 +240,8 @@ namespace mccore
   {
     const_iterator it;
 
-    for (it = begin (); it != end (); ++it)
-      if (id == it->getResId ())
-	return it;
+    if (end () != (it = find (id)))
+      return it;
 
     NoSuchElementException ex ("", __FILE__, __LINE__);
     ex << "residue \"" << id << "\" not found in model";
@@ -173,6 +284,43 @@ namespace mccore
   }
 
   
+  /**
+   * @internal
+   * Places the residues of a range.
+   */
+  class PlaceResidueTask : public ParallelTask
+  {
+    const vector< const Residue* > &residues;
+
+  public:
+
+    PlaceResidueTask (const vector< const Residue* > &r) : residues (r) { }
+
+    virtual void execute (unsigned int chunk, unsigned int first, unsigned int last)
+    {
+      for (; first < last; ++first)
+	residues[first]->place ();
+    }
+  };
+
+
+  void
+  AbstractModel::place (unsigned int nthreads) const
+  {
+    const_iterator it;
+    vector< const Residue* > dirty;
+
+    for (it = begin (); it != end (); ++it)
+      {
+	if (! it->isPlaced ())
+	  dirty.push_back (&*it);
+      }
+
+    PlaceResidueTask task (dirty);
+    Parallel::run (task, dirty.size (), nthreads);
+  }
+
+  
   void
   AbstractModel::removeOptionals ()
   {
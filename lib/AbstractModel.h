@@ -27,9 +27,11 @@
 #define _mccore_AbstractModel_h_
 
 #include <iostream>
+#include <map>
 #include <vector>
 
 #include "Exception.h"
+#include "ResId.h"
 
 using namespace std;
 
@@ -37,7 +39,6 @@ using namespace std;
 
 namespace mccore
 {
-  class ResId;
   class Residue; 
   class ResidueType; 
   class ResidueFactoryMethod;
@@ -68,6 +69,25 @@ namespace mccore
      */
     ResidueFactoryMethod *residueFM;
 
+    /**
+     * Index of the residue positions by residue id.
+     */
+    mutable map< ResId, size_type > resIdIndex;
+
+    /**
+     * The model size when the index was last complete, or -1 when the
+     * index must be rebuilt.
+     */
+    mutable size_type resIdIndexSize;
+
+    /**
+     * The indexed positions of the residues erased since the index was
+     * rebuilt, in increasing order.  The position of an indexed residue is
+     * its indexed one less the erased ones before it, the index is only
+     * rewritten once the erasures pile up.
+     */
+    mutable vector< size_type > resIdErased;
+
   public:
 
     // ITERATORS --------------------------------------------------------------
@@ -172,7 +192,7 @@ namespace mccore
     /**
      * Initializes the object.
      */
-    AbstractModel () { }
+    AbstractModel () : resIdIndexSize ((size_type) -1) { }
 
   protected:
     
@@ -213,6 +233,64 @@ namespace mccore
      */
     AbstractModel& operator= (const AbstractModel &right);
 
+    /**
+     * Exchanges the residue factory method with the right's.
+     * @param right the object with which to exchange content.
+     */
+    void _swap (AbstractModel &right);
+
+    /**
+     * @internal
+     * Records a residue inserted at pos in the residue id index.
+     * @param id the residue id.
+     * @param pos the position of the residue in the model.
+     */
+    void _index_insert (const ResId &id, size_type pos);
+
+    /**
+     * @internal
+     * Removes the residue at pos from the residue id index.  The following
+     * positions are shifted by the erased ones recorded, and rewritten
+     * once in a while.  Must be called before the residue is erased.
+     * @param pos the position of the residue in the model.
+     */
+    void _index_erase (size_type pos);
+
+    /**
+     * @internal
+     * Rewrites the indexed positions with the recorded erasures.
+     */
+    void _index_compact () const;
+
+    /**
+     * @internal
+     * Gets the position in the model of an indexed position.
+     * @param indexed the position recorded in the index.
+     * @return the position in the model.
+     */
+    size_type _index_position (size_type indexed) const;
+
+    /**
+     * @internal
+     * Discards the residue id index, it is rebuilt on the next lookup.
+     */
+    void _index_invalidate () { resIdIndexSize = (size_type) -1; }
+
+    /**
+     * @internal
+     * Rebuilds the residue id index if the model was modified without
+     * maintaining it.
+     */
+    void _index_update () const;
+
+    /**
+     * @internal
+     * Gets the position of a residue through the index.
+     * @param id the residue id.
+     * @return the position or size () if the residue is not in the model.
+     */
+    size_type _index_find (const ResId &id) const;
+
   public:
 
     /**
@@ -302,6 +380,16 @@ namespace mccore
      */
     virtual iterator insert (const Residue &res) = 0;
 
+    /**
+     * Inserts a residue at the end without copying it.  The model takes
+     * ownership of the residue, which should have been created by the
+     * model's residue factory method.  A residue with the same id is
+     * replaced.
+     * @param res the residue to insert.
+     * @return the position where the residue was inserted.
+     */
+    virtual iterator insert (Residue *res) = 0;
+
     /**
      * Inserts the residue range before pos.  It calls the vector<> method.
      * @param pos the iterator where the residue will be placed.
@@ -328,7 +416,9 @@ namespace mccore
     /**
      * Finds a residue given it's residue id.  Returns an iterator
      * pointing to the residue or the end of the container if the residue was
-     * not found.
+     * not found.  The lookup goes through an index maintained by insert,
+     * erase and the filters.  Residue ids modified in place must be
+     * followed by a call to reindex.
      * @param id the residue id.
      * @return a AbstractModel iterator.
      */
@@ -362,6 +452,12 @@ namespace mccore
      * @exception NoSuchElementException
      */
     const_iterator safeFind (const ResId &id) const throw (NoSuchElementException);
+
+    /**
+     * Rebuilds the residue id index.  Needed only when residue ids are
+     * modified through iterators.
+     */
+    void reindex () const;
     
     /**
      * Sorts the model according to the Residue::operator<
@@ -398,6 +494,15 @@ namespace mccore
      * it's already there (default: true)
      */
     void addHLP (bool overwrite = true);
+
+    /**
+     * Computes the global atoms coordinates of every residue that is not
+     * placed yet (see @ref ExtendedResidue), in a single pass over the
+     * model.  Residues are placed independently, so the work can be split
+     * across threads.
+     * @param nthreads the number of threads (0 for one per processor).
+     */
+    void place (unsigned int nthreads = 1) const;
     
     /**
      * Removes the optional atoms within the residues.
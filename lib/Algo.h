@@ -37,6 +37,8 @@
 #include "Residue.h"
 #include "AtomSet.h"
 #include "Exception.h"
+#include "Parallel.h"
+#include "SymmetricalMatrix.h"
 
 using namespace std;
 
@@ -107,87 +109,49 @@ namespace mccore
   {
 
   public:
+
+    /**
+     * Contact engine sweeping the residue bounding boxes sorted on each
+     * axis.
+     */
+    static const unsigned char sweep_engine = 0;
+
+    /**
+     * Contact engine hashing the residue bounding boxes in a uniform grid
+     * of cells sized from the cutoff.
+     */
+    static const unsigned char grid_engine = 1;
     
     /**
      * Using the Axis Aligned Bounding Box for collision detection, this
-     * method calculates the possible contacts between residues.
+     * method calculates the possible contacts between residues.  Both
+     * engines return the same pairs in the same order.  The bounding boxes
+     * and the grid engine are computed by nthreads threads, with the same
+     * result; only the residues' bounding box caches are written.
      * @param coll a vector of pair of iterators on residues that will contain
      * the results.
      * @param begin an iterator on a collection of Residue.
      * @param end an iterator on a collection of Residue.
      * @param cutoff on the minimum distance for a contact (default = 5.0 Angstroms).
+     * @param engine the contact engine, sweep_engine or grid_engine
+     * (default = sweep_engine).
+     * @param nthreads the number of threads (0 for one per processor,
+     * default = 1).
+     * @exception IntLibException if the extraction failed in a thread.
      */
     template< class iter_type >
     static void
-    extractContacts (vector< pair< iter_type, iter_type > > &result, iter_type begin, iter_type end, const RDATypeFilter< iter_type > &filter, float cutoff = 5.0) 
+    extractContacts (vector< pair< iter_type, iter_type > > &result, iter_type begin, iter_type end, const RDATypeFilter< iter_type > &filter, float cutoff = 5.0, unsigned char engine = sweep_engine, unsigned int nthreads = 1) 
     {
-      vector< ResidueRange< iter_type > > X_range;
-      vector< ResidueRange< iter_type > > Y_range;
-      vector< ResidueRange< iter_type > > Z_range;
-      iter_type i;
-      AtomSetNot as_nopse (new AtomSetPSE ());
-      
-      for (i = begin; i != end; ++i) 
-	{
-	  if (filter (i))
-	    {
-	      Residue::const_iterator j;
-	  
-	      float minX, minY, minZ, maxX, maxY, maxZ;
-	      minX = minY = minZ = numeric_limits<float>::max ();
-	      maxX = maxY = maxZ = numeric_limits<float>::min ();
-	  
-	      for (j = i->begin (as_nopse); j != i->end (); ++j)
-		{
-		  minX = min (minX, j->getX ());
-		  minY = min (minY, j->getY ());
-		  minZ = min (minZ, j->getZ ());
-		  maxX = max (maxX, j->getX ());
-		  maxY = max (maxY, j->getY ());
-		  maxZ = max (maxZ, j->getZ ());
-		}
-	
-	      X_range.push_back (ResidueRange< iter_type > (i, minX, maxX));
-	      Y_range.push_back (ResidueRange< iter_type > (i, minY, maxY));
-	      Z_range.push_back (ResidueRange< iter_type > (i, minZ, maxZ));
-	    }
-	}
-      
-      sort (X_range.begin (), X_range.end ());
-      sort (Y_range.begin (), Y_range.end ());
-      sort (Z_range.begin (), Z_range.end ());
-      
-      map< pair< iter_type, iter_type >, int > contact;
-      
-      ExtractContact_OneDim (X_range, contact, cutoff);
-      ExtractContact_OneDim (Y_range, contact, cutoff);
-      
-      typename map< pair< iter_type, iter_type >, int >::iterator cont_i;
-      
-      for (cont_i = contact.begin (); cont_i != contact.end (); ++cont_i)
-	{
-	  typename map< pair< iter_type, iter_type >, int >::iterator tmp = cont_i;
-	  
-	  tmp++;
-	  if (cont_i->second < 2)
-	    contact.erase (cont_i);
-	  // For an unknown reason, when the map is empty, 
-	  // cont_i-- does not points to contact.begin (), so this test is added:
-	  if (contact.size () == 0)
-	    break;
-	  cont_i = tmp;
-	  cont_i--;
-	}
-      
-      ExtractContact_OneDim (Z_range, contact, cutoff);
-      
-      for (cont_i = contact.begin (); cont_i != contact.end (); ++cont_i)
-	{
-	  if (cont_i->second == 3)
-	    {
-	      result.push_back (cont_i->first);
-	    }
-	}
+      vector< ResidueBox< iter_type > > boxes;
+
+      ExtractBoxes (boxes, begin, end, filter, nthreads);
+      if (grid_engine != engine)
+	ExtractContact_Sweep (boxes, result, cutoff);
+      else if (1 == nthreads)
+	ExtractContact_Grid (boxes, result, cutoff);
+      else
+	ExtractContact_ParallelGrid (boxes, result, cutoff, nthreads);
     }
     
     /**
@@ -196,18 +160,158 @@ namespace mccore
      * @param begin an iterator on a collection of Residue.
      * @param end an iterator on a collection of Residue.
      * @param cutoff on the minimum distance for a contact (default = 5.0 Angstroms).
+     * @param engine the contact engine, sweep_engine or grid_engine
+     * (default = sweep_engine).
      * @return a vector of pair of iterators on residues in contact.
      */
     template< class iter_type >
     static vector< pair< iter_type, iter_type > > 
-    extractContacts (iter_type begin, iter_type end, float cutoff = 5.0) 
+    extractContacts (iter_type begin, iter_type end, float cutoff = 5.0, unsigned char engine = sweep_engine) 
     {
       vector< pair< iter_type, iter_type > > result;
       RDATypeFilter< iter_type > filter;
 
-      extractContacts (result, begin, end, filter, cutoff);
+      extractContacts (result, begin, end, filter, cutoff, engine);
       return result;
     }
+
+    /**
+     * Calculates the possible contacts of many models, the models being
+     * distributed among threads.  Each model is processed by a single
+     * thread, so the results are the same as extractContacts on each
+     * model.
+     * @param results the contacts of each model, replaced.
+     * @param models the residue ranges [first, second) of the models.
+     * @param filter the residue filter.
+     * @param cutoff on the minimum distance for a contact (default = 5.0 Angstroms).
+     * @param engine the contact engine, sweep_engine or grid_engine
+     * (default = grid_engine).
+     * @param nthreads the number of threads (0 for one per processor).
+     * @exception IntLibException if the extraction failed in a thread.
+     */
+    template< class iter_type >
+    static void
+    extractContacts (vector< vector< pair< iter_type, iter_type > > > &results, const vector< pair< iter_type, iter_type > > &models, const RDATypeFilter< iter_type > &filter, float cutoff = 5.0, unsigned char engine = grid_engine, unsigned int nthreads = 0)
+    {
+      results.clear ();
+      results.resize (models.size ());
+
+      ExtractModelTask< iter_type > task (models, results, filter, cutoff, engine);
+      Parallel::run (task, models.size (), nthreads);
+    }
+
+    /**
+     * Keeps the contacts whose residues have atoms within cutoff of each
+     * other, pseudo-atoms excluded.  The bounding box engines report pairs
+     * of boxes, this stage removes the pairs without a genuine atomic
+     * contact.  The scan of a pair stops at the first atom pair found.
+     * @param contacts the contacts to refine, as returned by
+     * extractContacts.
+     * @param cutoff on the minimum distance for a contact (default = 5.0 Angstroms).
+     */
+    template< class iter_type >
+    static void
+    refineContacts (vector< pair< iter_type, iter_type > > &contacts, float cutoff = 5.0)
+    {
+      RefineContacts (contacts, (vector< float >*) 0, cutoff);
+    }
+
+    /**
+     * Keeps the contacts whose residues have atoms within cutoff of each
+     * other, pseudo-atoms excluded, and computes their minimum atomic
+     * distance.
+     * @param contacts the contacts to refine, as returned by
+     * extractContacts.
+     * @param distances the minimum distance of each remaining contact.
+     * @param cutoff on the minimum distance for a contact (default = 5.0 Angstroms).
+     */
+    template< class iter_type >
+    static void
+    refineContacts (vector< pair< iter_type, iter_type > > &contacts, vector< float > &distances, float cutoff = 5.0)
+    {
+      distances.clear ();
+      RefineContacts (contacts, &distances, cutoff);
+    }
+
+    /**
+     * Residue distance between the closest atoms, pseudo-atoms excluded.
+     */
+    static const unsigned char minimum_distance = 0;
+
+    /**
+     * Residue distance between the atom centroids, pseudo-atoms excluded.
+     */
+    static const unsigned char centroid_distance = 1;
+
+    /**
+     * Computes the distances between all the residues of a range.  The atom
+     * coordinates are packed once, the residue pairs are processed by
+     * blocks small enough to stay in the processor cache and the blocks are
+     * distributed among threads.  A residue without atoms is at the largest
+     * float from the others.
+     * @param matrix the distances, indexed by the residue positions in the
+     * range, replaced.
+     * @param begin an iterator on a collection of Residue.
+     * @param end an iterator on a collection of Residue.
+     * @param measure minimum_distance or centroid_distance (default =
+     * minimum_distance).
+     * @param nthreads the number of threads (0 for one per processor,
+     * default = 1).
+     * @exception IntLibException if the computation failed in a thread.
+     */
+    template< class iter_type >
+    static void
+    distanceMatrix (SymmetricalMatrix< float > &matrix, iter_type begin, iter_type end, unsigned char measure = minimum_distance, unsigned int nthreads = 1)
+    {
+      PackedResidues packed;
+      vector< pair< unsigned int, unsigned int > > blocks;
+      vector< vector< ResidueDistance > > chunks;
+
+      PackResidues (packed, begin, end);
+      DistanceBlocks (blocks, packed.size ());
+      matrix = SymmetricalMatrix< float > (packed.size ());
+
+      DistanceMatrixTask task (packed, blocks, measure, -1, &matrix, chunks);
+      Parallel::run (task, blocks.size (), nthreads);
+    }
+
+    /**
+     * Computes the distances between the residues of a range and keeps the
+     * pairs within cutoff, as a sparse matrix.  Residue pairs whose
+     * bounding spheres are farther than cutoff are skipped without atom
+     * test.
+     * @param result the residue positions in the range and distance of
+     * each pair within cutoff, sorted by positions, replaced.
+     * @param begin an iterator on a collection of Residue.
+     * @param end an iterator on a collection of Residue.
+     * @param cutoff the distance cutoff.
+     * @param measure minimum_distance or centroid_distance (default =
+     * minimum_distance).
+     * @param nthreads the number of threads (0 for one per processor,
+     * default = 1).
+     * @exception IntLibException if the computation failed in a thread.
+     */
+    template< class iter_type >
+    static void
+    distanceMatrix (vector< pair< pair< unsigned int, unsigned int >, float > > &result, iter_type begin, iter_type end, float cutoff, unsigned char measure = minimum_distance, unsigned int nthreads = 1)
+    {
+      PackedResidues packed;
+      vector< pair< unsigned int, unsigned int > > blocks;
+      vector< vector< ResidueDistance > > chunks;
+      unsigned int n;
+
+      PackResidues (packed, begin, end);
+      DistanceBlocks (blocks, packed.size ());
+      chunks.resize (Parallel::getChunkCount (blocks.size (), nthreads));
+
+      DistanceMatrixTask task (packed, blocks, measure, cutoff, 0, chunks);
+      Parallel::run (task, blocks.size (), nthreads);
+
+      result.clear ();
+      for (n = 0; n < chunks.size (); ++n)
+	result.insert (result.end (), chunks[n].begin (), chunks[n].end ());
+      sort (result.begin (), result.end ());
+    }
     
   private:
     
@@ -258,6 +362,146 @@ namespace mccore
 	out << res->getResId () << " : " << lower << "-" << upper;
       }
     };
+
+    /**
+     * Axis aligned bounding box of a residue.
+     */
+    template< class iter_type >
+    struct ResidueBox
+    {
+      iter_type res;
+      float lower[3];
+      float upper[3];
+
+      /**
+       * Tells whether the residue had no atom in the box.
+       */
+      bool empty () const { return lower[0] > upper[0]; }
+    };
+
+    /**
+     * Gets the bounding box of a residue, pseudo-atoms excluded, from the
+     * residue's cache.  Only the cache of the residue is written, a
+     * residue must not be boxed by two threads at once.
+     */
+    template< class iter_type >
+    static void ComputeBox (ResidueBox< iter_type > &box)
+    {
+      Vector3D lower;
+      Vector3D upper;
+
+      box.res->getBoundingBox (lower, upper);
+      box.lower[0] = lower.getX ();
+      box.lower[1] = lower.getY ();
+      box.lower[2] = lower.getZ ();
+      box.upper[0] = upper.getX ();
+      box.upper[1] = upper.getY ();
+      box.upper[2] = upper.getZ ();
+    }
+
+    /**
+     * Computes the bounding boxes of residues [first, last) in a thread.
+     */
+    template< class iter_type >
+    class ComputeBoxTask : public ParallelTask
+    {
+      vector< ResidueBox< iter_type > > &boxes;
+
+    public:
+
+      ComputeBoxTask (vector< ResidueBox< iter_type > > &b) : boxes (b) { }
+
+      virtual void execute (unsigned int chunk, unsigned int first, unsigned int last)
+      {
+	for (; first < last; ++first)
+	  ComputeBox (boxes[first]);
+      }
+    };
+
+    /**
+     * Computes the bounding boxes of the filtered residues, pseudo-atoms
+     * excluded.
+     */
+    template< class iter_type >
+    static void ExtractBoxes (vector< ResidueBox< iter_type > > &boxes,
+			      iter_type begin, iter_type end,
+			      const RDATypeFilter< iter_type > &filter,
+			      unsigned int nthreads = 1)
+    {
+      iter_type i;
+
+      for (i = begin; i != end; ++i)
+	{
+	  if (filter (i))
+	    {
+	      ResidueBox< iter_type > box;
+
+	      box.res = i;
+	      boxes.push_back (box);
+	    }
+	}
+
+      ComputeBoxTask< iter_type > task (boxes);
+      Parallel::run (task, boxes.size (), nthreads);
+    }
+
+    /**
+     * Sweeps the bounding boxes sorted along each axis and counts the
+     * overlaps.
+     */
+    template< class iter_type >
+    static void ExtractContact_Sweep (const vector< ResidueBox< iter_type > > &boxes,
+				      vector< pair< iter_type, iter_type > > &result,
+				      float cutoff)
+    {
+      vector< ResidueRange< iter_type > > X_range;
+      vector< ResidueRange< iter_type > > Y_range;
+      vector< ResidueRange< iter_type > > Z_range;
+      typename vector< ResidueBox< iter_type > >::const_iterator i;
+
+      for (i = boxes.begin (); boxes.end () != i; ++i)
+	{
+	  X_range.push_back (ResidueRange< iter_type > (i->res, i->lower[0], i->upper[0]));
+	  Y_range.push_back (ResidueRange< iter_type > (i->res, i->lower[1], i->upper[1]));
+	  Z_range.push_back (ResidueRange< iter_type > (i->res, i->lower[2], i->upper[2]));
+	}
+      
+      sort (X_range.begin (), X_range.end ());
+      sort (Y_range.begin (), Y_range.end ());
+      sort (Z_range.begin (), Z_range.end ());
+      
+      map< pair< iter_type, iter_type >, int > contact;
+      
+      ExtractContact_OneDim (X_range, contact, cutoff);
+      ExtractContact_OneDim (Y_range, contact, cutoff);
+      
+      typename map< pair< iter_type, iter_type >, int >::iterator cont_i;
+      
+      for (cont_i = contact.begin (); cont_i != contact.end (); ++cont_i)
+	{
+	  typename map< pair< iter_type, iter_type >, int >::iterator tmp = cont_i;
+	  
+	  tmp++;
+	  if (cont_i->second < 2)
+	    contact.erase (cont_i);
+	  // For an unknown reason, when the map is empty, 
+	  // cont_i-- does not points to contact.begin (), so this test is added:
+	  if (contact.size () == 0)
+	    break;
+	  cont_i = tmp;
+	  cont_i--;
+	}
+      
+      ExtractContact_OneDim (Z_range, contact, cutoff);
+      
+      for (cont_i = contact.begin (); cont_i != contact.end (); ++cont_i)
+	{
+	  if (cont_i->second == 3)
+	    {
+	      result.push_back (cont_i->first);
+	    }
+	}
+    }
     
     /**
      * Builds a map of contacts in one dimension given that range elements are sorted.     
@@ -289,6 +533,597 @@ namespace mccore
 	}
     }
 
+    /**
+     * Tests the overlap of two bounding boxes along an axis exactly as the
+     * sweep does: the range starting last must start within cutoff of the
+     * end of the other.
+     */
+    static bool OverlapOneDim (float la, float ua, float lb, float ub, float cutoff)
+    {
+      return la < lb ? lb - cutoff <= ua : la - cutoff <= ub;
+    }
+
+    /**
+     * Orders contact pairs like the keys of the sweep's contact map.
+     */
+    template< class iter_type >
+    static bool EquivalentPairs (const pair< iter_type, iter_type > &a,
+				 const pair< iter_type, iter_type > &b)
+    {
+      return ! (a < b) && ! (b < a);
+    }
+
+    /**
+     * Uniform grid over the non-empty bounding boxes.  Boxes are stored in
+     * every cell they cover: cell c holds the item numbers
+     * cellItems[cellStart[c], cellStart[c+1]).
+     */
+    struct ContactGrid
+    {
+      vector< unsigned int > items;
+      vector< unsigned int > cellStart;
+      vector< unsigned int > cellItems;
+      float origin[3];
+      float cell;
+      float margin;
+      unsigned int dims[3];
+    };
+
+    /**
+     * Fills the grid of the bounding boxes.  The cell size is the cutoff
+     * plus the mean box extent, enlarged when the grid would hold many
+     * more cells than boxes.
+     * @return false when there are less than two boxes to pair.
+     */
+    template< class iter_type >
+    static bool BuildGrid (const vector< ResidueBox< iter_type > > &boxes,
+			   ContactGrid &grid,
+			   float cutoff)
+    {
+      float limit[3];
+      float extent = 0;
+      unsigned int nboxes;
+      unsigned int i;
+      unsigned int k;
+      size_t ncells;
+
+      for (k = 0; k < 3; ++k)
+	{
+	  grid.origin[k] = numeric_limits<float>::max ();
+	  limit[k] = -numeric_limits<float>::max ();
+	}
+      for (i = 0; i < boxes.size (); ++i)
+	if (! boxes[i].empty ())
+	  {
+	    grid.items.push_back (i);
+	    for (k = 0; k < 3; ++k)
+	      {
+		grid.origin[k] = min (grid.origin[k], boxes[i].lower[k]);
+		limit[k] = max (limit[k], boxes[i].upper[k]);
+		extent += boxes[i].upper[k] - boxes[i].lower[k];
+	      }
+	  }
+      if (grid.items.size () < 2)
+	return false;
+      nboxes = grid.items.size ();
+
+      grid.cell = max (cutoff + extent / (3 * nboxes), 1.0f);
+      for (;;)
+	{
+	  for (k = 0, ncells = 1; k < 3; ++k)
+	    {
+	      grid.dims[k] = (unsigned int) ((limit[k] - grid.origin[k]) / grid.cell) + 1;
+	      ncells *= grid.dims[k];
+	    }
+	  if (ncells <= 8 * (size_t) nboxes)
+	    break;
+	  grid.cell *= 1.25f;
+	}
+      // -- widens the visited cells by a hair for rounding in the exact test
+      grid.margin = cutoff + grid.cell * 1e-3f;
+
+      vector< unsigned int > first (3 * nboxes);
+      vector< unsigned int > last (3 * nboxes);
+      unsigned int n;
+
+      grid.cellStart.assign (ncells + 1, 0);
+      for (n = 0; n < nboxes; ++n)
+	{
+	  const ResidueBox< iter_type > &box = boxes[grid.items[n]];
+
+	  for (k = 0; k < 3; ++k)
+	    {
+	      first[3 * n + k] = min ((unsigned int) ((box.lower[k] - grid.origin[k]) / grid.cell), grid.dims[k] - 1);
+	      last[3 * n + k] = min ((unsigned int) ((box.upper[k] - grid.origin[k]) / grid.cell), grid.dims[k] - 1);
+	    }
+	}
+      for (int pass = 0; pass < 2; ++pass)
+	{
+	  vector< unsigned int > fill;
+
+	  if (1 == pass)
+	    {
+	      for (size_t c = 0; c < ncells; ++c)
+		grid.cellStart[c + 1] += grid.cellStart[c];
+	      grid.cellItems.resize (grid.cellStart[ncells]);
+	      fill.assign (grid.cellStart.begin (), grid.cellStart.end () - 1);
+	    }
+	  for (n = 0; n < nboxes; ++n)
+	    {
+	      unsigned int x, y, z;
+
+	      for (x = first[3 * n]; x <= last[3 * n]; ++x)
+		for (y = first[3 * n + 1]; y <= last[3 * n + 1]; ++y)
+		  for (z = first[3 * n + 2]; z <= last[3 * n + 2]; ++z)
+		    {
+		      size_t c = ((size_t) x * grid.dims[1] + y) * grid.dims[2] + z;
+
+		      if (0 == pass)
+			++grid.cellStart[c + 1];
+		      else
+			grid.cellItems[fill[c]++] = n;
+		    }
+	    }
+	}
+      return true;
+    }
+
+    /**
+     * Finds the contacts of the grid items [begin, end) with the items that
+     * follow them.  The grid is only read, so that disjoint item ranges can
+     * be queried concurrently with their own stamp arrays.
+     */
+    template< class iter_type >
+    static void QueryGrid (const vector< ResidueBox< iter_type > > &boxes,
+			   const ContactGrid &grid,
+			   unsigned int begin, unsigned int end,
+			   vector< unsigned int > &stamp,
+			   vector< pair< iter_type, iter_type > > &result,
+			   float cutoff)
+    {
+      unsigned int n;
+      unsigned int k;
+
+      // -- visits the cells around each box, a stamp avoids testing a pair twice
+      stamp.assign (grid.items.size (), 0);
+      for (n = begin; n < end; ++n)
+	{
+	  const ResidueBox< iter_type > &a = boxes[grid.items[n]];
+	  unsigned int lo[3];
+	  unsigned int hi[3];
+	  unsigned int x, y, z;
+
+	  for (k = 0; k < 3; ++k)
+	    {
+	      float l = (a.lower[k] - grid.margin - grid.origin[k]) / grid.cell;
+	      float u = (a.upper[k] + grid.margin - grid.origin[k]) / grid.cell;
+
+	      lo[k] = 0 > l ? 0 : (unsigned int) l;
+	      hi[k] = grid.dims[k] - 1 < u ? grid.dims[k] - 1 : (unsigned int) u;
+	    }
+	  for (x = lo[0]; x <= hi[0]; ++x)
+	    for (y = lo[1]; y <= hi[1]; ++y)
+	      for (z = lo[2]; z <= hi[2]; ++z)
+		{
+		  size_t c = ((size_t) x * grid.dims[1] + y) * grid.dims[2] + z;
+		  unsigned int p;
+
+		  for (p = grid.cellStart[c]; p < grid.cellStart[c + 1]; ++p)
+		    {
+		      unsigned int m = grid.cellItems[p];
+
+		      if (m > n && n + 1 != stamp[m])
+			{
+			  const ResidueBox< iter_type > &b = boxes[grid.items[m]];
+
+			  stamp[m] = n + 1;
+			  if (OverlapOneDim (a.lower[0], a.upper[0], b.lower[0], b.upper[0], cutoff)
+			      && OverlapOneDim (a.lower[1], a.upper[1], b.lower[1], b.upper[1], cutoff)
+			      && OverlapOneDim (a.lower[2], a.upper[2], b.lower[2], b.upper[2], cutoff))
+			    {
+			      if (a.res < b.res)
+				result.push_back (make_pair (a.res, b.res));
+			      else
+				result.push_back (make_pair (b.res, a.res));
+			    }
+			}
+		    }
+		}
+	}
+    }
+
+    /**
+     * Finds the overlapping bounding boxes through a uniform grid, so that
+     * only the cells within cutoff of a box are visited.
+     */
+    template< class iter_type >
+    static void ExtractContact_Grid (const vector< ResidueBox< iter_type > > &boxes,
+				     vector< pair< iter_type, iter_type > > &result,
+				     float cutoff)
+    {
+      ContactGrid grid;
+      vector< unsigned int > stamp;
+      size_t start = result.size ();
+
+      if (! BuildGrid (boxes, grid, cutoff))
+	return;
+      QueryGrid (boxes, grid, 0, grid.items.size (), stamp, result, cutoff);
+
+      // -- same order as the sweep's contact map
+      sort (result.begin () + start, result.end ());
+      result.erase (unique (result.begin () + start, result.end (), EquivalentPairs< iter_type >), result.end ());
+    }
+
+    /**
+     * Queries the grid items [first, last) in a thread.  Each chunk keeps
+     * its own stamp array and sorted result, merged once all are done.
+     */
+    template< class iter_type >
+    class QueryGridTask : public ParallelTask
+    {
+      const vector< ResidueBox< iter_type > > &boxes;
+      const ContactGrid &grid;
+      float cutoff;
+
+    public:
+
+      vector< vector< pair< iter_type, iter_type > > > results;
+
+      QueryGridTask (const vector< ResidueBox< iter_type > > &b, const ContactGrid &g, float c, unsigned int nchunks)
+	: boxes (b), grid (g), cutoff (c), results (nchunks)
+      { }
+
+      virtual void execute (unsigned int chunk, unsigned int first, unsigned int last)
+      {
+	vector< unsigned int > stamp;
+
+	QueryGrid (boxes, grid, first, last, stamp, results[chunk], cutoff);
+	sort (results[chunk].begin (), results[chunk].end ());
+      }
+    };
+
+    /**
+     * Finds the overlapping bounding boxes through a uniform grid, the
+     * grid items being split among threads.  A pair is only found from its
+     * first item, so the chunk results are disjoint and their merge does
+     * not depend on the number of threads.
+     */
+    template< class iter_type >
+    static void ExtractContact_ParallelGrid (const vector< ResidueBox< iter_type > > &boxes,
+					     vector< pair< iter_type, iter_type > > &result,
+					     float cutoff,
+					     unsigned int nthreads)
+    {
+      ContactGrid grid;
+      size_t start = result.size ();
+      unsigned int nchunks;
+      unsigned int i;
+
+      if (! BuildGrid (boxes, grid, cutoff))
+	return;
+      nchunks = Parallel::getChunkCount (grid.items.size (), nthreads);
+
+      QueryGridTask< iter_type > task (boxes, grid, cutoff, nchunks);
+
+      Parallel::run (task, grid.items.size (), nthreads);
+      for (i = 0; i < nchunks; ++i)
+	{
+	  size_t middle = result.size ();
+
+	  result.insert (result.end (), task.results[i].begin (), task.results[i].end ());
+	  inplace_merge (result.begin () + start, result.begin () + middle, result.end ());
+	}
+      result.erase (unique (result.begin () + start, result.end (), EquivalentPairs< iter_type >), result.end ());
+    }
+
+    /**
+     * Extracts the contacts of models [first, last) in a thread, each
+     * model having its own result.
+     */
+    template< class iter_type >
+    class ExtractModelTask : public ParallelTask
+    {
+      const vector< pair< iter_type, iter_type > > &models;
+      vector< vector< pair< iter_type, iter_type > > > &results;
+      const RDATypeFilter< iter_type > &filter;
+      float cutoff;
+      unsigned char engine;
+
+    public:
+
+      ExtractModelTask (const vector< pair< iter_type, iter_type > > &m,
+			vector< vector< pair< iter_type, iter_type > > > &r,
+			const RDATypeFilter< iter_type > &f,
+			float c,
+			unsigned char e)
+	: models (m), results (r), filter (f), cutoff (c), engine (e)
+      { }
+
+      virtual void execute (unsigned int chunk, unsigned int first, unsigned int last)
+      {
+	for (; first < last; ++first)
+	  extractContacts (results[first], models[first].first, models[first].second, filter, cutoff, engine);
+      }
+    };
+
+    /**
+     * Computes the minimum squared distance between two sets of atoms
+     * stored as separate coordinate arrays.  The inner loop has no branch
+     * so that it can be vectorized; the scan stops after the row where
+     * the minimum fell to stop or below.
+     */
+    static float MinDistance2 (const float *ax, const float *ay, const float *az, unsigned int na,
+			       const float *bx, const float *by, const float *bz, unsigned int nb,
+			       float stop)
+    {
+      float best = numeric_limits<float>::max ();
+      unsigned int i;
+      unsigned int j;
+
+      for (i = 0; i < na && stop < best; ++i)
+	{
+	  float x = ax[i];
+	  float y = ay[i];
+	  float z = az[i];
+	  float row = numeric_limits<float>::max ();
+
+	  for (j = 0; j < nb; ++j)
+	    {
+	      float dx = bx[j] - x;
+	      float dy = by[j] - y;
+	      float dz = bz[j] - z;
+	      float d2 = dx * dx + dy * dy + dz * dz;
+
+	      row = d2 < row ? d2 : row;
+	    }
+	  best = row < best ? row : best;
+	}
+      return best;
+    }
+
+    /**
+     * Filters the contacts on their minimum atomic distance.  The atom
+     * coordinates of each residue are copied once in contiguous arrays;
+     * without distances the scan of a pair stops at the first hit.
+     */
+    template< class iter_type >
+    static void RefineContacts (vector< pair< iter_type, iter_type > > &contacts,
+				vector< float > *distances,
+				float cutoff)
+    {
+      typename vector< pair< iter_type, iter_type > >::iterator cit;
+      typename vector< pair< iter_type, iter_type > >::iterator out;
+      typename vector< iter_type >::iterator rit;
+      vector< iter_type > residues;
+      vector< unsigned int > start;
+      vector< float > x;
+      vector< float > y;
+      vector< float > z;
+      AtomSetNot as_nopse (new AtomSetPSE ());
+      float cutoff2 = cutoff * cutoff;
+      float stop = 0 == distances ? cutoff2 : -1;
+
+      for (cit = contacts.begin (); contacts.end () != cit; ++cit)
+	{
+	  residues.push_back (cit->first);
+	  residues.push_back (cit->second);
+	}
+      sort (residues.begin (), residues.end ());
+      residues.erase (unique (residues.begin (), residues.end ()), residues.end ());
+
+      // -- residue r holds the coordinates [start[r], start[r+1])
+      for (rit = residues.begin (); residues.end () != rit; ++rit)
+	{
+	  const Residue &res = **rit;
+	  Residue::const_iterator j;
+
+	  start.push_back (x.size ());
+	  for (j = res.begin (as_nopse); res.end () != j; ++j)
+	    {
+	      x.push_back (j->getX ());
+	      y.push_back (j->getY ());
+	      z.push_back (j->getZ ());
+	    }
+	}
+      start.push_back (x.size ());
+      if (x.empty ())
+	{
+	  contacts.clear ();
+	  return;
+	}
+
+      for (cit = out = contacts.begin (); contacts.end () != cit; ++cit)
+	{
+	  // -- pairs whose bounding spheres are too far are dropped at once
+	  if (! (*cit->first).mayBeWithin (*cit->second, cutoff))
+	    continue;
+
+	  unsigned int a = lower_bound (residues.begin (), residues.end (), cit->first) - residues.begin ();
+	  unsigned int b = lower_bound (residues.begin (), residues.end (), cit->second) - residues.begin ();
+	  float d2 = MinDistance2 (&x[0] + start[a], &y[0] + start[a], &z[0] + start[a], start[a + 1] - start[a],
+				   &x[0] + start[b], &y[0] + start[b], &z[0] + start[b], start[b + 1] - start[b],
+				   stop);
+
+	  // -- a pair at the cutoff is kept whichever way it is rounded
+	  if (d2 <= cutoff2 || sqrt (d2) <= cutoff)
+	    {
+	      *out++ = *cit;
+	      if (0 != distances)
+		distances->push_back (sqrt (d2));
+	    }
+	}
+      contacts.erase (out, contacts.end ());
+    }
+
+    /**
+     * Number of residues along a side of the distance matrix blocks.
+     */
+    static const unsigned int DISTANCE_BLOCK = 32;
+
+    /**
+     * A residue pair and its distance.
+     */
+    typedef pair< pair< unsigned int, unsigned int >, float > ResidueDistance;
+
+    /**
+     * Atom coordinates of residues in contiguous arrays, pseudo-atoms
+     * excluded: residue r holds the coordinates [start[r], start[r+1]).
+     * The bounding sphere and atom centroid of each residue are kept
+     * aside.
+     */
+    struct PackedResidues
+    {
+      vector< float > x;
+      vector< float > y;
+      vector< float > z;
+      vector< unsigned int > start;
+      vector< float > center;
+      vector< float > radius;
+      vector< float > centroid;
+
+      /**
+       * Gets the number of residues.
+       */
+      unsigned int size () const { return start.empty () ? 0 : start.size () - 1; }
+
+      /**
+       * Tells whether a residue has no atoms.
+       */
+      bool empty (unsigned int r) const { return start[r] == start[r + 1]; }
+    };
+
+    /**
+     * Packs the atom coordinates of the residues of a range.  The bounding
+     * spheres come from the residues' cache.
+     */
+    template< class iter_type >
+    static void PackResidues (PackedResidues &packed, iter_type begin, iter_type end)
+    {
+      AtomSetNot as_nopse (new AtomSetPSE ());
+      iter_type i;
+
+      for (i = begin; end != i; ++i)
+	{
+	  const Residue &res = *i;
+	  Residue::const_iterator j;
+	  Vector3D center;
+	  float radius;
+	  float sum[3] = { 0, 0, 0 };
+	  unsigned int first = packed.x.size ();
+	  unsigned int k;
+
+	  packed.start.push_back (first);
+	  for (j = res.begin (as_nopse); res.end () != j; ++j)
+	    {
+	      packed.x.push_back (j->getX ());
+	      packed.y.push_back (j->getY ());
+	      packed.z.push_back (j->getZ ());
+	      sum[0] += j->getX ();
+	      sum[1] += j->getY ();
+	      sum[2] += j->getZ ();
+	    }
+
+	  res.getBoundingSphere (center, radius);
+	  packed.center.push_back (center.getX ());
+	  packed.center.push_back (center.getY ());
+	  packed.center.push_back (center.getZ ());
+	  packed.radius.push_back (radius);
+	  for (k = 0; k < 3; ++k)
+	    packed.centroid.push_back (first == packed.x.size () ? 0 : sum[k] / (packed.x.size () - first));
+	}
+      packed.start.push_back (packed.x.size ());
+    }
+
+    /**
+     * Lists the blocks of the upper triangle of an n x n matrix, row by
+     * row, so that contiguous block ranges hold similar work.
+     */
+    static void DistanceBlocks (vector< pair< unsigned int, unsigned int > > &blocks, unsigned int n)
+    {
+      unsigned int a;
+      unsigned int b;
+
+      for (a = 0; a < n; a += DISTANCE_BLOCK)
+	for (b = a; b < n; b += DISTANCE_BLOCK)
+	  blocks.push_back (make_pair (a, b));
+    }
+
+    /**
+     * Computes the residue distances of the blocks [first, last) in a
+     * thread.  The distances are written in the matrix, each cell by a
+     * single block, or appended to the chunk list when within cutoff.
+     */
+    class DistanceMatrixTask : public ParallelTask
+    {
+      const PackedResidues &packed;
+      const vector< pair< unsigned int, unsigned int > > &blocks;
+      unsigned char measure;
+      float cutoff;
+      SymmetricalMatrix< float > *matrix;
+      vector< vector< ResidueDistance > > &chunks;
+
+    public:
+
+      DistanceMatrixTask (const PackedResidues &p,
+			  const vector< pair< unsigned int, unsigned int > > &b,
+			  unsigned char m, float c, SymmetricalMatrix< float > *mx,
+			  vector< vector< ResidueDistance > > &ch)
+	: packed (p), blocks (b), measure (m), cutoff (c), matrix (mx), chunks (ch)
+      { }
+
+      virtual void execute (unsigned int chunk, unsigned int first, unsigned int last)
+      {
+	const float *x = packed.x.empty () ? 0 : &packed.x[0];
+	const float *y = packed.y.empty () ? 0 : &packed.y[0];
+	const float *z = packed.z.empty () ? 0 : &packed.z[0];
+	const vector< unsigned int > &start = packed.start;
+	unsigned int n = packed.size ();
+
+	for (; first < last; ++first)
+	  {
+	    unsigned int a = blocks[first].first;
+	    unsigned int b = blocks[first].second;
+	    unsigned int i;
+	    unsigned int j;
+
+	    for (i = a; i < a + DISTANCE_BLOCK && i < n; ++i)
+	      for (j = (a == b ? i + 1 : b); j < b + DISTANCE_BLOCK && j < n; ++j)
+		{
+		  float d;
+
+		  if (packed.empty (i) || packed.empty (j))
+		    d = numeric_limits< float >::max ();
+		  else if (centroid_distance == measure)
+		    d = Distance (&packed.centroid[3 * i], &packed.centroid[3 * j]);
+		  else if (0 <= cutoff
+			   && (Distance (&packed.center[3 * i], &packed.center[3 * j])
+			       > packed.radius[i] + packed.radius[j] + cutoff))
+		    continue;
+		  else
+		    d = sqrt (MinDistance2 (x + start[i], y + start[i], z + start[i], start[i + 1] - start[i],
+					    x + start[j], y + start[j], z + start[j], start[j + 1] - start[j],
+					    -1));
+
+		  if (0 != matrix)
+		    (*matrix) (i, j) = d;
+		  else if (d <= cutoff)
+		    chunks[chunk].push_back (make_pair (make_pair (i, j), d));
+		}
+	  }
+      }
+
+    private:
+
+      static float Distance (const float *p, const float *q)
+      {
+	float dx = q[0] - p[0];
+	float dy = q[1] - p[1];
+	float dz = q[2] - p[2];
+
+	return sqrt (dx * dx + dy * dy + dz * dz);
+      }
+    };
+
   };
 }
 
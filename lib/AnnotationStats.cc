@@ -0,0 +1,158 @@
+//                              -*- Mode: C++ -*-
+// AnnotationStats.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+// cmake generated defines
+#include <config.h>
+
+#include <sys/time.h>
+
+#include "AnnotationStats.h"
+#include "Relation.h"
+
+
+
+namespace mccore
+{
+
+  // ACCESS ---------------------------------------------------------------
+
+  unsigned long
+  AnnotationStats::getRelations (unsigned char mask) const
+  {
+    unsigned int bit;
+
+    for (bit = 0; bit < 4; ++bit)
+      if (mask == 1 << bit)
+	return relationTypes[bit];
+    return 0;
+  }
+
+
+  double
+  AnnotationStats::getTime () const
+  {
+    double total = 0;
+    unsigned int stage;
+
+    for (stage = 0; stage < stage_count; ++stage)
+      total += times[stage];
+    return total;
+  }
+
+  // METHODS --------------------------------------------------------------
+
+  void
+  AnnotationStats::clear ()
+  {
+    unsigned int n;
+
+    contacts = relations = 0;
+    for (n = 0; n < 4; ++n)
+      relationTypes[n] = 0;
+    pairingTested = boundsRejects = sphereRejects = normalRejects
+      = donorRejects = hbonds = flows = 0;
+    for (n = 0; n < stage_count; ++n)
+      times[n] = 0;
+  }
+
+
+  void
+  AnnotationStats::addRelation (const Relation &rel)
+  {
+    unsigned int bit;
+
+    ++relations;
+    for (bit = 0; bit < 4; ++bit)
+      if (0 != (rel.getAnnotationType () & (1 << bit)))
+	++relationTypes[bit];
+  }
+
+
+  void
+  AnnotationStats::add (const AnnotationStats &other)
+  {
+    unsigned int n;
+
+    contacts += other.contacts;
+    relations += other.relations;
+    for (n = 0; n < 4; ++n)
+      relationTypes[n] += other.relationTypes[n];
+    pairingTested += other.pairingTested;
+    boundsRejects += other.boundsRejects;
+    sphereRejects += other.sphereRejects;
+    normalRejects += other.normalRejects;
+    donorRejects += other.donorRejects;
+    hbonds += other.hbonds;
+    flows += other.flows;
+    for (n = 0; n < stage_count; ++n)
+      times[n] += other.times[n];
+  }
+
+
+  double
+  AnnotationStats::clock ()
+  {
+    struct timeval tv;
+
+    gettimeofday (&tv, 0);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+  }
+
+  // I/O  -----------------------------------------------------------------
+
+  ostream&
+  AnnotationStats::output (ostream &os) const
+  {
+    os << "contacts: " << contacts << endl
+       << "relations: " << relations
+       << " (adjacent " << relationTypes[3]
+       << ", stacking " << relationTypes[2]
+       << ", pairing " << relationTypes[1]
+       << ", bhbond " << relationTypes[0] << ")" << endl
+       << "pairing tested: " << pairingTested
+       << " bounds rejects: " << boundsRejects
+       << " sphere rejects: " << sphereRejects
+       << " normal rejects: " << normalRejects
+       << " donor rejects: " << donorRejects << endl
+       << "H-bonds evaluated: " << hbonds
+       << " flow networks: " << flows << endl
+       << "time (ms): H/LP " << times[hlp_stage]
+       << " contacts " << times[contact_stage]
+       << " relations " << times[relation_stage]
+       << " total " << getTime () << endl;
+    return os;
+  }
+
+}
+
+
+
+namespace std
+{
+
+  ostream&
+  operator<< (ostream &os, const mccore::AnnotationStats &obj)
+  {
+    return obj.output (os);
+  }
+
+}
@@ -0,0 +1,301 @@
+//                              -*- Mode: C++ -*-
+// AnnotationStats.h
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef _mccore_AnnotationStats_h_
+#define _mccore_AnnotationStats_h_
+
+#include <iostream>
+
+using namespace std;
+
+
+
+namespace mccore
+{
+  class Relation;
+
+
+
+  /**
+   * @short Statistics of a model annotation.
+   *
+   * The statistics count the contacts found, the relations kept by type
+   * and the pairing tests: the residue pairs tested, rejected by each
+   * prefilter stage, the H-bonds evaluated and the maximum flow networks
+   * solved.  The time spent in each annotation stage is measured in
+   * milliseconds by a microsecond clock.
+   *
+   * The pairing counts are kept by the Relation tests of the annotation
+   * itself: each thread counts into its own statistics, added to the ones
+   * of the model once its relations are annotated.
+   */
+  class AnnotationStats
+  {
+  public:
+
+    /**
+     * The stage placing the hydrogens and lone pairs.
+     */
+    static const unsigned int hlp_stage = 0;
+
+    /**
+     * The stage extracting the contacts.
+     */
+    static const unsigned int contact_stage = 1;
+
+    /**
+     * The stage annotating the relations and inserting them in the model.
+     */
+    static const unsigned int relation_stage = 2;
+
+    /**
+     * The number of stages.
+     */
+    static const unsigned int stage_count = 3;
+
+  private:
+
+    /**
+     * The possible contacts found.
+     */
+    unsigned long contacts;
+
+    /**
+     * The relations kept, and the ones of each annotation type bit
+     * (Relation::bhbond_mask, pairing_mask, stacking_mask and
+     * adjacent_mask).
+     */
+    unsigned long relations;
+    unsigned long relationTypes[4];
+
+    /**
+     * The pairing statistics.
+     */
+    unsigned long pairingTested;
+    unsigned long boundsRejects;
+    unsigned long sphereRejects;
+    unsigned long normalRejects;
+    unsigned long donorRejects;
+    unsigned long hbonds;
+    unsigned long flows;
+
+    /**
+     * The time of each stage, in milliseconds.
+     */
+    double times[stage_count];
+
+  public:
+
+    // LIFECYCLE ------------------------------------------------------------
+
+    /**
+     * Initializes empty statistics.
+     */
+    AnnotationStats () { clear (); }
+
+    /**
+     * Destroys the object.
+     */
+    ~AnnotationStats () { }
+
+    // ACCESS ---------------------------------------------------------------
+
+    /**
+     * Gets the number of possible contacts found.
+     * @return the contact count.
+     */
+    unsigned long getContacts () const { return contacts; }
+
+    /**
+     * Gets the number of relations kept, each residue pair counted once.
+     * @return the relation count.
+     */
+    unsigned long getRelations () const { return relations; }
+
+    /**
+     * Gets the number of relations kept of an annotation type.
+     * @param mask a type mask: Relation::adjacent_mask, stacking_mask,
+     * pairing_mask or bhbond_mask.
+     * @return the relation count.
+     */
+    unsigned long getRelations (unsigned char mask) const;
+
+    /**
+     * Gets the number of residue pairs tested for pairing.
+     * @return the tested pair count.
+     */
+    unsigned long getPairingTested () const { return pairingTested; }
+
+    /**
+     * Gets the number of pairs rejected by the residue bounds.
+     * @return the rejected pair count.
+     */
+    unsigned long getBoundsRejects () const { return boundsRejects; }
+
+    /**
+     * Gets the number of pairs rejected by the H-bond atom spheres.
+     * @return the rejected pair count.
+     */
+    unsigned long getSphereRejects () const { return sphereRejects; }
+
+    /**
+     * Gets the number of pairs rejected by the base normal angle.
+     * @return the rejected pair count.
+     */
+    unsigned long getNormalRejects () const { return normalRejects; }
+
+    /**
+     * Gets the number of pairs rejected for lack of a close donor and
+     * acceptor.
+     * @return the rejected pair count.
+     */
+    unsigned long getDonorRejects () const { return donorRejects; }
+
+    /**
+     * Gets the number of H-bonds evaluated for pairing.
+     * @return the evaluated H-bond count.
+     */
+    unsigned long getHBonds () const { return hbonds; }
+
+    /**
+     * Gets the number of maximum flow networks solved for pairing.
+     * @return the solved network count.
+     */
+    unsigned long getFlows () const { return flows; }
+
+    /**
+     * Gets the time spent in a stage.
+     * @param stage the stage: hlp_stage, contact_stage or relation_stage.
+     * @return the time in milliseconds.
+     */
+    double getTime (unsigned int stage) const { return times[stage]; }
+
+    /**
+     * Gets the time spent in all stages.
+     * @return the time in milliseconds.
+     */
+    double getTime () const;
+
+    // METHODS --------------------------------------------------------------
+
+    /**
+     * Clears the statistics.
+     */
+    void clear ();
+
+    /**
+     * Adds possible contacts found.
+     * @param count the contact count.
+     */
+    void addContacts (unsigned long count) { contacts += count; }
+
+    /**
+     * Counts a kept relation by its annotation types.
+     * @param rel the relation.
+     */
+    void addRelation (const Relation &rel);
+
+    /**
+     * Counts a residue pair tested for pairing.
+     */
+    void addPairingTested () { ++pairingTested; }
+
+    /**
+     * Counts a pair rejected by the residue bounds.
+     */
+    void addBoundsReject () { ++boundsRejects; }
+
+    /**
+     * Counts a pair rejected by the H-bond atom spheres.
+     */
+    void addSphereReject () { ++sphereRejects; }
+
+    /**
+     * Counts a pair rejected by the base normal angle.
+     */
+    void addNormalReject () { ++normalRejects; }
+
+    /**
+     * Counts a pair rejected for lack of a close donor and acceptor.
+     */
+    void addDonorReject () { ++donorRejects; }
+
+    /**
+     * Adds H-bonds evaluated for pairing.
+     * @param count the H-bond count.
+     */
+    void addHBonds (unsigned long count) { hbonds += count; }
+
+    /**
+     * Counts a maximum flow network solved for pairing.
+     */
+    void addFlow () { ++flows; }
+
+    /**
+     * Adds the counts and times of other statistics, such as the ones
+     * kept by each thread of an annotation.
+     * @param other the statistics to add.
+     */
+    void add (const AnnotationStats &other);
+
+    /**
+     * Adds time to a stage.
+     * @param stage the stage.
+     * @param ms the time in milliseconds.
+     */
+    void addTime (unsigned int stage, double ms) { times[stage] += ms; }
+
+    /**
+     * Reads the clock.
+     * @return the time in milliseconds, from an arbitrary origin.
+     */
+    static double clock ();
+
+    // I/O  -----------------------------------------------------------------
+
+    /**
+     * Writes the statistics to a stream.
+     * @param os the output stream.
+     * @return the used output stream.
+     */
+    ostream& output (ostream &os) const;
+
+  };
+
+}
+
+
+
+namespace std
+{
+
+  /**
+   * Writes annotation statistics to an output stream.
+   * @param os the output stream.
+   * @param obj the statistics.
+   * @return the output stream.
+   */
+  ostream& operator<< (ostream &os, const mccore::AnnotationStats &obj);
+
+}
+
+#endif
@@ -0,0 +1,430 @@
+//                              -*- Mode: C++ -*-
+// ClashChecker.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "Atom.h"
+#include "AtomType.h"
+#include "ClashChecker.h"
+#include "Residue.h"
+
+
+
+namespace mccore
+{
+
+  /**
+   * @internal
+   * Initial number of buckets of the spatial hash.
+   */
+  static const unsigned int INITIAL_BUCKETS = 256;
+
+  /**
+   * @internal
+   * Squared bond length cutoff between linking atoms (Angstroms square),
+   * as for the adjacency of Relation.
+   */
+  static const float LINK_DISTANCE_CUTOFF_SQUARE = 4.0;
+
+  /**
+   * @internal
+   * Linking atoms of a residue entry.
+   */
+  enum { LINK_O3p = 0, LINK_P, LINK_C, LINK_N };
+
+  /**
+   * @internal
+   * Atoms around the links: the upstream residue side and the downstream
+   * residue side of phosphodiester and peptide bonds.
+   */
+  enum
+    {
+      NUCLEIC_UP = 1,
+      NUCLEIC_DOWN = 2,
+      PEPTIDE_UP = 4,
+      PEPTIDE_DOWN = 8
+    };
+
+
+  /**
+   * @internal
+   * Gets the link sides of an atom type.
+   */
+  static unsigned char
+  _link_sides (const AtomType *t)
+  {
+    unsigned char sides = 0;
+
+    if (AtomType::aO3p == t || AtomType::aC3p == t || AtomType::aC2p == t
+	|| AtomType::aC4p == t || AtomType::aH3p == t)
+      sides |= NUCLEIC_UP;
+    if (AtomType::aP == t || AtomType::aO1P == t || AtomType::aO2P == t
+	|| AtomType::aO3P == t || AtomType::aO5p == t || AtomType::aC5p == t)
+      sides |= NUCLEIC_DOWN;
+    if (AtomType::aC == t || AtomType::aCA == t || AtomType::aO == t)
+      sides |= PEPTIDE_UP;
+    if (AtomType::aN == t || AtomType::aCA == t || AtomType::aH == t)
+      sides |= PEPTIDE_DOWN;
+    return sides;
+  }
+
+
+  /**
+   * @internal
+   * Gets the linking atom positions of a residue.
+   */
+  static void
+  _link_atoms (const Residue &res, float link[4][3], bool hasLink[4])
+  {
+    const AtomType *types[4] = { AtomType::aO3p, AtomType::aP, AtomType::aC, AtomType::aN };
+    unsigned int l;
+
+    for (l = 0; l < 4; ++l)
+      {
+	Residue::const_iterator it = res.find (types[l]);
+
+	if ((hasLink[l] = res.end () != it))
+	  {
+	    link[l][0] = it->getX ();
+	    link[l][1] = it->getY ();
+	    link[l][2] = it->getZ ();
+	  }
+      }
+  }
+
+
+  /**
+   * @internal
+   * Tells whether two linking atoms are bonded.
+   */
+  static bool
+  _bonded (const float *a, bool hasA, const float *b, bool hasB)
+  {
+    float dx, dy, dz;
+
+    if (! hasA || ! hasB)
+      return false;
+    dx = a[0] - b[0];
+    dy = a[1] - b[1];
+    dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz <= LINK_DISTANCE_CUTOFF_SQUARE;
+  }
+
+  // LIFECYCLE ------------------------------------------------------------
+
+  ClashChecker::ClashChecker (float s, float c)
+    : buckets (INITIAL_BUCKETS),
+      stamp (INITIAL_BUCKETS, 0),
+      currentStamp (0),
+      atomCount (0),
+      maxRadius (0),
+      scale (s),
+      cell (c)
+  {
+    if (0 >= scale || 0 >= cell)
+      {
+	IntLibException ex ("", __FILE__, __LINE__);
+	ex << "invalid clash scale " << scale << " or cell size " << cell;
+	throw ex;
+      }
+  }
+
+  // ACCESS ---------------------------------------------------------------
+
+  float
+  ClashChecker::getRadius (const Atom &atom, const Residue &res) const
+  {
+    const AtomType *t = atom.getType ();
+    map< const AtomType*, float >::const_iterator it;
+
+    if (t->isPseudo () || t->isLonePair ())
+      return 0;
+    if (radii.end () != (it = radii.find (t)))
+      return it->second;
+    return t->getVDWR (res.getType ());
+  }
+
+  // METHODS --------------------------------------------------------------
+
+  void
+  ClashChecker::insert (const Residue &res)
+  {
+    Residue::const_iterator it;
+    unsigned int r;
+
+    if (contains (res))
+      {
+	IntLibException ex ("", __FILE__, __LINE__);
+	ex << "residue " << res.getResId () << " is already placed";
+	throw ex;
+      }
+
+    if (freeResidues.empty ())
+      {
+	r = residues.size ();
+	residues.push_back (ResidueEntry ());
+      }
+    else
+      {
+	r = freeResidues.back ();
+	freeResidues.pop_back ();
+      }
+    residueIndex.insert (make_pair (&res, r));
+
+    ResidueEntry &e = residues[r];
+
+    e.res = &res;
+    _link_atoms (res, e.link, e.hasLink);
+    for (it = res.begin (); res.end () != it; ++it)
+      {
+	float radius = getRadius (*it, res);
+
+	if (0 < radius)
+	  {
+	    AtomEntry a;
+	    unsigned int n;
+
+	    a.xyz[0] = it->getX ();
+	    a.xyz[1] = it->getY ();
+	    a.xyz[2] = it->getZ ();
+	    a.radius = radius;
+	    a.residue = r;
+	    a.link = _link_sides (it->getType ());
+	    if (freeAtoms.empty ())
+	      {
+		n = atoms.size ();
+		atoms.push_back (a);
+	      }
+	    else
+	      {
+		n = freeAtoms.back ();
+		freeAtoms.pop_back ();
+		atoms[n] = a;
+	      }
+	    e.atoms.push_back (n);
+	    buckets[_bucket (a.xyz)].push_back (n);
+	    maxRadius = max (maxRadius, radius);
+	    ++atomCount;
+	  }
+      }
+    _grow ();
+  }
+
+
+  void
+  ClashChecker::erase (const Residue &res)
+  {
+    map< const Residue*, unsigned int >::iterator rit = residueIndex.find (&res);
+    vector< unsigned int >::iterator it;
+
+    if (residueIndex.end () == rit)
+      {
+	NoSuchElementException ex ("", __FILE__, __LINE__);
+	ex << "residue " << res.getResId () << " is not placed";
+	throw ex;
+      }
+
+    ResidueEntry &e = residues[rit->second];
+
+    for (it = e.atoms.begin (); e.atoms.end () != it; ++it)
+      {
+	vector< unsigned int > &b = buckets[_bucket (atoms[*it].xyz)];
+
+	*find (b.begin (), b.end (), *it) = b.back ();
+	b.pop_back ();
+	freeAtoms.push_back (*it);
+	--atomCount;
+      }
+    e.atoms.clear ();
+    e.res = 0;
+    freeResidues.push_back (rit->second);
+    residueIndex.erase (rit);
+  }
+
+
+  void
+  ClashChecker::clear ()
+  {
+    atoms.clear ();
+    freeAtoms.clear ();
+    residues.clear ();
+    freeResidues.clear ();
+    residueIndex.clear ();
+    buckets.clear ();
+    buckets.resize (INITIAL_BUCKETS);
+    stamp.assign (INITIAL_BUCKETS, 0);
+    currentStamp = 0;
+    atomCount = 0;
+    maxRadius = 0;
+  }
+
+
+  bool
+  ClashChecker::clashes (const Residue &res) const
+  {
+    return 0 < _scan (res, true);
+  }
+
+
+  float
+  ClashChecker::getClashScore (const Residue &res) const
+  {
+    return _scan (res, false);
+  }
+
+
+  float
+  ClashChecker::_scan (const Residue &res, bool first) const
+  {
+    map< const Residue*, unsigned int >::const_iterator rit = residueIndex.find (&res);
+    unsigned int self = residueIndex.end () == rit ? residues.size () : rit->second;
+    Residue::const_iterator it;
+    float link[4][3];
+    bool hasLink[4];
+    float score = 0;
+
+    if (0 == atomCount)
+      return 0;
+
+    _link_atoms (res, link, hasLink);
+    for (it = res.begin (); res.end () != it; ++it)
+      {
+	float radius = getRadius (*it, res);
+	float p[3] = { it->getX (), it->getY (), it->getZ () };
+	unsigned char sides = _link_sides (it->getType ());
+	float reach;
+	int lo[3];
+	int hi[3];
+	int x, y, z;
+	unsigned int k;
+
+	if (0 >= radius)
+	  continue;
+
+	reach = scale * (radius + maxRadius);
+	for (k = 0; k < 3; ++k)
+	  {
+	    lo[k] = (int) floor ((p[k] - reach) / cell);
+	    hi[k] = (int) floor ((p[k] + reach) / cell);
+	  }
+	if (0 == ++currentStamp)
+	  {
+	    fill (stamp.begin (), stamp.end (), 0);
+	    currentStamp = 1;
+	  }
+
+	for (x = lo[0]; x <= hi[0]; ++x)
+	  for (y = lo[1]; y <= hi[1]; ++y)
+	    for (z = lo[2]; z <= hi[2]; ++z)
+	      {
+		unsigned int bn = _bucket (x, y, z);
+		vector< unsigned int >::const_iterator ait;
+
+		// -- cells sharing a bucket are visited once
+		if (currentStamp == stamp[bn])
+		  continue;
+		stamp[bn] = currentStamp;
+
+		for (ait = buckets[bn].begin (); buckets[bn].end () != ait; ++ait)
+		  {
+		    const AtomEntry &a = atoms[*ait];
+		    float limit = scale * (radius + a.radius);
+		    float dx, dy, dz, d2;
+
+		    if (self == a.residue)
+		      continue;
+		    dx = a.xyz[0] - p[0];
+		    dy = a.xyz[1] - p[1];
+		    dz = a.xyz[2] - p[2];
+		    d2 = dx * dx + dy * dy + dz * dz;
+		    if (d2 >= limit * limit)
+		      continue;
+
+		    // -- atoms around a bond between the residues
+		    if (0 != sides && 0 != a.link)
+		      {
+			const ResidueEntry &e = residues[a.residue];
+
+			if ((0 != (sides & NUCLEIC_UP) && 0 != (a.link & NUCLEIC_DOWN)
+			     && _bonded (link[LINK_O3p], hasLink[LINK_O3p], e.link[LINK_P], e.hasLink[LINK_P]))
+			    || (0 != (sides & NUCLEIC_DOWN) && 0 != (a.link & NUCLEIC_UP)
+				&& _bonded (link[LINK_P], hasLink[LINK_P], e.link[LINK_O3p], e.hasLink[LINK_O3p]))
+			    || (0 != (sides & PEPTIDE_UP) && 0 != (a.link & PEPTIDE_DOWN)
+				&& _bonded (link[LINK_C], hasLink[LINK_C], e.link[LINK_N], e.hasLink[LINK_N]))
+			    || (0 != (sides & PEPTIDE_DOWN) && 0 != (a.link & PEPTIDE_UP)
+				&& _bonded (link[LINK_N], hasLink[LINK_N], e.link[LINK_C], e.hasLink[LINK_C])))
+			  continue;
+		      }
+
+		    score += limit - sqrt (d2);
+		    if (first)
+		      return score;
+		  }
+	      }
+      }
+    return score;
+  }
+
+
+  unsigned int
+  ClashChecker::_bucket (int x, int y, int z) const
+  {
+    unsigned int h = ((unsigned int) x * 73856093u)
+      ^ ((unsigned int) y * 19349663u)
+      ^ ((unsigned int) z * 83492791u);
+
+    return h % buckets.size ();
+  }
+
+
+  unsigned int
+  ClashChecker::_bucket (const float *p) const
+  {
+    return _bucket ((int) floor (p[0] / cell), (int) floor (p[1] / cell), (int) floor (p[2] / cell));
+  }
+
+
+  void
+  ClashChecker::_grow ()
+  {
+    if (atomCount > 2 * buckets.size ())
+      {
+	vector< ResidueEntry >::const_iterator rit;
+
+	buckets.clear ();
+	buckets.resize (4 * atomCount);
+	stamp.assign (buckets.size (), 0);
+	currentStamp = 0;
+	for (rit = residues.begin (); residues.end () != rit; ++rit)
+	  {
+	    vector< unsigned int >::const_iterator it;
+
+	    for (it = rit->atoms.begin (); rit->atoms.end () != it; ++it)
+	      buckets[_bucket (atoms[*it].xyz)].push_back (*it);
+	  }
+      }
+  }
+
+}
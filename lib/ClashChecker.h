@@ -0,0 +1,284 @@
+//                              -*- Mode: C++ -*-
+// ClashChecker.h
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef _mccore_ClashChecker_h_
+#define _mccore_ClashChecker_h_
+
+#include <map>
+#include <vector>
+
+#include "Exception.h"
+
+using namespace std;
+
+
+
+namespace mccore
+{
+  class Atom;
+  class AtomType;
+  class Residue;
+
+
+
+  /**
+   * @short Steric clash detection against a set of placed residues.
+   *
+   * The atoms of the placed residues are kept in a spatial hash of cubic
+   * cells.  Two atoms clash when their distance is below the sum of their
+   * van der Waals radii times a scale factor.  The radii come from
+   * AtomType::getVDWR unless set for an atom type; atoms without radius,
+   * pseudo-atoms and lone pairs are ignored.
+   *
+   * Atoms of the same residue never clash.  Between residues linked by a
+   * phosphodiester (O3'-P) or peptide (C-N) bond, the atoms around the
+   * link are not tested against each other.
+   *
+   * The checker keeps copies of the atom coordinates: a placed residue
+   * that moves must be erased and inserted again.  Insertion and removal
+   * only touch the residue atoms, so that builders can backtrack cheaply.
+   */
+  class ClashChecker
+  {
+    /**
+     * A placed atom.
+     */
+    struct AtomEntry
+    {
+      float xyz[3];
+      float radius;
+      unsigned int residue;
+      unsigned char link;
+    };
+
+    /**
+     * A placed residue: its atoms and the positions of its linking atoms
+     * (O3', P, C, N).
+     */
+    struct ResidueEntry
+    {
+      const Residue *res;
+      vector< unsigned int > atoms;
+      float link[4][3];
+      bool hasLink[4];
+    };
+
+    /**
+     * The placed atoms, removed entries are reused.
+     */
+    vector< AtomEntry > atoms;
+
+    /**
+     * Removed atom entries.
+     */
+    vector< unsigned int > freeAtoms;
+
+    /**
+     * The placed residues, removed entries have a null residue.
+     */
+    vector< ResidueEntry > residues;
+
+    /**
+     * Removed residue entries.
+     */
+    vector< unsigned int > freeResidues;
+
+    /**
+     * Entry number of the placed residues.
+     */
+    map< const Residue*, unsigned int > residueIndex;
+
+    /**
+     * Radii set by atom type.
+     */
+    map< const AtomType*, float > radii;
+
+    /**
+     * The spatial hash: atoms of the cells hashed to each bucket.
+     */
+    vector< vector< unsigned int > > buckets;
+
+    /**
+     * Query marks on the buckets, avoiding to visit a bucket twice.
+     */
+    mutable vector< unsigned int > stamp;
+
+    /**
+     * The current query mark.
+     */
+    mutable unsigned int currentStamp;
+
+    /**
+     * The number of placed atoms.
+     */
+    unsigned int atomCount;
+
+    /**
+     * The largest radius of the placed atoms.
+     */
+    float maxRadius;
+
+    /**
+     * The clash scale factor on the sum of the radii.
+     */
+    float scale;
+
+    /**
+     * The edge of the hash cells.
+     */
+    float cell;
+
+  public:
+
+    // LIFECYCLE ------------------------------------------------------------
+
+    /**
+     * Initializes an empty checker.
+     * @param scale the fraction of the sum of the radii under which two
+     * atoms clash (default = 0.75).
+     * @param cell the edge of the hash cells (default = 4.0 Angstroms).
+     * @exception IntLibException if the scale or cell is not positive.
+     */
+    ClashChecker (float scale = 0.75, float cell = 4.0);
+
+    /**
+     * Destroys the object.
+     */
+    ~ClashChecker () { }
+
+    // ACCESS ---------------------------------------------------------------
+
+    /**
+     * Gets the number of placed residues.
+     * @return the residue count.
+     */
+    unsigned int size () const { return residueIndex.size (); }
+
+    /**
+     * Gets the number of placed atoms.
+     * @return the atom count.
+     */
+    unsigned int atomSize () const { return atomCount; }
+
+    /**
+     * Tells whether a residue is placed.
+     * @param res the residue.
+     * @return whether the residue is placed.
+     */
+    bool contains (const Residue &res) const
+    {
+      return residueIndex.end () != residueIndex.find (&res);
+    }
+
+    /**
+     * Gets the clash scale factor.
+     * @return the scale.
+     */
+    float getScale () const { return scale; }
+
+    /**
+     * Sets the van der Waals radius of an atom type, overriding
+     * AtomType::getVDWR for the atoms inserted or queried afterwards.
+     * @param type the atom type.
+     * @param radius the radius, 0 to ignore the atoms of this type.
+     */
+    void setRadius (const AtomType *type, float radius) { radii[type] = radius; }
+
+    /**
+     * Gets the radius used for an atom.
+     * @param atom the atom.
+     * @param res the residue of the atom.
+     * @return the radius, 0 when the atom is ignored.
+     */
+    float getRadius (const Atom &atom, const Residue &res) const;
+
+    // METHODS --------------------------------------------------------------
+
+    /**
+     * Adds a residue to the placed residues.
+     * @param res the residue.
+     * @exception IntLibException if the residue is already placed.
+     */
+    void insert (const Residue &res);
+
+    /**
+     * Removes a residue from the placed residues.
+     * @param res the placed residue.
+     * @exception NoSuchElementException if the residue is not placed.
+     */
+    void erase (const Residue &res);
+
+    /**
+     * Removes all placed residues.
+     */
+    void clear ();
+
+    /**
+     * Tells whether a residue clashes with the placed residues, itself
+     * excluded.  The search stops at the first clash.
+     * @param res the residue.
+     * @return whether an atom of the residue clashes.
+     */
+    bool clashes (const Residue &res) const;
+
+    /**
+     * Computes the clash score of a residue against the placed residues,
+     * itself excluded: the sum over the clashing atom pairs of the depth
+     * of the clash, in Angstroms.
+     * @param res the residue.
+     * @return the clash score, 0 without clash.
+     */
+    float getClashScore (const Residue &res) const;
+
+  private:
+
+    /**
+     * @internal
+     * Tests the residue atoms against the placed atoms.
+     * @param first whether to stop at the first clash.
+     * @return the clash score.
+     */
+    float _scan (const Residue &res, bool first) const;
+
+    /**
+     * @internal
+     * Gets the bucket of a cell.
+     */
+    unsigned int _bucket (int x, int y, int z) const;
+
+    /**
+     * @internal
+     * Gets the bucket of a point.
+     */
+    unsigned int _bucket (const float *p) const;
+
+    /**
+     * @internal
+     * Doubles the number of buckets when they get crowded.
+     */
+    void _grow ();
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,431 @@
+//                              -*- Mode: C++ -*-
+// ContactMap.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+#include <algorithm>
+#include <functional>
+#include <list>
+
+#include "Binstream.h"
+#include "ContactMap.h"
+#include "GraphModel.h"
+#include "Relation.h"
+
+
+
+namespace mccore
+{
+
+  /**
+   * @internal
+   * Merge operations of _merge.
+   */
+  static const int MERGE_UNION = 0;
+  static const int MERGE_INTERSECTION = 1;
+  static const int MERGE_DIFFERENCE = 2;
+
+  // LIFECYCLE ------------------------------------------------------------
+
+  ContactMap::ContactMap (const GraphModel &model)
+    : withDistances (false),
+      withMasks (true)
+  {
+    vector< Entry > entries;
+    GraphModel::const_iterator it;
+    GraphModel::label l;
+
+    for (it = model.begin (); model.end () != it; ++it)
+      residues.push_back (it->getResId ());
+
+    for (l = 0; l < residues.size (); ++l)
+      {
+	list< GraphModel::label > neighbours = model.internalNeighborhood (l);
+	list< GraphModel::label >::iterator nit;
+
+	for (nit = neighbours.begin (); neighbours.end () != nit; ++nit)
+	  {
+	    Entry e;
+
+	    e.first = l;
+	    e.second = *nit;
+	    e.distance = 0;
+	    e.mask = model.internalGetEdge (l, *nit)->getAnnotationType ();
+	    entries.push_back (e);
+	  }
+      }
+    _fill (entries, false, true);
+  }
+
+  // OPERATORS ------------------------------------------------------------
+
+  bool
+  ContactMap::operator== (const ContactMap &right) const
+  {
+    return (residues == right.residues
+	    && rows == right.rows
+	    && columns == right.columns
+	    && withDistances == right.withDistances
+	    && withMasks == right.withMasks
+	    && distances == right.distances
+	    && masks == right.masks);
+  }
+
+  // ACCESS ---------------------------------------------------------------
+
+  void
+  ContactMap::getContacts (unsigned int i, vector< unsigned int > &result) const
+  {
+    result.insert (result.end (), columns.begin () + rows[i], columns.begin () + rows[i + 1]);
+  }
+
+
+  void
+  ContactMap::getContacts (vector< pair< unsigned int, unsigned int > > &result) const
+  {
+    unsigned int i;
+    unsigned int k;
+
+    for (i = 0; i < residues.size (); ++i)
+      for (k = rows[i]; k < rows[i + 1]; ++k)
+	if (i < columns[k])
+	  result.push_back (make_pair (i, columns[k]));
+  }
+
+
+  bool
+  ContactMap::contains (unsigned int i, unsigned int j) const
+  {
+    return columns.size () != _find (i, j);
+  }
+
+
+  float
+  ContactMap::getDistance (unsigned int i, unsigned int j) const
+  {
+    unsigned int k = _find (i, j);
+
+    if (! withDistances || columns.size () == k)
+      {
+	NoSuchElementException ex ("", __FILE__, __LINE__);
+	ex << "no contact distance between residues " << i << " and " << j;
+	throw ex;
+      }
+    return distances[k];
+  }
+
+
+  unsigned char
+  ContactMap::getMask (unsigned int i, unsigned int j) const
+  {
+    unsigned int k = _find (i, j);
+
+    if (! withMasks || columns.size () == k)
+      {
+	NoSuchElementException ex ("", __FILE__, __LINE__);
+	ex << "no contact relation types between residues " << i << " and " << j;
+	throw ex;
+      }
+    return masks[k];
+  }
+
+  // METHODS --------------------------------------------------------------
+
+  ContactMap
+  ContactMap::getUnion (const ContactMap &right) const
+  {
+    return _merge (right, MERGE_UNION);
+  }
+
+
+  ContactMap
+  ContactMap::getIntersection (const ContactMap &right) const
+  {
+    return _merge (right, MERGE_INTERSECTION);
+  }
+
+
+  ContactMap
+  ContactMap::getDifference (const ContactMap &right) const
+  {
+    return _merge (right, MERGE_DIFFERENCE);
+  }
+
+
+  void
+  ContactMap::clear ()
+  {
+    residues.clear ();
+    rows.assign (1, 0);
+    columns.clear ();
+    distances.clear ();
+    masks.clear ();
+    withDistances = withMasks = false;
+  }
+
+
+  unsigned int
+  ContactMap::_index (const map< const void*, unsigned int > &index, const void *res)
+  {
+    map< const void*, unsigned int >::const_iterator it = index.find (res);
+
+    if (index.end () == it)
+      {
+	NoSuchElementException ex ("", __FILE__, __LINE__);
+	ex << "contact residue not in the residue range";
+	throw ex;
+      }
+    return it->second;
+  }
+
+
+  void
+  ContactMap::_fill (vector< Entry > &entries, bool dist, bool mask)
+  {
+    vector< Entry > both;
+    vector< Entry >::iterator it;
+    unsigned int i;
+
+    withDistances = dist;
+    withMasks = mask;
+
+    // -- each contact in both rows, a residue is not in contact with itself
+    both.reserve (2 * entries.size ());
+    for (it = entries.begin (); entries.end () != it; ++it)
+      if (it->first != it->second)
+	{
+	  Entry e = *it;
+
+	  both.push_back (e);
+	  swap (e.first, e.second);
+	  both.push_back (e);
+	}
+    sort (both.begin (), both.end ());
+
+    rows.assign (1, 0);
+    columns.clear ();
+    distances.clear ();
+    masks.clear ();
+
+    it = both.begin ();
+    for (i = 0; i < residues.size (); ++i)
+      {
+	for (; both.end () != it && i == it->first; ++it)
+	  if (rows.back () < columns.size () && it->second == columns.back ())
+	    {
+	      if (withDistances)
+		distances.back () = min (distances.back (), it->distance);
+	      if (withMasks)
+		masks.back () |= it->mask;
+	    }
+	  else
+	    _push (it->second, it->distance, it->mask);
+	rows.push_back (columns.size ());
+      }
+  }
+
+
+  unsigned int
+  ContactMap::_find (unsigned int i, unsigned int j) const
+  {
+    vector< unsigned int >::const_iterator last;
+    vector< unsigned int >::const_iterator it;
+
+    if (i >= residues.size ())
+      return columns.size ();
+
+    last = columns.begin () + rows[i + 1];
+    it = lower_bound (columns.begin () + rows[i], last, j);
+    return last != it && j == *it ? it - columns.begin () : columns.size ();
+  }
+
+
+  void
+  ContactMap::_push (unsigned int column, float distance, unsigned char mask)
+  {
+    columns.push_back (column);
+    if (withDistances)
+      distances.push_back (distance);
+    if (withMasks)
+      masks.push_back (mask);
+  }
+
+
+  ContactMap
+  ContactMap::_merge (const ContactMap &right, int op) const
+  {
+    ContactMap result;
+    unsigned int i;
+
+    if (residues != right.residues)
+      {
+	IntLibException ex ("", __FILE__, __LINE__);
+	ex << "contact maps over different residues (" << residues.size ()
+	   << " and " << right.residues.size () << ")";
+	throw ex;
+      }
+
+    result.residues = residues;
+    if (MERGE_DIFFERENCE == op)
+      {
+	result.withDistances = withDistances;
+	result.withMasks = withMasks;
+      }
+    else
+      {
+	result.withDistances = withDistances && right.withDistances;
+	result.withMasks = withMasks && right.withMasks;
+      }
+
+    for (i = 0; i < residues.size (); ++i)
+      {
+	unsigned int a = rows[i];
+	unsigned int b = right.rows[i];
+
+	// -- both rows are sorted, a merge finds the common partners
+	while (a < rows[i + 1] || b < right.rows[i + 1])
+	  if (right.rows[i + 1] == b
+	      || (a < rows[i + 1] && columns[a] < right.columns[b]))
+	    {
+	      if (MERGE_INTERSECTION != op)
+		result._push (columns[a],
+			      withDistances ? distances[a] : 0,
+			      withMasks ? masks[a] : 0);
+	      ++a;
+	    }
+	  else if (rows[i + 1] == a || right.columns[b] < columns[a])
+	    {
+	      if (MERGE_UNION == op)
+		result._push (right.columns[b],
+			      right.withDistances ? right.distances[b] : 0,
+			      right.withMasks ? right.masks[b] : 0);
+	      ++b;
+	    }
+	  else
+	    {
+	      if (MERGE_DIFFERENCE != op)
+		{
+		  float d = 0;
+		  unsigned char m = 0;
+
+		  if (result.withDistances)
+		    d = min (distances[a], right.distances[b]);
+		  if (result.withMasks)
+		    m = (MERGE_UNION == op
+			 ? masks[a] | right.masks[b]
+			 : masks[a] & right.masks[b]);
+		  result._push (columns[a], d, m);
+		}
+	      ++a;
+	      ++b;
+	    }
+	result.rows.push_back (result.columns.size ());
+      }
+    return result;
+  }
+
+  // I/O  -----------------------------------------------------------------
+
+  oBinstream&
+  ContactMap::write (oBinstream &obs) const
+  {
+    vector< ResId >::const_iterator rit;
+    unsigned int k;
+
+    obs << (unsigned long long) residues.size ();
+    for (rit = residues.begin (); residues.end () != rit; ++rit)
+      obs << *rit;
+    obs << withDistances << withMasks << (unsigned long long) columns.size ();
+    for (k = 0; k < rows.size (); ++k)
+      obs << rows[k];
+    for (k = 0; k < columns.size (); ++k)
+      {
+	obs << columns[k];
+	if (withDistances)
+	  obs << distances[k];
+	if (withMasks)
+	  obs << masks[k];
+      }
+    return obs;
+  }
+
+
+  iBinstream&
+  ContactMap::read (iBinstream &ibs)
+  {
+    unsigned long long sz;
+    unsigned long long count;
+    unsigned int k;
+
+    clear ();
+    ibs >> sz;
+    residues.resize (sz);
+    for (k = 0; k < sz; ++k)
+      ibs >> residues[k];
+    ibs >> withDistances >> withMasks >> count;
+    rows.resize (sz + 1);
+    for (k = 0; k < rows.size (); ++k)
+      ibs >> rows[k];
+    columns.resize (count);
+    if (withDistances)
+      distances.resize (count);
+    if (withMasks)
+      masks.resize (count);
+    for (k = 0; k < count; ++k)
+      {
+	ibs >> columns[k];
+	if (withDistances)
+	  ibs >> distances[k];
+	if (withMasks)
+	  ibs >> masks[k];
+      }
+
+    for (k = 0; k < sz; ++k)
+      if (rows[k] > rows[k + 1])
+	break;
+    if (0 != rows.front () || count != rows.back () || k < sz
+	|| columns.end () != find_if (columns.begin (), columns.end (),
+				      bind2nd (greater_equal< unsigned int > (), sz)))
+      {
+	clear ();
+	IntLibException ex ("", __FILE__, __LINE__);
+	ex << "inconsistent contact map read";
+	throw ex;
+      }
+    return ibs;
+  }
+
+
+  iBinstream&
+  operator>> (iBinstream &ibs, ContactMap &obj)
+  {
+    return obj.read (ibs);
+  }
+
+
+  oBinstream&
+  operator<< (oBinstream &obs, const ContactMap &obj)
+  {
+    return obj.write (obs);
+  }
+
+}
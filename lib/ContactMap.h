@@ -0,0 +1,411 @@
+//                              -*- Mode: C++ -*-
+// ContactMap.h
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef _mccore_ContactMap_h_
+#define _mccore_ContactMap_h_
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Exception.h"
+#include "ResId.h"
+
+using namespace std;
+
+
+
+namespace mccore
+{
+  class GraphModel;
+  class iBinstream;
+  class oBinstream;
+
+
+
+  /**
+   * @short Compressed sparse map of the contacts between residues.
+   *
+   * The residues are numbered by their position in the model.  The
+   * contacts of each residue are stored in compressed rows (CSR): the
+   * partners of residue i are columns [rows[i], rows[i+1]), sorted.  A
+   * contact appears in the rows of both residues.  Each contact may carry
+   * a distance and a relation type bitmask (Relation::adjacent_mask,
+   * stacking_mask, pairing_mask, bhbond_mask).
+   *
+   * The map holds residue ids only and does not depend on the model once
+   * built.  Maps of the models of an ensemble, having the same residues,
+   * can be combined by union, intersection and difference.
+   */
+  class ContactMap
+  {
+    /**
+     * A contact being built: residues, distance and relation types.
+     */
+    struct Entry
+    {
+      unsigned int first;
+      unsigned int second;
+      float distance;
+      unsigned char mask;
+
+      bool operator< (const Entry &right) const
+      {
+	return (first < right.first
+		|| (first == right.first && second < right.second));
+      }
+    };
+
+    /**
+     * The residue ids, by position.
+     */
+    vector< ResId > residues;
+
+    /**
+     * The first column of each row, plus a sentinel.
+     */
+    vector< unsigned int > rows;
+
+    /**
+     * The partners of each residue.
+     */
+    vector< unsigned int > columns;
+
+    /**
+     * The contact distances, parallel to columns if withDistances.
+     */
+    vector< float > distances;
+
+    /**
+     * The relation type bitmasks, parallel to columns if withMasks.
+     */
+    vector< unsigned char > masks;
+
+    /**
+     * Whether the contacts carry distances.
+     */
+    bool withDistances;
+
+    /**
+     * Whether the contacts carry relation types.
+     */
+    bool withMasks;
+
+  public:
+
+    // LIFECYCLE ------------------------------------------------------------
+
+    /**
+     * Initializes an empty map.
+     */
+    ContactMap () : rows (1, 0), withDistances (false), withMasks (false) { }
+
+    /**
+     * Initializes the map from the contacts found by
+     * Algo::extractContacts over [begin, end).
+     * @param begin an iterator on a collection of Residue.
+     * @param end an iterator on a collection of Residue.
+     * @param contacts the contacts between residues of the range.
+     * @exception NoSuchElementException if a contact residue is not in
+     * the range.
+     */
+    template< class iter_type >
+    ContactMap (iter_type begin, iter_type end, const vector< pair< iter_type, iter_type > > &contacts)
+      : withDistances (false),
+	withMasks (false)
+    {
+      _build (begin, end, contacts, (const vector< float >*) 0);
+    }
+
+    /**
+     * Initializes the map from the contacts refined by
+     * Algo::refineContacts over [begin, end), with their distances.
+     * @param begin an iterator on a collection of Residue.
+     * @param end an iterator on a collection of Residue.
+     * @param contacts the contacts between residues of the range.
+     * @param dist the distance of each contact.
+     * @exception NoSuchElementException if a contact residue is not in
+     * the range.
+     */
+    template< class iter_type >
+    ContactMap (iter_type begin, iter_type end, const vector< pair< iter_type, iter_type > > &contacts, const vector< float > &dist)
+      : withDistances (false),
+	withMasks (false)
+    {
+      _build (begin, end, contacts, &dist);
+    }
+
+    /**
+     * Initializes the map from the relations of an annotated model, with
+     * their relation types.  The relations in both directions make a
+     * single contact.
+     * @param model the model.
+     */
+    ContactMap (const GraphModel &model);
+
+    /**
+     * Destroys the object.
+     */
+    ~ContactMap () { }
+
+    // OPERATORS ------------------------------------------------------------
+
+    /**
+     * Tests whether two maps have the same residues and contacts, with
+     * the same distances and relation types.
+     * @param right the other map.
+     * @return whether the maps are equal.
+     */
+    bool operator== (const ContactMap &right) const;
+
+    /**
+     * Tests whether two maps differ.
+     * @param right the other map.
+     * @return whether the maps differ.
+     */
+    bool operator!= (const ContactMap &right) const { return ! operator== (right); }
+
+    // ACCESS ---------------------------------------------------------------
+
+    /**
+     * Gets the number of residues.
+     * @return the residue count.
+     */
+    unsigned int size () const { return residues.size (); }
+
+    /**
+     * Gets the number of contacts, each counted once.
+     * @return the contact count.
+     */
+    unsigned int contactSize () const { return columns.size () / 2; }
+
+    /**
+     * Tells whether the contacts carry distances.
+     * @return whether there are distances.
+     */
+    bool hasDistances () const { return withDistances; }
+
+    /**
+     * Tells whether the contacts carry relation types.
+     * @return whether there are relation types.
+     */
+    bool hasMasks () const { return withMasks; }
+
+    /**
+     * Gets the id of a residue.
+     * @param i the residue position.
+     * @return the residue id.
+     */
+    const ResId& getResId (unsigned int i) const { return residues[i]; }
+
+    /**
+     * Gets the number of contacts of a residue.
+     * @param i the residue position.
+     * @return the contact count.
+     */
+    unsigned int getDegree (unsigned int i) const { return rows[i + 1] - rows[i]; }
+
+    /**
+     * Gets the partners of a residue, sorted.
+     * @param i the residue position.
+     * @param result the partner positions, appended.
+     */
+    void getContacts (unsigned int i, vector< unsigned int > &result) const;
+
+    /**
+     * Gets all the contacts, each once as (i, j) with i < j, sorted.
+     * @param result the contacts, appended.
+     */
+    void getContacts (vector< pair< unsigned int, unsigned int > > &result) const;
+
+    /**
+     * Tells whether two residues are in contact.
+     * @param i a residue position.
+     * @param j a residue position.
+     * @return whether the residues are in contact.
+     */
+    bool contains (unsigned int i, unsigned int j) const;
+
+    /**
+     * Gets the distance of a contact.
+     * @param i a residue position.
+     * @param j a residue position.
+     * @return the distance.
+     * @exception NoSuchElementException if the residues are not in contact
+     * or the map has no distances.
+     */
+    float getDistance (unsigned int i, unsigned int j) const;
+
+    /**
+     * Gets the relation types of a contact.
+     * @param i a residue position.
+     * @param j a residue position.
+     * @return the relation type bitmask.
+     * @exception NoSuchElementException if the residues are not in contact
+     * or the map has no relation types.
+     */
+    unsigned char getMask (unsigned int i, unsigned int j) const;
+
+    // METHODS --------------------------------------------------------------
+
+    /**
+     * Gets the contacts of either map.  A contact in both maps gets the
+     * smaller distance and the union of the relation types.  The result
+     * has distances or relation types if both maps have them.
+     * @param right the other map.
+     * @return the union.
+     * @exception IntLibException if the maps have different residues.
+     */
+    ContactMap getUnion (const ContactMap &right) const;
+
+    /**
+     * Gets the contacts of both maps, with the smaller distance and the
+     * common relation types.  The result has distances or relation types
+     * if both maps have them.
+     * @param right the other map.
+     * @return the intersection.
+     * @exception IntLibException if the maps have different residues.
+     */
+    ContactMap getIntersection (const ContactMap &right) const;
+
+    /**
+     * Gets the contacts of this map absent from the other map, with their
+     * distances and relation types.
+     * @param right the other map.
+     * @return the difference.
+     * @exception IntLibException if the maps have different residues.
+     */
+    ContactMap getDifference (const ContactMap &right) const;
+
+    /**
+     * Removes the residues and contacts.
+     */
+    void clear ();
+
+    // I/O  -----------------------------------------------------------------
+
+    /**
+     * Writes the map to a binary stream.
+     * @param obs the output binstream.
+     * @return the written binstream.
+     */
+    oBinstream& write (oBinstream &obs) const;
+
+    /**
+     * Reads the map from a binary stream.
+     * @param ibs the input binstream.
+     * @return the read binstream.
+     * @exception IntLibException if the map read is inconsistent.
+     */
+    iBinstream& read (iBinstream &ibs);
+
+  private:
+
+    /**
+     * @internal
+     * Numbers the residues of a range and builds the map from contacts
+     * between them.
+     */
+    template< class iter_type >
+    void _build (iter_type begin, iter_type end, const vector< pair< iter_type, iter_type > > &contacts, const vector< float > *dist)
+    {
+      map< const void*, unsigned int > index;
+      map< const void*, unsigned int >::iterator it;
+      vector< Entry > entries;
+      unsigned int n;
+      iter_type i;
+
+      for (i = begin; end != i; ++i)
+	{
+	  index.insert (make_pair ((const void*) &*i, residues.size ()));
+	  residues.push_back ((*i).getResId ());
+	}
+
+      for (n = 0; n < contacts.size (); ++n)
+	{
+	  Entry e;
+
+	  e.first = _index (index, &*contacts[n].first);
+	  e.second = _index (index, &*contacts[n].second);
+	  e.distance = 0 == dist ? 0 : (*dist)[n];
+	  e.mask = 0;
+	  entries.push_back (e);
+	}
+      _fill (entries, 0 != dist, false);
+    }
+
+    /**
+     * @internal
+     * Gets the position of a residue.
+     * @exception NoSuchElementException if the residue is not numbered.
+     */
+    static unsigned int _index (const map< const void*, unsigned int > &index, const void *res);
+
+    /**
+     * @internal
+     * Fills the rows from contacts, each given in either direction or
+     * both.  Duplicates are merged.
+     */
+    void _fill (vector< Entry > &entries, bool dist, bool mask);
+
+    /**
+     * @internal
+     * Gets the position of a contact in columns.
+     * @return the position, columns.size () if absent.
+     */
+    unsigned int _find (unsigned int i, unsigned int j) const;
+
+    /**
+     * @internal
+     * Appends a contact to the last row, with the attributes the map
+     * carries.
+     */
+    void _push (unsigned int column, float distance, unsigned char mask);
+
+    /**
+     * @internal
+     * Merges the rows of two maps.
+     * @param op 0 for union, 1 for intersection, 2 for difference.
+     */
+    ContactMap _merge (const ContactMap &right, int op) const;
+
+  };
+
+  /**
+   * Reads a map from a binary stream.
+   * @param ibs the input binstream.
+   * @param obj the map read.
+   * @return the read binstream.
+   */
+  iBinstream& operator>> (iBinstream &ibs, ContactMap &obj);
+
+  /**
+   * Writes a map to a binary stream.
+   * @param obs the output binstream.
+   * @param obj the map to write.
+   * @return the written binstream.
+   */
+  oBinstream& operator<< (oBinstream &obs, const ContactMap &obj);
+
+}
+
+#endif
@@ -0,0 +1,446 @@
+//                              -*- Mode: C++ -*-
+// ContactTracker.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "ContactTracker.h"
+#include "Residue.h"
+
+
+
+namespace mccore
+{
+
+  /**
+   * @internal
+   * Initial number of buckets of the spatial hash.
+   */
+  static const unsigned int INITIAL_BUCKETS = 64;
+
+
+  /**
+   * @internal
+   * Tests the overlap of two boxes along an axis within cutoff, as the
+   * contact engines of Algo do.
+   */
+  static bool
+  _overlap (float la, float ua, float lb, float ub, float cutoff)
+  {
+    return la < lb ? lb - cutoff <= ua : la - cutoff <= ub;
+  }
+
+
+  /**
+   * @internal
+   * Inserts a value in a sorted vector.
+   */
+  static void
+  _sorted_insert (vector< unsigned int > &v, unsigned int n)
+  {
+    v.insert (lower_bound (v.begin (), v.end (), n), n);
+  }
+
+
+  /**
+   * @internal
+   * Removes a value from a sorted vector.
+   */
+  static void
+  _sorted_erase (vector< unsigned int > &v, unsigned int n)
+  {
+    vector< unsigned int >::iterator it = lower_bound (v.begin (), v.end (), n);
+
+    if (v.end () != it && n == *it)
+      v.erase (it);
+  }
+
+  // LIFECYCLE ------------------------------------------------------------
+
+  ContactTracker::ContactTracker (float co, float c)
+    : buckets (INITIAL_BUCKETS),
+      currentStamp (0),
+      hashedCells (0),
+      nextSerial (0),
+      contactCount (0),
+      cutoff (co),
+      cell (c)
+  {
+    if (0 >= cell)
+      {
+	IntLibException ex ("", __FILE__, __LINE__);
+	ex << "invalid hash cell size " << cell;
+	throw ex;
+      }
+  }
+
+  // ACCESS ---------------------------------------------------------------
+
+  void
+  ContactTracker::getContacts (const Residue &res, vector< const Residue* > &result) const
+  {
+    const Entry &e = entries[_entry (res)];
+    vector< pair< unsigned int, const Residue* > > found;
+    vector< pair< unsigned int, const Residue* > >::iterator fit;
+    vector< unsigned int >::const_iterator it;
+
+    for (it = e.partners.begin (); e.partners.end () != it; ++it)
+      found.push_back (make_pair (entries[*it].serial, entries[*it].res));
+    sort (found.begin (), found.end ());
+    for (fit = found.begin (); found.end () != fit; ++fit)
+      result.push_back (fit->second);
+  }
+
+
+  void
+  ContactTracker::getContacts (vector< ResiduePair > &result) const
+  {
+    vector< pair< pair< unsigned int, unsigned int >, ResiduePair > > found;
+    vector< pair< pair< unsigned int, unsigned int >, ResiduePair > >::iterator fit;
+    unsigned int n;
+
+    for (n = 0; n < entries.size (); ++n)
+      {
+	const Entry &a = entries[n];
+	vector< unsigned int >::const_iterator it;
+
+	for (it = a.partners.begin (); a.partners.end () != it; ++it)
+	  {
+	    const Entry &b = entries[*it];
+
+	    if (a.serial < b.serial)
+	      found.push_back (make_pair (make_pair (a.serial, b.serial), make_pair (a.res, b.res)));
+	  }
+      }
+    sort (found.begin (), found.end ());
+    for (fit = found.begin (); found.end () != fit; ++fit)
+      result.push_back (fit->second);
+  }
+
+  // METHODS --------------------------------------------------------------
+
+  void
+  ContactTracker::insert (const Residue &res, vector< ResiduePair > &added)
+  {
+    vector< unsigned int >::iterator it;
+    unsigned int n;
+
+    if (contains (res))
+      {
+	IntLibException ex ("", __FILE__, __LINE__);
+	ex << "residue " << res.getResId () << " is already tracked";
+	throw ex;
+      }
+
+    if (freeEntries.empty ())
+      {
+	n = entries.size ();
+	entries.push_back (Entry ());
+	stamp.push_back (0);
+      }
+    else
+      {
+	n = freeEntries.back ();
+	freeEntries.pop_back ();
+      }
+    entryIndex.insert (make_pair (&res, n));
+
+    Entry &e = entries[n];
+
+    e.res = &res;
+    e.serial = nextSerial++;
+    _box (e);
+    _hash (n, true);
+    _grow ();
+
+    _query (n, e.partners);
+    for (it = e.partners.begin (); e.partners.end () != it; ++it)
+      {
+	_sorted_insert (entries[*it].partners, n);
+	added.push_back (_pair (n, *it));
+      }
+    contactCount += e.partners.size ();
+  }
+
+
+  void
+  ContactTracker::move (const Residue &res, vector< ResiduePair > &added, vector< ResiduePair > &removed)
+  {
+    unsigned int n = _entry (res);
+    Entry &e = entries[n];
+    vector< unsigned int > partners;
+    vector< unsigned int >::iterator oit;
+    vector< unsigned int >::iterator nit;
+
+    _hash (n, false);
+    _box (e);
+    _hash (n, true);
+    _grow ();
+
+    // -- both contact lists are sorted, a merge gives the differences
+    _query (n, partners);
+    oit = e.partners.begin ();
+    nit = partners.begin ();
+    while (e.partners.end () != oit || partners.end () != nit)
+      {
+	if (partners.end () == nit || (e.partners.end () != oit && *oit < *nit))
+	  {
+	    _sorted_erase (entries[*oit].partners, n);
+	    removed.push_back (_pair (n, *oit));
+	    --contactCount;
+	    ++oit;
+	  }
+	else if (e.partners.end () == oit || *nit < *oit)
+	  {
+	    _sorted_insert (entries[*nit].partners, n);
+	    added.push_back (_pair (n, *nit));
+	    ++contactCount;
+	    ++nit;
+	  }
+	else
+	  {
+	    ++oit;
+	    ++nit;
+	  }
+      }
+    e.partners.swap (partners);
+  }
+
+
+  void
+  ContactTracker::erase (const Residue &res, vector< ResiduePair > &removed)
+  {
+    unsigned int n = _entry (res);
+    Entry &e = entries[n];
+    vector< unsigned int >::iterator it;
+
+    for (it = e.partners.begin (); e.partners.end () != it; ++it)
+      {
+	_sorted_erase (entries[*it].partners, n);
+	removed.push_back (_pair (n, *it));
+      }
+    contactCount -= e.partners.size ();
+    e.partners.clear ();
+
+    _hash (n, false);
+    entryIndex.erase (&res);
+    e.res = 0;
+    freeEntries.push_back (n);
+  }
+
+
+  void
+  ContactTracker::clear ()
+  {
+    entries.clear ();
+    freeEntries.clear ();
+    entryIndex.clear ();
+    buckets.clear ();
+    buckets.resize (INITIAL_BUCKETS);
+    stamp.clear ();
+    currentStamp = 0;
+    hashedCells = 0;
+    nextSerial = 0;
+    contactCount = 0;
+  }
+
+
+  void
+  ContactTracker::swap (ContactTracker &other)
+  {
+    entries.swap (other.entries);
+    freeEntries.swap (other.freeEntries);
+    entryIndex.swap (other.entryIndex);
+    buckets.swap (other.buckets);
+    stamp.swap (other.stamp);
+    std::swap (currentStamp, other.currentStamp);
+    std::swap (hashedCells, other.hashedCells);
+    std::swap (nextSerial, other.nextSerial);
+    std::swap (contactCount, other.contactCount);
+    std::swap (cutoff, other.cutoff);
+    std::swap (cell, other.cell);
+  }
+
+
+  unsigned int
+  ContactTracker::_entry (const Residue &res) const
+  {
+    map< const Residue*, unsigned int >::const_iterator it = entryIndex.find (&res);
+
+    if (entryIndex.end () == it)
+      {
+	NoSuchElementException ex ("", __FILE__, __LINE__);
+	ex << "residue " << res.getResId () << " is not tracked";
+	throw ex;
+      }
+    return it->second;
+  }
+
+
+  void
+  ContactTracker::_box (Entry &e) const
+  {
+    Vector3D lower;
+    Vector3D upper;
+    unsigned int k;
+
+    e.res->getBoundingBox (lower, upper);
+    e.lower[0] = lower.getX ();
+    e.lower[1] = lower.getY ();
+    e.lower[2] = lower.getZ ();
+    e.upper[0] = upper.getX ();
+    e.upper[1] = upper.getY ();
+    e.upper[2] = upper.getZ ();
+
+    // -- a residue without atom covers no cell
+    for (k = 0; k < 3; ++k)
+      if (e.lower[k] > e.upper[k])
+	{
+	  e.cellLower[k] = 0;
+	  e.cellUpper[k] = -1;
+	}
+      else
+	{
+	  e.cellLower[k] = (int) floor (e.lower[k] / cell);
+	  e.cellUpper[k] = (int) floor (e.upper[k] / cell);
+	}
+  }
+
+
+  unsigned int
+  ContactTracker::_bucket (int x, int y, int z) const
+  {
+    unsigned int h = ((unsigned int) x * 73856093u)
+      ^ ((unsigned int) y * 19349663u)
+      ^ ((unsigned int) z * 83492791u);
+
+    return h % buckets.size ();
+  }
+
+
+  void
+  ContactTracker::_hash (unsigned int n, bool add)
+  {
+    const Entry &e = entries[n];
+    int x, y, z;
+
+    for (x = e.cellLower[0]; x <= e.cellUpper[0]; ++x)
+      for (y = e.cellLower[1]; y <= e.cellUpper[1]; ++y)
+	for (z = e.cellLower[2]; z <= e.cellUpper[2]; ++z)
+	  {
+	    vector< unsigned int > &b = buckets[_bucket (x, y, z)];
+
+	    if (add)
+	      {
+		b.push_back (n);
+		++hashedCells;
+	      }
+	    else
+	      {
+		vector< unsigned int >::iterator it = find (b.begin (), b.end (), n);
+
+		*it = b.back ();
+		b.pop_back ();
+		--hashedCells;
+	      }
+	  }
+  }
+
+
+  void
+  ContactTracker::_grow ()
+  {
+    if (hashedCells > 2 * buckets.size ())
+      {
+	unsigned int n;
+
+	buckets.clear ();
+	buckets.resize (4 * hashedCells);
+	hashedCells = 0;
+	for (n = 0; n < entries.size (); ++n)
+	  if (0 != entries[n].res)
+	    _hash (n, true);
+      }
+  }
+
+
+  void
+  ContactTracker::_query (unsigned int n, vector< unsigned int > &result) const
+  {
+    const Entry &a = entries[n];
+    // -- widens the visited cells by a hair for rounding in the exact test
+    float margin = cutoff + cell * 1e-3f;
+    int lo[3];
+    int hi[3];
+    int x, y, z;
+    unsigned int k;
+
+    result.clear ();
+    if (a.cellLower[0] > a.cellUpper[0])
+      return;
+
+    if (0 == ++currentStamp)
+      {
+	fill (stamp.begin (), stamp.end (), 0);
+	currentStamp = 1;
+      }
+    stamp[n] = currentStamp;
+
+    for (k = 0; k < 3; ++k)
+      {
+	lo[k] = (int) floor ((a.lower[k] - margin) / cell);
+	hi[k] = (int) floor ((a.upper[k] + margin) / cell);
+      }
+    for (x = lo[0]; x <= hi[0]; ++x)
+      for (y = lo[1]; y <= hi[1]; ++y)
+	for (z = lo[2]; z <= hi[2]; ++z)
+	  {
+	    const vector< unsigned int > &b = buckets[_bucket (x, y, z)];
+	    vector< unsigned int >::const_iterator it;
+
+	    for (it = b.begin (); b.end () != it; ++it)
+	      if (currentStamp != stamp[*it])
+		{
+		  const Entry &e = entries[*it];
+
+		  stamp[*it] = currentStamp;
+		  if (_overlap (a.lower[0], a.upper[0], e.lower[0], e.upper[0], cutoff)
+		      && _overlap (a.lower[1], a.upper[1], e.lower[1], e.upper[1], cutoff)
+		      && _overlap (a.lower[2], a.upper[2], e.lower[2], e.upper[2], cutoff))
+		    result.push_back (*it);
+		}
+	  }
+    sort (result.begin (), result.end ());
+  }
+
+
+  ContactTracker::ResiduePair
+  ContactTracker::_pair (unsigned int a, unsigned int b) const
+  {
+    if (entries[a].serial < entries[b].serial)
+      return make_pair (entries[a].res, entries[b].res);
+    return make_pair (entries[b].res, entries[a].res);
+  }
+
+}
@@ -0,0 +1,285 @@
+//                              -*- Mode: C++ -*-
+// ContactTracker.h
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef _mccore_ContactTracker_h_
+#define _mccore_ContactTracker_h_
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Exception.h"
+
+using namespace std;
+
+
+
+namespace mccore
+{
+  class Residue;
+
+
+
+  /**
+   * @short Residue contacts maintained while residues move.
+   *
+   * The tracker keeps the bounding box of each residue (pseudo-atoms
+   * excluded) in a spatial hash of cubic cells.  Two residues are in
+   * contact when their boxes overlap within the cutoff, the same test as
+   * Algo::extractContacts.  Inserting, moving or removing a residue only
+   * visits the cells around its box and reports the contacts gained and
+   * lost.
+   *
+   * Contact pairs are ordered by insertion: the residue inserted first
+   * comes first.  The tracked residues must outlive the tracker or be
+   * removed from it.
+   */
+  class ContactTracker
+  {
+  public:
+
+    typedef pair< const Residue*, const Residue* > ResiduePair;
+
+  private:
+
+    /**
+     * A tracked residue: its insertion serial, its box, the cells covered
+     * by the box and its contacts, sorted by entry number.
+     */
+    struct Entry
+    {
+      const Residue *res;
+      unsigned int serial;
+      float lower[3];
+      float upper[3];
+      int cellLower[3];
+      int cellUpper[3];
+      vector< unsigned int > partners;
+    };
+
+    /**
+     * The tracked residues, removed entries have a null residue.
+     */
+    vector< Entry > entries;
+
+    /**
+     * Removed entries available for reuse.
+     */
+    vector< unsigned int > freeEntries;
+
+    /**
+     * Entry number of the tracked residues.
+     */
+    map< const Residue*, unsigned int > entryIndex;
+
+    /**
+     * The spatial hash: entries covering the cells hashed to each bucket.
+     */
+    vector< vector< unsigned int > > buckets;
+
+    /**
+     * Query marks on the entries, avoiding to test a candidate twice.
+     */
+    mutable vector< unsigned int > stamp;
+
+    /**
+     * The current query mark.
+     */
+    mutable unsigned int currentStamp;
+
+    /**
+     * The number of cells stored in the buckets.
+     */
+    unsigned int hashedCells;
+
+    /**
+     * The serial of the next inserted residue.
+     */
+    unsigned int nextSerial;
+
+    /**
+     * The number of contacts.
+     */
+    unsigned int contactCount;
+
+    /**
+     * The contact cutoff.
+     */
+    float cutoff;
+
+    /**
+     * The edge of the hash cells.
+     */
+    float cell;
+
+  public:
+
+    // LIFECYCLE ------------------------------------------------------------
+
+    /**
+     * Initializes an empty tracker.
+     * @param cutoff on the distance between boxes for a contact (default =
+     * 5.0 Angstroms).
+     * @param cell the edge of the hash cells, about the size of a residue
+     * (default = 10.0 Angstroms).
+     * @exception IntLibException if the cell is not positive.
+     */
+    ContactTracker (float cutoff = 5.0, float cell = 10.0);
+
+    /**
+     * Destroys the object.
+     */
+    ~ContactTracker () { }
+
+    // ACCESS ---------------------------------------------------------------
+
+    /**
+     * Gets the number of tracked residues.
+     * @return the residue count.
+     */
+    unsigned int size () const { return entryIndex.size (); }
+
+    /**
+     * Gets the number of contacts.
+     * @return the contact count.
+     */
+    unsigned int contactSize () const { return contactCount; }
+
+    /**
+     * Gets the contact cutoff.
+     * @return the cutoff.
+     */
+    float getCutoff () const { return cutoff; }
+
+    /**
+     * Tells whether a residue is tracked.
+     * @param res the residue.
+     * @return whether the residue is tracked.
+     */
+    bool contains (const Residue &res) const
+    {
+      return entryIndex.end () != entryIndex.find (&res);
+    }
+
+    /**
+     * Gets the residues in contact with a tracked residue, by insertion
+     * order.
+     * @param res the tracked residue.
+     * @param result the residues, appended.
+     * @exception NoSuchElementException if the residue is not tracked.
+     */
+    void getContacts (const Residue &res, vector< const Residue* > &result) const;
+
+    /**
+     * Gets all contacts, by insertion order.
+     * @param result the contacts, appended.
+     */
+    void getContacts (vector< ResiduePair > &result) const;
+
+    // METHODS --------------------------------------------------------------
+
+    /**
+     * Starts tracking a residue.
+     * @param res the residue.
+     * @param added the contacts gained, appended.
+     * @exception IntLibException if the residue is already tracked.
+     */
+    void insert (const Residue &res, vector< ResiduePair > &added);
+
+    /**
+     * Updates the box of a tracked residue after it was moved or modified.
+     * @param res the tracked residue.
+     * @param added the contacts gained, appended.
+     * @param removed the contacts lost, appended.
+     * @exception NoSuchElementException if the residue is not tracked.
+     */
+    void move (const Residue &res, vector< ResiduePair > &added, vector< ResiduePair > &removed);
+
+    /**
+     * Stops tracking a residue.
+     * @param res the tracked residue.
+     * @param removed the contacts lost, appended.
+     * @exception NoSuchElementException if the residue is not tracked.
+     */
+    void erase (const Residue &res, vector< ResiduePair > &removed);
+
+    /**
+     * Stops tracking all residues.
+     */
+    void clear ();
+
+    /**
+     * Exchanges the contents of two trackers without copying them.
+     * @param other the tracker to exchange with.
+     */
+    void swap (ContactTracker &other);
+
+  private:
+
+    /**
+     * @internal
+     * Gets the entry number of a tracked residue.
+     * @exception NoSuchElementException if the residue is not tracked.
+     */
+    unsigned int _entry (const Residue &res) const;
+
+    /**
+     * @internal
+     * Computes the box of an entry and the cells it covers.
+     */
+    void _box (Entry &e) const;
+
+    /**
+     * @internal
+     * Gets the bucket of a cell.
+     */
+    unsigned int _bucket (int x, int y, int z) const;
+
+    /**
+     * @internal
+     * Adds or removes an entry from the buckets of its cells.
+     */
+    void _hash (unsigned int n, bool add);
+
+    /**
+     * @internal
+     * Doubles the number of buckets when they get crowded.
+     */
+    void _grow ();
+
+    /**
+     * @internal
+     * Finds the entries in contact with an entry, sorted.
+     */
+    void _query (unsigned int n, vector< unsigned int > &result) const;
+
+    /**
+     * @internal
+     * Orders a contact by insertion.
+     */
+    ResiduePair _pair (unsigned int a, unsigned int b) const;
+
+  };
+
+}
+
+#endif
@@ -35,6 +35,8 @@
 
 #define DEBUG 1
 
+#define PLACE_BLOCK_SIZE 64
+
 
 namespace mccore
 {
@@ -44,12 +46,7 @@ namespace mccore
       : Residue (t, i, vec),
 	placed (true)
   {
-    vector< Atom* >::const_iterator cit;
-    
-    for (this->atomGlobal.begin (); cit != this->atomGlobal.end (); ++cit)
-    {
-    	this->atomLocal.push_back ((*cit)->clone ());
-    }
+    this->_reset_local ();
   }
 
 
@@ -58,17 +55,7 @@ namespace mccore
       referential (exres.referential),
       placed (exres.placed)
   {
-    // global atoms are set in base class Residue.
-
-    vector< Atom* >::iterator cit;
-
-    this->atomLocal = exres.atomLocal;
-
-    // harden atoms
-    for (cit = this->atomLocal.begin (); cit != this->atomLocal.end (); ++cit)
-    {
-      *cit = (*cit)->clone ();
-    }
+    // global and local atoms are shared in base class Residue.
   }
 
 
@@ -78,18 +65,7 @@ namespace mccore
     const ExtendedResidue* vptr = dynamic_cast< const ExtendedResidue* > (&res);
 
     if (0 == vptr)
-    {
-      // -- default init for ExtendedResidue members
-
-      vector< Atom* >::const_iterator cit;
-
-      for (cit = this->atomGlobal.begin (); cit != this->atomGlobal.end (); ++cit)
-      {
-         this->atomLocal.push_back ((*cit)->clone ());
-      }
-
-      this->placed = true; // because referential is identity
-    }
+      this->_reset_local (); // default init for ExtendedResidue members
     else
       this->ExtendedResidue::_assign (*vptr);
   }
@@ -97,12 +73,7 @@ namespace mccore
 
   ExtendedResidue::~ExtendedResidue ()
   {
-    vector< Atom* >::iterator it;
-
-    for (it = this->atomLocal.begin (); it != this->atomLocal.end (); ++it)
-    {
-      delete *it;
-    }
+    // local atoms are deleted with the atom storage.
   }
 
   // VIRTUAL ASSIGNATION --------------------------------------------------
@@ -117,21 +88,7 @@ namespace mccore
       this->Residue::_assign (res);
 
       if (0 == vptr)
-      {
-	// -- fix local atoms with new globals, referential becomes identity
-
-	vector< Atom* >::const_iterator cit;
-
-	this->atomLocal.clear ();
-
-	for (cit = this->atomGlobal.begin (); cit != this->atomGlobal.end (); ++cit)
-	{
-	  this->atomLocal.push_back ((*cit)->clone ());
-	}
-
-	this->referential.setIdentity ();
-	this->placed = true;
-      }
+	this->_reset_local (); // fix local atoms with new globals
       else
 	this->ExtendedResidue::_assign (*vptr);
     }
@@ -139,19 +96,26 @@ namespace mccore
   }
 
 
-  void 
-  ExtendedResidue::_assign (const ExtendedResidue& exres)
+  void
+  ExtendedResidue::swap (Residue &res)
   {
-    vector< Atom* >::iterator it;
-    vector< Atom* >::const_iterator cit;
-
-    this->atomLocal.clear ();
+    ExtendedResidue* vptr = dynamic_cast< ExtendedResidue* > (&res);
 
-    for (cit = exres.atomLocal.begin (); cit != exres.atomLocal.end (); ++cit)
+    if (0 == vptr)
+      this->Residue::swap (res);
+    else if (this != vptr)
     {
-      this->atomLocal.push_back ((*cit)->clone ());
+      this->Residue::_swap (*vptr);
+      std::swap (this->referential, vptr->referential);
+      std::swap (this->placed, vptr->placed);
     }
+  }
 
+
+  void 
+  ExtendedResidue::_assign (const ExtendedResidue& exres)
+  {
+    // local atoms are shared by Residue::_assign.
     this->referential = exres.referential;
     this->placed = exres.placed;
   }
@@ -176,45 +140,52 @@ namespace mccore
   void
   ExtendedResidue::setReferential (const HomogeneousTransfo& m)
   {
+    this->_detach ();
     this->referential = m;
     this->placed = false;
+    this->_invalidate_referential ();
   }
 
 
   void
   ExtendedResidue::transform (const HomogeneousTransfo& m)
   {
+    this->_detach ();
     this->referential = m * this->referential;
     this->placed = false;
+    this->_invalidate_referential ();
   }
 
   
   void 
   ExtendedResidue::insert (const Atom &atom)
   {
+    this->_detach ();
+
     int pos = size ();
     pair< AtomMap::iterator, bool > inserted =
-      atomIndex.insert (make_pair (atom.getType (), pos));
+      store->atomIndex.insert (make_pair (atom.getType (), pos));
 
     if (inserted.second)
       {
-	atomGlobal.push_back (atom.clone ());
-	atomLocal.push_back (atom.clone ());
+	store->atomGlobal.push_back (atom.clone ());
+	store->atomLocal.push_back (atom.clone ());
 	rib_dirty_ref = true;
       }
     else
       {
-    	*atomGlobal[inserted.first->second] = atom;
-    	*atomLocal[inserted.first->second] = atom;
+    	*store->atomGlobal[inserted.first->second] = atom;
+    	*store->atomLocal[inserted.first->second] = atom;
       }
 
-    atomLocal[inserted.first->second]->transform (referential.invert ());
+    store->atomLocal[inserted.first->second]->transform (this->getReferentialInverse ());
   }
 
 
   ExtendedResidue::iterator 
   ExtendedResidue::erase (const iterator& rit)
   { 
+    // a mutable iterator was handed out, the atom storage is not shared.
     if (this->end () != rit)
     {
       vector< Atom* >::iterator avit;
@@ -225,6 +196,7 @@ namespace mccore
 
       // -- invalidate ribose pointers
       this->rib_dirty_ref = true;
+      this->_invalidate_geometry ();
       
       // -- get type for the following atom.
       iterator nrit = rit + 1;
@@ -232,22 +204,22 @@ namespace mccore
 	atype = nrit.pos->first;
       
       // -- delete the indexed atom
-      avit = this->atomGlobal.begin () + rit.pos->second;
+      avit = this->store->atomGlobal.begin () + rit.pos->second;
       delete *avit;
-      this->atomGlobal.erase (avit);
-      avit = this->atomLocal.begin () + rit.pos->second;
+      this->store->atomGlobal.erase (avit);
+      avit = this->store->atomLocal.begin () + rit.pos->second;
       delete *avit;
-      this->atomLocal.erase (avit);
+      this->store->atomLocal.erase (avit);
 
       // -- recreate the atom index
-      this->atomIndex.clear ();
-      for (cavit = this->atomGlobal.begin (); cavit != this->atomGlobal.end (); ++cavit)
-	this->atomIndex.insert (make_pair ((*cavit)->getType (), index++));
+      this->store->atomIndex.clear ();
+      for (cavit = this->store->atomGlobal.begin (); cavit != this->store->atomGlobal.end (); ++cavit)
+	this->store->atomIndex.insert (make_pair ((*cavit)->getType (), index++));
 
       if (atype)
       {
 	// -- retrieve the appropriate iterator following the deletion point.
-	if (this->atomIndex.end () == (next_position = this->atomIndex.find (atype)))
+	if (this->store->atomIndex.end () == (next_position = this->store->atomIndex.find (atype)))
 	{
 	  FatalIntLibException ex ("", __FILE__, __LINE__);
 	  ex << "failed to erase atom " << rit.pos->first << " from " << *this;
@@ -264,13 +236,6 @@ namespace mccore
   void 
   ExtendedResidue::clear ()
   {
-    vector< Atom* >::iterator it;
-
-    for (it = atomLocal.begin (); it != atomLocal.end (); ++it)
-      {
-	delete *it;
-      }
-    atomLocal.clear ();
     referential.setIdentity ();
     Residue::clear ();
   }
@@ -281,30 +246,52 @@ namespace mccore
   {
     unsigned int i;
 
+    this->_detach ();
+
     // set pseudo-atoms
     this->Residue::finalize ();
 
     // set referential
     this->referential = this->_compute_referential ();
+    this->_invalidate_referential ();
 
     // set local atoms in referential's origin
-    HomogeneousTransfo inv = this->referential.invert ();
+    const HomogeneousTransfo &inv = this->getReferentialInverse ();
     
-    for (i = 0; i < atomLocal.size (); ++i)
+    for (i = 0; i < store->atomLocal.size (); ++i)
     {
-      *this->atomLocal[i] = *this->atomGlobal[i];
-      this->atomLocal[i]->transform (inv);
+      *this->store->atomLocal[i] = *this->store->atomGlobal[i];
+      this->store->atomLocal[i]->transform (inv);
     }
 
     this->placed = true;
   }
 
 
+  void
+  ExtendedResidue::_reset_local ()
+  {
+    vector< Atom* >::const_iterator cit;
+
+    this->_detach ();
+
+    for (cit = this->store->atomLocal.begin (); cit != this->store->atomLocal.end (); ++cit)
+      delete *cit;
+    this->store->atomLocal.clear ();
+
+    for (cit = this->store->atomGlobal.begin (); cit != this->store->atomGlobal.end (); ++cit)
+      this->store->atomLocal.push_back ((*cit)->clone ());
+
+    this->referential.setIdentity ();
+    this->placed = true;
+  }
+
+
   Atom& 
   ExtendedResidue::_get (size_type pos) const 
   {
     _place ();
-    return *atomGlobal[pos];
+    return *store->atomGlobal[pos];
   }
 
 
@@ -312,21 +299,23 @@ namespace mccore
   ExtendedResidue::_get_or_create (const AtomType *aType)
   {
     // ribose pointers to local container!
-    
+
+    this->_detach ();
+
     size_type pos = this->size ();
     pair< AtomMap::iterator, bool > inserted =
-      this->atomIndex.insert (make_pair (aType, pos));
+      this->store->atomIndex.insert (make_pair (aType, pos));
 
     if (inserted.second)
       {
-	this->atomLocal.push_back (new Atom (0.0, 0.0, 0.0, aType));
-	this->atomGlobal.push_back (new Atom (0.0, 0.0, 0.0, aType));
+	this->store->atomLocal.push_back (new Atom (0.0, 0.0, 0.0, aType));
+	this->store->atomGlobal.push_back (new Atom (0.0, 0.0, 0.0, aType));
 	this->rib_dirty_ref = true;
-	return this->atomLocal[pos];
+	return this->store->atomLocal[pos];
       }
     else
       {
-	return this->atomLocal[inserted.first->second];
+	return this->store->atomLocal[inserted.first->second];
       }
   }
 
@@ -349,16 +338,31 @@ namespace mccore
   {
     if (false == placed)
     {
-      vector< Atom* >::const_iterator cit;
-      vector< Atom* >::iterator it;
-    
-      for (cit = atomLocal.begin (), it = atomGlobal.begin ();
-	   cit != atomLocal.end ();
-	   ++cit, ++it)
+      // local coordinates are gathered in blocks of contiguous floats
+      // and transformed by a single kernel call.
+      float x[PLACE_BLOCK_SIZE], y[PLACE_BLOCK_SIZE], z[PLACE_BLOCK_SIZE];
+      size_type first, n, i;
+
+      for (first = 0; first < store->atomLocal.size (); first += n)
 	{
-	  **it = **cit;
-	  (*it)->transform (referential);
-	}      
+	  n = store->atomLocal.size () - first;
+	  if (PLACE_BLOCK_SIZE < n)
+	    n = PLACE_BLOCK_SIZE;
+
+	  for (i = 0; i < n; ++i)
+	    {
+	      const Atom *local = store->atomLocal[first + i];
+
+	      x[i] = local->getX ();
+	      y[i] = local->getY ();
+	      z[i] = local->getZ ();
+	    }
+
+	  referential.transform (x, y, z, n);
+
+	  for (i = 0; i < n; ++i)
+	    store->atomGlobal[first + i]->set (x[i], y[i], z[i], store->atomLocal[first + i]->getType ());
+	}
       placed = true;
     }
   }
@@ -380,14 +384,14 @@ namespace mccore
     os << endl
        << "# placed?: " << this->placed << endl
        << "# referential: " << endl << this->referential << endl
-       << "# local atoms: " << this->atomLocal.size () << endl;
+       << "# local atoms: " << this->store->atomLocal.size () << endl;
 
-    for (ait = this->atomLocal.begin (); ait != atomLocal.end (); ++ait)
+    for (ait = this->store->atomLocal.begin (); ait != store->atomLocal.end (); ++ait)
     {
       os << "\t";
       os.width (3);
       os.setf (ios::right);
-      os << (ait - this->atomLocal.begin ()) << ": " << **ait << endl;
+      os << (ait - this->store->atomLocal.begin ()) << ": " << **ait << endl;
     }
 
     return os;
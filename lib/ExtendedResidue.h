@@ -65,13 +65,6 @@ namespace mccore
    */
   class ExtendedResidue : public Residue
   {
-    /**
-     * The container for atoms expressed in the local referential.
-     * atomLocal is kept null until we need to transform the residue.
-     * This way, most of the time a residue will be quite "slim".
-     */
-    vector< Atom* > atomLocal;
-
     /**
      * The transfo that express the location of the local referential
      * in terms of global referential coordinates.
@@ -161,6 +154,14 @@ namespace mccore
      * @param res the polymorphic object from which to copy content.
      */
     ExtendedResidue& assignNV (const Residue& res);
+
+    /**
+     * Exchanges this object's content with another's by resolving its
+     * polymorphic type.  No atom is copied when the other residue is also
+     * an ExtendedResidue.
+     * @param res the other object with which to exchange content.
+     */
+    virtual void swap (Residue &res);
     
   protected:
 
@@ -227,6 +228,16 @@ namespace mccore
       this->_place ();
     }
 
+    /**
+     * Tells if the global atoms coordinates are up to date with the
+     * referential.
+     * @return whether the residue is placed.
+     */
+    virtual bool isPlaced () const
+    {
+      return this->placed;
+    }
+
     /**
      * Inserts an atom in the residue.  It crushes the existing atom if it
      * exists.  
@@ -293,6 +304,13 @@ namespace mccore
      */
     void _place () const;
 
+    /**
+     * @internal
+     * Rebuilds the local atoms from the global ones with an identity
+     * referential.
+     */
+    void _reset_local ();
+
   public:
     
     // I/O  -----------------------------------------------------------------
@@ -1125,6 +1125,21 @@ namespace mccore
       ev2elabel.clear ();
     }
 
+    /**
+     * Exchanges the graph elements with those of another graph.  The
+     * containers are swapped, no element is copied.
+     * @param right the graph with which to exchange elements.
+     */
+    void swap (Graph &right)
+    {
+      vertices.swap (right.vertices);
+      vertexWeights.swap (right.vertexWeights);
+      edges.swap (right.edges);
+      edgeWeights.swap (right.edgeWeights);
+      v2vlabel.swap (right.v2vlabel);
+      ev2elabel.swap (right.ev2elabel);
+    }
+
   protected:
 
     /**
@@ -41,6 +41,7 @@
 #include "Messagestream.h"
 #include "ModelFactoryMethod.h"
 #include "Molecule.h"
+#include "Parallel.h"
 #include "Pdbstream.h"
 #include "Relation.h"
 #include "Residue.h"
@@ -119,7 +120,9 @@ namespace mccore
 
   GraphModel::GraphModel (const AbstractModel &right, const ResidueFactoryMethod *fm)
     : AbstractModel (fm),
-      annotated (false)
+      annotated (false),
+      statsEnabled (false),
+      contactTracker (3.0)
   {
     const GraphModel *model;
 
@@ -130,6 +133,9 @@ namespace mccore
     else
       {
 	annotated = model->annotated;
+	dirty = model->dirty;
+	statsEnabled = model->statsEnabled;
+	stats = model->stats;
 	deepCopy (*model);
       }
   }
@@ -137,7 +143,11 @@ namespace mccore
 
   GraphModel::GraphModel (const GraphModel &right, const ResidueFactoryMethod *fm)
     : AbstractModel (fm),
-      annotated (right.annotated)
+      annotated (right.annotated),
+      dirty (right.dirty),
+      statsEnabled (right.statsEnabled),
+      stats (right.stats),
+      contactTracker (3.0)
   {
     deepCopy (right);
   }
@@ -215,6 +225,9 @@ namespace mccore
 	clear ();
 	AbstractModel::operator= (right);
 	annotated = right.annotated;
+	dirty = right.dirty;
+	statsEnabled = right.statsEnabled;
+	stats = right.stats;
 	deepCopy (right);
       }
     return *this;
@@ -233,15 +246,57 @@ namespace mccore
       }
     r = residueFM->createResidue (res);
     graphsuper::insert (r, w);
+    _index_insert (r->getResId (), size () - 1);
     annotated = false;
     return graphsuper::find (r);
   }
 
+
+  GraphModel::iterator
+  GraphModel::insert (Residue *res, int w)
+  {
+    iterator found;
+
+    if (end () != (found = find (res->getResId ())))
+      {
+	erase (found);
+      }
+    graphsuper::insert (res, w);
+    _index_insert (res->getResId (), size () - 1);
+    annotated = false;
+    return graphsuper::find (res);
+  }
+
+
+  void
+  GraphModel::swap (GraphModel &right)
+  {
+    if (this != &right)
+      {
+	AbstractModel::_swap (right);
+	graphsuper::swap (right);
+	std::swap (annotated, right.annotated);
+	dirty.swap (right.dirty);
+	std::swap (statsEnabled, right.statsEnabled);
+	std::swap (stats, right.stats);
+	contactTracker.swap (right.contactTracker);
+      }
+  }
+
   
   GraphModel::iterator
   GraphModel::erase (AbstractModel::iterator pos) 
   {
     Residue *res = &*pos;
+
+    if (contactTracker.contains (*res))
+      {
+	vector< ContactTracker::ResiduePair > removed;
+
+	contactTracker.erase (*res, removed);
+      }
+    _index_erase (pos - begin ());
+
     iterator ret (graphsuper::erase (&*pos));
 
     delete res;
@@ -283,6 +338,7 @@ namespace mccore
 	rebuildV2VLabel ();
 	ev2elabel = sortedEdgeMap;
 	delete[] corresp;
+	_index_invalidate ();
       }
   }
   
@@ -344,20 +400,65 @@ namespace mccore
 	delete *eIt;
       }
     graphsuper::clear ();
+    _index_invalidate ();
     annotated = false;
+    dirty.clear ();
+    contactTracker.clear ();
   }
 
 
+  /**
+   * @internal
+   * Annotates the relations of a range of contacts.  A found relation is
+   * kept with its inverse, at the position of its contact.  Each chunk
+   * counts its pairing tests in its own statistics.
+   */
+  class AnnotateTask : public ParallelTask
+  {
+    const vector< pair< AbstractModel::iterator, AbstractModel::iterator > > &contacts;
+    vector< pair< Relation*, Relation* > > &relations;
+    vector< AnnotationStats > &counts;
+    unsigned char aspb;
+
+  public:
+
+    AnnotateTask (const vector< pair< AbstractModel::iterator, AbstractModel::iterator > > &c,
+		  vector< pair< Relation*, Relation* > > &r,
+		  vector< AnnotationStats > &s,
+		  unsigned char a)
+      : contacts (c), relations (r), counts (s), aspb (a)
+    { }
+
+    virtual void execute (unsigned int chunk, unsigned int first, unsigned int last)
+    {
+      for (; first < last; ++first)
+	{
+	  Relation *rel = new Relation (&*contacts[first].first, &*contacts[first].second);
+
+	  if (rel->annotate (aspb, counts[chunk]))
+	    {
+	      Relation *inv = rel->clone ();
+
+	      inv->invert ();
+	      relations[first] = make_pair (rel, inv);
+	    }
+	  else
+	    delete rel;
+	}
+    }
+  };
+
+
   void
-  GraphModel::annotate (unsigned char aspb)
+  GraphModel::annotate (unsigned char aspb, unsigned int nthreads)
   {
     if (! annotated)
       {
 	vector< Relation* >::iterator eIt;
 	vector< pair< AbstractModel::iterator, AbstractModel::iterator > > contacts;
 	vector< pair< AbstractModel::iterator, AbstractModel::iterator > >::iterator l;
-// 	time_t t;
 	RDATypeFilter< iterator > filter;
+	double mark = 0;
 
 	for (eIt = edges.begin (); edges.end () != eIt; ++eIt)
 	  {
@@ -366,22 +467,115 @@ namespace mccore
 	edges.clear ();
 	ev2elabel.clear ();
 	edgeWeights.clear ();
+	dirty.clear ();
+	contactTracker.clear ();
 
+	if (statsEnabled)
+	  {
+	    stats.clear ();
+	    mark = AnnotationStats::clock ();
+	  }
 	addHLP ();
+	if (statsEnabled)
+	  _stats_stage (AnnotationStats::hlp_stage, mark);
 	
-// 	time (&t);
-	Algo::extractContacts (contacts, begin (), end (), filter, 3.0);
-// 	gOut (0) << "Extract contacts " << time (0) - t << "s" << endl;
+	Algo::extractContacts (contacts, begin (), end (), filter, 3.0, Algo::grid_engine);
 	gErr (3) << "Found " << contacts.size () << " possible contacts " << endl;
+	if (statsEnabled)
+	  {
+	    _stats_stage (AnnotationStats::contact_stage, mark);
+	    stats.addContacts (contacts.size ());
+	  }
   
-// 	time (&t);
+	if (1 != nthreads)
+	  {
+	    vector< pair< Relation*, Relation* > > relations (contacts.size (), pair< Relation*, Relation* > (0, 0));
+	    vector< pair< Relation*, Relation* > >::iterator rIt;
+	    vector< AnnotationStats > counts (Parallel::getChunkCount (contacts.size (), nthreads));
+	    vector< AnnotationStats >::iterator cIt;
+	    AnnotateTask task (contacts, relations, counts, aspb);
+	    const_iterator it;
+
+	    // -- shared tables and residue caches are filled before the
+	    //    threads only read them
+	    Relation::initTables ();
+	    for (it = begin (); end () != it; ++it)
+	      {
+		Vector3D lower;
+		Vector3D upper;
+
+		it->place ();
+		it->getBoundingBox (lower, upper);
+		it->getHBondCouples ();
+		try
+		  {
+		    it->getReferentialInverse ();
+		  }
+		catch (IntLibException &ex)
+		  {
+		    // the relations of this residue fail in their thread
+		  }
+		if (it->getType ()->isNucleicAcid ())
+		  try
+		    {
+		      it->getPyrimidineRingNormal ();
+		      if (it->getType ()->isPurine ())
+			it->getImidazoleRingNormal ();
+		    }
+		  catch (IntLibException &ex)
+		    {
+		      // nothing is cached, the stackings fail in their thread
+		    }
+	      }
+
+	    try
+	      {
+		Parallel::run (task, contacts.size (), nthreads);
+	      }
+	    catch (IntLibException &ex)
+	      {
+		for (rIt = relations.begin (); relations.end () != rIt; ++rIt)
+		  {
+		    delete rIt->first;
+		    delete rIt->second;
+		  }
+		throw;
+	      }
+
+	    // -- the chunk counts are added once the threads are joined
+	    for (cIt = counts.begin (); counts.end () != cIt; ++cIt)
+	      {
+		Relation::addPairingStats (*cIt);
+		if (statsEnabled)
+		  stats.add (*cIt);
+	      }
+
+	    // -- edges are inserted in the sequential order
+	    for (l = contacts.begin (), rIt = relations.begin (); contacts.end () != l; ++l, ++rIt)
+	      if (0 != rIt->first)
+		{
+		  connect (&*l->first, &*l->second, rIt->first, 0);
+		  connect (&*l->second, &*l->first, rIt->second, 0);
+		  if (statsEnabled)
+		    stats.addRelation (*rIt->first);
+		}
+	    if (statsEnabled)
+	      {
+		_stats_stage (AnnotationStats::relation_stage, mark);
+	      }
+	    annotated = true;
+	    return;
+	  }
+
+	AnnotationStats counts;
+
 	for (l = contacts.begin (); contacts.end () != l; ++l)
 	  {
 	    Residue *i = &*l->first;
 	    Residue *j = &*l->second;
 	    Relation *rel = new Relation (i, j);
 
-	    if (rel->annotate (aspb))
+	    if (rel->annotate (aspb, counts))
 	      {
 		Relation *inv;
 
@@ -389,18 +583,235 @@ namespace mccore
 		inv->invert ();
 		connect (i, j, rel, 0);
 		connect (j, i, inv, 0);
+		if (statsEnabled)
+		  stats.addRelation (*rel);
 	      }
 	    else
 	      {
 		delete rel;
 	      }
 	  }
-// 	gOut (0) << "Annotation " << time (0) - t << "s" << endl;
+	Relation::addPairingStats (counts);
+	if (statsEnabled)
+	  {
+	    _stats_stage (AnnotationStats::relation_stage, mark);
+	    stats.add (counts);
+	  }
 	annotated = true;
       }
   }
 
 
+  void
+  GraphModel::markDirty (const ResId &id)
+  {
+    if (end () == find (id))
+      {
+	NoSuchElementException ex ("", __FILE__, __LINE__);
+	ex << "residue " << id << " not in the model";
+	throw ex;
+      }
+    dirty.insert (id);
+  }
+
+
+  void
+  GraphModel::annotateDirty (unsigned char aspb)
+  {
+    if (! annotated)
+      {
+	annotate (aspb);
+	return;
+      }
+
+    vector< pair< label, label > > contacts;
+    vector< pair< label, label > >::iterator l;
+    set< label > labels;
+    set< label > targets;
+    set< ResId >::iterator dIt;
+    RDATypeFilter< iterator > filter;
+    AnnotationStats counts;
+    double mark = 0;
+
+    if (statsEnabled)
+      {
+	stats.clear ();
+	mark = AnnotationStats::clock ();
+      }
+    for (dIt = dirty.begin (); dirty.end () != dIt; ++dIt)
+      {
+	iterator it = find (*dIt);
+
+	// -- a residue erased since marked has no relation left
+	if (end () != it)
+	  {
+	    label v = getVertexLabel (&*it);
+
+	    it->addHydrogens ();
+	    it->addLonePairs ();
+	    labels.insert (v);
+	    if (filter (it))
+	      targets.insert (v);
+	  }
+      }
+    dirty.clear ();
+    if (statsEnabled)
+      _stats_stage (AnnotationStats::hlp_stage, mark);
+    _disconnect (labels);
+    if (statsEnabled)
+      _stats_stage (AnnotationStats::relation_stage, mark);
+
+    _target_contacts (targets, contacts);
+    gErr (3) << "Found " << contacts.size () << " possible contacts of "
+	     << targets.size () << " residues" << endl;
+    if (statsEnabled)
+      {
+	_stats_stage (AnnotationStats::contact_stage, mark);
+	stats.addContacts (contacts.size ());
+      }
+
+    for (l = contacts.begin (); contacts.end () != l; ++l)
+      {
+	Residue *i = vertices[l->first];
+	Residue *j = vertices[l->second];
+	Relation *rel = new Relation (i, j);
+
+	if (rel->annotate (aspb, counts))
+	  {
+	    Relation *inv;
+
+	    inv = rel->clone ();
+	    inv->invert ();
+	    connect (i, j, rel, 0);
+	    connect (j, i, inv, 0);
+	    if (statsEnabled)
+	      stats.addRelation (*rel);
+	  }
+	else
+	  {
+	    delete rel;
+	  }
+      }
+    Relation::addPairingStats (counts);
+    if (statsEnabled)
+      {
+	_stats_stage (AnnotationStats::relation_stage, mark);
+	stats.add (counts);
+      }
+  }
+
+
+  void
+  GraphModel::_stats_stage (unsigned int stage, double &mark)
+  {
+    double now = AnnotationStats::clock ();
+
+    stats.addTime (stage, now - mark);
+    mark = now;
+  }
+
+
+  void
+  GraphModel::_disconnect (const set< label > &labels)
+  {
+    set< label > removed;
+    set< label >::const_iterator lIt;
+    set< label >::reverse_iterator rIt;
+
+    // -- the relations of each residue, its out edges, and their inverses
+    for (lIt = labels.begin (); labels.end () != lIt; ++lIt)
+      {
+	EV2ELabel::iterator evIt = ev2elabel.lower_bound (EndVertices (*lIt, 0));
+
+	while (ev2elabel.end () != evIt && *lIt == evIt->first.getHeadLabel ())
+	  {
+	    EV2ELabel::iterator inv = ev2elabel.find (EndVertices (evIt->first.getTailLabel (), *lIt));
+
+	    if (ev2elabel.end () != inv && evIt != inv)
+	      {
+		removed.insert (inv->second);
+		ev2elabel.erase (inv);
+	      }
+	    removed.insert (evIt->second);
+	    ev2elabel.erase (evIt++);
+	  }
+      }
+
+    // -- from the highest label, the last relation fills each place left
+    for (rIt = removed.rbegin (); removed.rend () != rIt; ++rIt)
+      {
+	label last = edges.size () - 1;
+
+	delete edges[*rIt];
+	if (*rIt != last)
+	  {
+	    const Relation *rel = edges[last];
+	    EV2ELabel::iterator evIt
+	      = ev2elabel.find (EndVertices (getVertexLabel (const_cast< Residue* > (rel->getRef ())),
+					     getVertexLabel (const_cast< Residue* > (rel->getRes ()))));
+
+	    if (ev2elabel.end () != evIt)
+	      evIt->second = *rIt;
+	    edges[*rIt] = edges[last];
+	    edgeWeights[*rIt] = edgeWeights[last];
+	  }
+	edges.pop_back ();
+	edgeWeights.pop_back ();
+      }
+  }
+
+
+  void
+  GraphModel::_target_contacts (const set< label > &targets, vector< pair< label, label > > &contacts)
+  {
+    vector< ContactTracker::ResiduePair > added;
+    vector< ContactTracker::ResiduePair > removed;
+    vector< const Residue* > partners;
+    vector< const Residue* >::iterator pIt;
+    set< label >::const_iterator tIt;
+    size_t start = contacts.size ();
+
+    // -- the tracker is built from the residues as annotated, the targets
+    //    with their new hydrogens and lone pairs
+    if (0 == contactTracker.size ())
+      {
+	RDATypeFilter< iterator > filter;
+	iterator it;
+
+	for (it = begin (); end () != it; ++it)
+	  if (filter (it))
+	    contactTracker.insert (*it, added);
+      }
+    else
+      for (tIt = targets.begin (); targets.end () != tIt; ++tIt)
+	{
+	  const Residue &res = *vertices[*tIt];
+
+	  if (contactTracker.contains (res))
+	    contactTracker.move (res, added, removed);
+	  else
+	    contactTracker.insert (res, added);
+	}
+
+    // -- a contact between two targets is kept once
+    for (tIt = targets.begin (); targets.end () != tIt; ++tIt)
+      {
+	partners.clear ();
+	contactTracker.getContacts (*vertices[*tIt], partners);
+	for (pIt = partners.begin (); partners.end () != pIt; ++pIt)
+	  {
+	    label p = getVertexLabel (const_cast< Residue* > (*pIt));
+
+	    if (targets.end () == targets.find (p))
+	      contacts.push_back (*tIt < p ? make_pair (*tIt, p) : make_pair (p, *tIt));
+	    else if (*tIt < p)
+	      contacts.push_back (make_pair (*tIt, p));
+	  }
+      }
+    std::sort (contacts.begin () + start, contacts.end ());
+  }
+
+
   void
   GraphModel::fillMoleculeWithCycles (Molecule &molecule, const vector< Path< GraphModel::label, GraphModel::size_type > > &cycles) const
   {
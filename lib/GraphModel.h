@@ -27,9 +27,12 @@
 #define _mccore_GraphModel_h_
 
 #include <iostream>
+#include <set>
 
 #include "AbstractModel.h"
 #include "Algo.h"
+#include "AnnotationStats.h"
+#include "ContactTracker.h"
 #include "Exception.h"
 #include "Path.h"
 #include "Residue.h"
@@ -88,6 +91,28 @@ namespace mccore
      */
     bool annotated;
 
+    /**
+     * Residues modified since the annotation.
+     */
+    set< ResId > dirty;
+
+    /**
+     * Whether the annotation statistics are gathered.
+     */
+    bool statsEnabled;
+
+    /**
+     * The statistics of the last annotation.
+     */
+    AnnotationStats stats;
+
+    /**
+     * The contacts of the annotated residues, built by the first
+     * annotateDirty and then updated with the marked residues only.  It is
+     * cleared when the annotation or the residue set is rebuilt.
+     */
+    ContactTracker contactTracker;
+
   public:
     
     /**
@@ -96,7 +121,7 @@ namespace mccore
      * residues (default is @ref ExtendedResidueFM).
      */
     GraphModel (const ResidueFactoryMethod *fm = 0)
-      : AbstractModel (fm), annotated (false) { }
+      : AbstractModel (fm), annotated (false), statsEnabled (false), contactTracker (3.0) { }
 
     /**
      * Initializes the object with the right's content (deep copy).
@@ -227,6 +252,26 @@ namespace mccore
      */
     void setAnnotated (bool val) { annotated = val; }
 
+    /**
+     * Turns the gathering of annotation statistics on or off (default
+     * off).  When off, annotate and annotateDirty only test the flag.
+     * @param val whether the statistics are gathered.
+     */
+    void setAnnotationStats (bool val) { statsEnabled = val; }
+
+    /**
+     * Tells whether the annotation statistics are gathered.
+     * @return the statistics flag.
+     */
+    bool hasAnnotationStats () const { return statsEnabled; }
+
+    /**
+     * Gets the statistics of the last annotation by annotate or
+     * annotateDirty, when they were gathered.
+     * @return the statistics.
+     */
+    const AnnotationStats& getAnnotationStats () const { return stats; }
+
     // METHODS -------------------------------------------------------------
 
   private:
@@ -267,6 +312,33 @@ namespace mccore
      * @return the position where the residue was inserted.
      */
     virtual iterator insert (const Residue &res, int w);
+
+    /**
+     * Inserts a residue at the end without copying it.  The model takes
+     * ownership of the residue.  The annotated flag is turned to false.
+     * @param res the residue to insert.
+     * @return the position where the residue was inserted.
+     */
+    virtual iterator insert (Residue *res)
+    {
+      return insert (res, 0);
+    }
+
+    /**
+     * Inserts a residue at the end without copying it.  The model takes
+     * ownership of the residue.  The annotated flag is turned to false.
+     * @param res the residue to insert.
+     * @param w the Residue weight.
+     * @return the position where the residue was inserted.
+     */
+    virtual iterator insert (Residue *res, int w);
+
+    /**
+     * Exchanges the residues, relations and factory method with the
+     * right's.  Nothing is copied.
+     * @param right the model with which to exchange content.
+     */
+    void swap (GraphModel &right);
       
     /**
      * Erases a residue from the model.
@@ -410,6 +482,8 @@ namespace mccore
 	  edgeWeights = newew;
 	  ev2elabel = newEdgeMap;
 	  delete[] corresp;
+	  _index_invalidate ();
+	  contactTracker.clear ();
 	}
     }
 
@@ -439,25 +513,98 @@ namespace mccore
     virtual void clear ();
 
     /**
-     * Annotates the GraphModel.  It builds edges in the graph.
+     * Annotates the GraphModel.  It builds edges in the graph.  The
+     * relations of the contacts may be evaluated by several threads, the
+     * edges are then inserted in the order of the sequential annotation
+     * so that the graph is the same.  Diagnostic messages of failed
+     * relations may interleave between threads.
      * @param asbp Bit mask controlling annotation tasks: adjacency, 
      *        stacking, pairing and pairing with backbone (default: all).
+     * @param nthreads the number of threads (0 for one per processor,
+     *        default = 1).
+     * @exception IntLibException if a relation failed in a thread.
      */
-    void annotate (unsigned char aspb = Relation::adjacent_mask|Relation::pairing_mask|Relation::stacking_mask|Relation::bhbond_mask);
+    void annotate (unsigned char aspb = Relation::adjacent_mask|Relation::pairing_mask|Relation::stacking_mask|Relation::bhbond_mask, unsigned int nthreads = 1);
 
 
     /**
      * Reannotates the GraphModel.
      * @param asbp Bit mask controlling annotation tasks: adjacency, 
      *        stacking, pairing and pairing with backbone (default: all).
+     * @param nthreads the number of threads (0 for one per processor,
+     *        default = 1).
      */
-    void reannotate (unsigned char aspb = Relation::adjacent_mask|Relation::pairing_mask|Relation::stacking_mask|Relation::bhbond_mask)
+    void reannotate (unsigned char aspb = Relation::adjacent_mask|Relation::pairing_mask|Relation::stacking_mask|Relation::bhbond_mask, unsigned int nthreads = 1)
     {
       annotated = false;
-      annotate (aspb);
+      annotate (aspb, nthreads);
     }
 
+    /**
+     * Marks a residue as modified since the annotation, its relations are
+     * rebuilt by the next annotateDirty.
+     * @param id the residue id.
+     * @exception NoSuchElementException if the residue is not in the model.
+     */
+    void markDirty (const ResId &id);
+
+    /**
+     * Marks a residue as modified since the annotation, its relations are
+     * rebuilt by the next annotateDirty.
+     * @param res the residue.
+     * @exception NoSuchElementException if the residue is not in the model.
+     */
+    void markDirty (const Residue &res) { markDirty (res.getResId ()); }
+
+    /**
+     * Tells whether residues are marked as modified.
+     * @return whether a residue is marked.
+     */
+    bool isDirty () const { return ! dirty.empty (); }
+
+    /**
+     * Reannotates the relations of the residues marked as modified.  Their
+     * hydrogens and lone pairs are rebuilt, their relations are removed
+     * and their contacts are extracted again and annotated, the relations
+     * between unmarked residues are kept.  The result is the one of
+     * reannotate when only the marked residues moved, but for the edge
+     * order.  The contacts are kept in a ContactTracker built by the first
+     * call, the later ones cost in proportion to the marked residues and
+     * their neighbourhood.  The whole model is annotated when it was not.
+     * The marks are then cleared.
+     * @param asbp Bit mask controlling annotation tasks: adjacency, 
+     *        stacking, pairing and pairing with backbone (default: all).
+     */
+    void annotateDirty (unsigned char aspb = Relation::adjacent_mask|Relation::pairing_mask|Relation::stacking_mask|Relation::bhbond_mask);
+
   private:
+
+    /**
+     * @internal
+     * Removes and deletes the relations of some residues and their
+     * inverses, visiting only their edges.  The last relations take the
+     * labels of the removed ones.
+     * @param labels the residue labels.
+     */
+    void _disconnect (const set< label > &labels);
+
+    /**
+     * @internal
+     * Updates the contact tracker with some residues, building it first if
+     * needed, and gets their contacts as ordered label pairs, sorted as
+     * Algo::extractContacts returns them.
+     * @param targets the labels of the residues, all passing the residue
+     * filter.
+     * @param contacts the contacts, appended.
+     */
+    void _target_contacts (const set< label > &targets, vector< pair< label, label > > &contacts);
+
+    /**
+     * @internal
+     * Adds the time since mark to an annotation stage and moves mark to
+     * now.
+     */
+    void _stats_stage (unsigned int stage, double &mark);
     
     /**
      * Fills the Molecule with the elements from this identified with the
@@ -48,6 +48,7 @@ namespace mccore
 
   const float TAN70        = 2.7474774;  // For CH3-like conformations
   const float C_H_DIST_CYC = 1.08;       // C-H distance for aromatic C
+  const unsigned int EVAL_BLOCK = 64;    // Candidates evaluated together
 
   // MEMBER CONSTANT ---------------------------------------------------------
 
@@ -365,6 +366,101 @@ namespace mccore
       }
     return (value = p_h / p_x);
   }
+
+
+  void
+  HBond::evalStatistically (const vector< Vector3D > &donors,
+			    const vector< Vector3D > &hydrogens,
+			    const vector< Vector3D > &acceptors,
+			    const vector< Vector3D > &lonepairs,
+			    vector< float > &values)
+  {
+    vector< float >::size_type n = donors.size ();
+    vector< float >::size_type first;
+
+    values.resize (n);
+
+    // -- the candidates are evaluated by blocks whose descriptors stay on
+    //    the stack, so that no evaluation allocates
+    for (first = 0; first < n; first += EVAL_BLOCK)
+      {
+	unsigned int m = n - first < EVAL_BLOCK ? n - first : EVAL_BLOCK;
+	unsigned int k;
+	float x0[EVAL_BLOCK];
+	float x1[EVAL_BLOCK];
+	float x2[EVAL_BLOCK];
+	float p_x[EVAL_BLOCK];
+	float p_h[EVAL_BLOCK];
+	bool inrange[EVAL_BLOCK];
+
+	// -- descriptors of the candidates passing the distance precheck
+	for (k = 0; k < m; ++k)
+	  {
+	    const Vector3D &donor = donors[first + k];
+	    const Vector3D &hydrogen = hydrogens[first + k];
+	    const Vector3D &acceptor = acceptors[first + k];
+	    const Vector3D &lonepair = lonepairs[first + k];
+
+	    p_x[k] = p_h[k] = 0;
+	    x0[k] = x1[k] = x2[k] = 0;
+	    inrange[k] = donor.distance (acceptor) <= 5;
+	    if (inrange[k])
+	      {
+		x0[k] = log (pow (hydrogen.distance (lonepair), 3));
+		x1[k] = atanh (cos (donor.angle (hydrogen, acceptor)));
+		x2[k] = atanh (cos (acceptor.angle (donor, lonepair)));
+	      }
+	  }
+
+	// -- one Gaussian at a time, its parameters out of the inner loop
+	for (int i = 0; i < sNbGauss; ++i)
+	  {
+	    const float m0 = sMean[i][0];
+	    const float m1 = sMean[i][1];
+	    const float m2 = sMean[i][2];
+	    const float c00 = sCovarInv[i][0][0];
+	    const float c01 = sCovarInv[i][0][1];
+	    const float c02 = sCovarInv[i][0][2];
+	    const float c10 = sCovarInv[i][1][0];
+	    const float c11 = sCovarInv[i][1][1];
+	    const float c12 = sCovarInv[i][1][2];
+	    const float c20 = sCovarInv[i][2][0];
+	    const float c21 = sCovarInv[i][2][1];
+	    const float c22 = sCovarInv[i][2][2];
+	    const float weight = sWeight[i];
+	    const float probH = sProbH[i];
+	    const bool degenerate = fabs (sCovarDet[i]) < 0.0005;
+	    const double norm = pow (2 * M_PI, 1.5) * sqrt (sCovarDet[i]);
+
+	    for (k = 0; k < m; ++k)
+	      {
+		float diff[3];
+		diff[0] = x0[k] - m0;
+		diff[1] = x1[k] - m1;
+		diff[2] = x2[k] - m2;
+
+		float tmp = exp ((diff[0] * (diff[0] * c00 +
+					     diff[1] * c10 +
+					     diff[2] * c20) +
+				  diff[1] * (diff[0] * c01 +
+					     diff[1] * c11 +
+					     diff[2] * c21) +
+				  diff[2] * (diff[0] * c02 +
+					     diff[1] * c12 +
+					     diff[2] * c22)) * -0.5);
+		float prob;
+		if (isnan (tmp) || degenerate) prob = 0;
+		else prob = weight * tmp / norm;
+
+		p_x[k] += prob;
+		p_h[k] += probH * prob;
+	      }
+	  }
+
+	for (k = 0; k < m; ++k)
+	  values[first + k] = inrange[k] ? p_h[k] / p_x[k] : 0;
+      }
+  }
   
   
   ostream &
@@ -29,6 +29,7 @@
 #include <iostream>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "Algo.h"
 #include "Exception.h"
@@ -43,6 +44,7 @@ namespace mccore
   class Atom;
   class AtomType;
   class Residue;
+  class Vector3D;
   class iBinstream;
   class oBinstream;
 
@@ -284,6 +286,26 @@ namespace mccore
      * @return a score between 0 and 1, where 0 is low probability and 1 is high probability.      
      */
     float evalStatistically (const Residue *ra, const Residue *rb);
+
+    /**
+     * Evaluates the Gaussian mixture model of evalStatistically over a
+     * batch of candidate H-bonds given by their atom positions.  The
+     * mixture is computed one Gaussian at a time over the whole batch,
+     * with the same arithmetic as evalStatistically so that the values
+     * are identical.  The candidates are taken by blocks kept on the
+     * stack, so the evaluation does not allocate.  The hydrogen of a C5M
+     * donor must be given as evalStatistically places it.
+     * @param donors the donor atom positions.
+     * @param hydrogens the hydrogen positions.
+     * @param acceptors the acceptor atom positions.
+     * @param lonepairs the lone pair positions.
+     * @param values the scores between 0 and 1, one per candidate, replaced.
+     */
+    static void evalStatistically (const vector< Vector3D > &donors,
+				   const vector< Vector3D > &hydrogens,
+				   const vector< Vector3D > &acceptors,
+				   const vector< Vector3D > &lonepairs,
+				   vector< float > &values);
       
     // I/O -------------------------------------------------------------------
 
@@ -102,6 +102,28 @@ namespace mccore
   }
 
 
+  void
+  HomogeneousTransfo::transform (float *x, float *y, float *z, unsigned int n) const
+  {
+    // local copies keep the matrix out of memory in the loop body
+    const float a00 = m00, a01 = m01, a02 = m02, a03 = m03;
+    const float a10 = m10, a11 = m11, a12 = m12, a13 = m13;
+    const float a20 = m20, a21 = m21, a22 = m22, a23 = m23;
+    unsigned int i;
+
+    for (i = 0; i < n; ++i)
+    {
+      float px = x[i];
+      float py = y[i];
+      float pz = z[i];
+
+      x[i] = a00*px + a01*py + a02*pz + a03;
+      y[i] = a10*px + a11*py + a12*pz + a13;
+      z[i] = a20*px + a21*py + a22*pz + a23;
+    }
+  }
+
+
   HomogeneousTransfo 
   HomogeneousTransfo::getRotation () const 
   {
@@ -233,6 +233,17 @@ namespace mccore
     
     // METHODS --------------------------------------------------------------    
 
+    /**
+     * Applies the transfo in place to n points stored as separate
+     * coordinate arrays.  The loop works on contiguous floats so that it
+     * can be vectorized by the compiler.
+     * @param x the x coordinates.
+     * @param y the y coordinates.
+     * @param z the z coordinates.
+     * @param n the number of points.
+     */
+    void transform (float *x, float *y, float *z, unsigned int n) const;
+
     /**
      * Gets the element of row i column j. Throws an ArrayIndexOutOfBoundsException
      * if (i,j) not in {0,1,2,3}X{0,1,2,3}.
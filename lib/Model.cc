@@ -143,6 +143,7 @@ namespace mccore
     if (end () == (found = find (res.getResId ())))
     {
       found = this->residues.insert (this->residues.end (), this->residueFM->createResidue (res));
+      this->_index_insert (res.getResId (), this->residues.size () - 1);
     }
     else
     {
@@ -152,11 +153,46 @@ namespace mccore
 
     return found;
   }
+
+
+  Model::iterator
+  Model::insert (Residue *res)
+  {
+    iterator found;
+
+    if (end () == (found = find (res->getResId ())))
+    {
+      found = this->residues.insert (this->residues.end (), res);
+      this->_index_insert (res->getResId (), this->residues.size () - 1);
+    }
+    else
+    {
+      vector< Residue* >::iterator it = found;
+
+      gErr (4) << "Warning: model's residue " << *found << " was overwritten by " << *res << endl;
+      delete *it;
+      *it = res;
+    }
+
+    return found;
+  }
+
+
+  void
+  Model::swap (Model &right)
+  {
+    if (this != &right)
+    {
+      AbstractModel::_swap (right);
+      residues.swap (right.residues);
+    }
+  }
   
   
   Model::iterator
   Model::erase (iterator pos)
   {
+    _index_erase (pos - begin ());
     delete &*pos;
     return iterator (residues.erase (pos));
   }
@@ -166,6 +202,7 @@ namespace mccore
   Model::sort ()
   {
     std::sort (residues.begin (), residues.end (), less_deref< Residue > ());
+    _index_invalidate ();
   }
   
   
@@ -179,6 +216,7 @@ namespace mccore
 	delete *it;
       }
     residues.clear ();    
+    _index_invalidate ();
   }
   
   
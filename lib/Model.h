@@ -175,6 +175,21 @@ namespace mccore
      */
     virtual iterator insert (const Residue &res);
 
+    /**
+     * Inserts a residue at the end without copying it.  The model takes
+     * ownership of the residue.
+     * @param res the residue to insert.
+     * @return the position where the residue was inserted.
+     */
+    virtual iterator insert (Residue *res);
+
+    /**
+     * Exchanges the residues and factory method with the right's.  No
+     * residue is copied.
+     * @param right the model with which to exchange content.
+     */
+    void swap (Model &right);
+
     /**
      * Erases a residue from the model.
      * @param pos the position to erase.
@@ -26,6 +26,8 @@
 // cmake generated defines
 #include <config.h>
 
+#include <algorithm>
+
 #include "AbstractModel.h"
 #include "Binstream.h"
 #include "Molecule.h"
@@ -161,6 +163,19 @@ namespace mccore
   {
     return (iterator)models.insert (models.end (), model);
   }
+
+
+  void
+  Molecule::swap (Molecule &right)
+  {
+    if (this != &right)
+      {
+	std::swap (header, right.header);
+	models.swap (right.models);
+	properties.swap (right.properties);
+	std::swap (modelFM, right.modelFM);
+      }
+  }
   
     
   Molecule::iterator
@@ -374,6 +374,13 @@ namespace mccore
      */
     iterator insert (AbstractModel* model);
 
+    /**
+     * Exchanges the models, header, properties and factory method with the
+     * right's.  No model is copied.
+     * @param right the molecule with which to exchange content.
+     */
+    void swap (Molecule &right);
+
     /**
      * Inserts the model range before pos.  It calls the list<> method.
      * @param pos the iterator where the model will be placed.
@@ -45,6 +45,16 @@ namespace mccore
 
   list< PairingPattern > PairingPattern::patterns;
   bool PairingPattern::isInit = false;
+  vector< const ResidueType* > PairingPattern::indexTypes;
+  vector< const PropertyType* > PairingPattern::indexOrientations;
+  vector< vector< const PairingPattern* > > PairingPattern::index;
+  vector< const PairingPattern* > PairingPattern::allPatterns;
+
+  /**
+   * @internal
+   * The candidates of residues that no pattern fits.
+   */
+  static const vector< const PairingPattern* > gc_no_patterns;
 
 
   const PairingPattern&
@@ -58,6 +68,7 @@ namespace mccore
 	AtoB = other.AtoB;
 	BtoA = other.BtoA;
 	msize = other.msize;
+	msignature = other.msignature;
 	baseOrientation = other.baseOrientation;
       }
     return *this;
@@ -762,7 +773,125 @@ namespace mccore
     pat.addBond (pat.getAtoB (), AtomType::aN4, AtomType::a2H4, AtomType::aO2, AtomType::a2LP2);
     patterns.push_back (pat);
 
+    _build_index ();
   };
+
+
+  unsigned long long
+  PairingPattern::getSignature (const list< HBondFlow > &hbf)
+  {
+    list< HBondFlow >::const_iterator it;
+    unsigned long long sig = 0;
+
+    for (it = hbf.begin (); hbf.end () != it; ++it)
+      {
+	sig |= _signature_bit (it->hbond);
+      }
+    return sig;
+  }
+
+
+  const vector< const PairingPattern* >&
+  PairingPattern::getCandidates (const Residue *ra, const Residue *rb, const PropertyType *bpori)
+  {
+    int a;
+    int b;
+    unsigned int o;
+
+    patternList ();
+    a = _type_number (ra->getType ());
+    b = _type_number (rb->getType ());
+
+    // -- a residue of several pattern types gets every pattern evaluated
+    if (0 > a || 0 > b)
+      {
+	return allPatterns;
+      }
+    o = find (indexOrientations.begin (), indexOrientations.end (), bpori) - indexOrientations.begin ();
+    if ((int) indexTypes.size () == a
+	|| (int) indexTypes.size () == b
+	|| indexOrientations.size () == o)
+      {
+	return gc_no_patterns;
+      }
+    return index[(a * indexTypes.size () + b) * indexOrientations.size () + o];
+  }
+
+
+  unsigned long long
+  PairingPattern::_signature_bit (const HBond &hbond)
+  {
+    size_t h;
+
+    h = (size_t) hbond.getDonorType ();
+    h = h * 31 + (size_t) hbond.getHydrogenType ();
+    h = h * 31 + (size_t) hbond.getAcceptorType ();
+    h = h * 31 + (size_t) hbond.getLonePairType ();
+    h ^= (h >> 7) ^ (h >> 17);
+    return (unsigned long long) 1 << (h % 64);
+  }
+
+
+  void
+  PairingPattern::_build_index ()
+  {
+    list< PairingPattern >::iterator it;
+    vector< Description >::const_iterator dIt;
+
+    indexTypes.clear ();
+    indexOrientations.clear ();
+    allPatterns.clear ();
+    for (it = patterns.begin (); patterns.end () != it; ++it)
+      {
+	it->msignature = 0;
+	for (dIt = it->AtoB.begin (); it->AtoB.end () != dIt; ++dIt)
+	  if (! dIt->ignored)
+	    it->msignature |= _signature_bit (dIt->hbond);
+	for (dIt = it->BtoA.begin (); it->BtoA.end () != dIt; ++dIt)
+	  if (! dIt->ignored)
+	    it->msignature |= _signature_bit (dIt->hbond);
+
+	if (indexTypes.end () == find (indexTypes.begin (), indexTypes.end (), it->typeA))
+	  indexTypes.push_back (it->typeA);
+	if (indexTypes.end () == find (indexTypes.begin (), indexTypes.end (), it->typeB))
+	  indexTypes.push_back (it->typeB);
+	if (indexOrientations.end () == find (indexOrientations.begin (), indexOrientations.end (), it->baseOrientation))
+	  indexOrientations.push_back (it->baseOrientation);
+	allPatterns.push_back (&*it);
+      }
+
+    // -- evaluate swaps the residues to fit typeA, so a pattern fits both
+    //    orders of its types
+    index.assign (indexTypes.size () * indexTypes.size () * indexOrientations.size (),
+		  vector< const PairingPattern* > ());
+    for (it = patterns.begin (); patterns.end () != it; ++it)
+      {
+	unsigned int a = find (indexTypes.begin (), indexTypes.end (), it->typeA) - indexTypes.begin ();
+	unsigned int b = find (indexTypes.begin (), indexTypes.end (), it->typeB) - indexTypes.begin ();
+	unsigned int o = find (indexOrientations.begin (), indexOrientations.end (), it->baseOrientation) - indexOrientations.begin ();
+
+	index[(a * indexTypes.size () + b) * indexOrientations.size () + o].push_back (&*it);
+	if (a != b)
+	  index[(b * indexTypes.size () + a) * indexOrientations.size () + o].push_back (&*it);
+      }
+  }
+
+
+  int
+  PairingPattern::_type_number (const ResidueType *type)
+  {
+    unsigned int n;
+    int number = indexTypes.size ();
+
+    for (n = 0; n < indexTypes.size (); ++n)
+      if (type->is (indexTypes[n]))
+	{
+	  if ((int) indexTypes.size () != number)
+	    return -1;
+	  number = n;
+	}
+    return number;
+  }
   
   
   ostream& 
@@ -124,12 +124,38 @@ namespace mccore
        * The number of non ignored descriptions.
        */
       unsigned int msize;
+
+      /**
+       * The signature of the non ignored descriptions.
+       */
+      unsigned long long msignature;
       
       /**
        * The patterns.
        */
       static list< PairingPattern > patterns;
 
+      /**
+       * The residue types of the patterns, numbering the index buckets.
+       */
+      static vector< const ResidueType* > indexTypes;
+
+      /**
+       * The base orientations of the patterns, numbering the index buckets.
+       */
+      static vector< const PropertyType* > indexOrientations;
+
+      /**
+       * The patterns by residue type pair and base orientation, in list
+       * order.  A pattern is in the buckets of both type orders.
+       */
+      static vector< vector< const PairingPattern* > > index;
+
+      /**
+       * All the patterns, in list order.
+       */
+      static vector< const PairingPattern* > allPatterns;
+
       /**
        *
        */
@@ -140,7 +166,7 @@ namespace mccore
       /**
        * Initializes the object.
        */
-      PairingPattern () : name (0), typeA (0), typeB (0), baseOrientation (0), msize (0) { }
+      PairingPattern () : name (0), typeA (0), typeB (0), baseOrientation (0), msize (0), msignature (0) { }
 
     public:
 
@@ -151,7 +177,7 @@ namespace mccore
        * @param type_b the type of another residue.
        */
       PairingPattern (const PropertyType *id, const ResidueType *type_a, const ResidueType *type_b, const PropertyType *ori)
-	: name (id), typeA (type_a), typeB (type_b), baseOrientation (ori), msize (0)
+	: name (id), typeA (type_a), typeB (type_b), baseOrientation (ori), msize (0), msignature (0)
       { }
 
       /**
@@ -165,7 +191,8 @@ namespace mccore
 	  baseOrientation (other.baseOrientation),
 	  AtoB (other.AtoB),
 	  BtoA (other.BtoA),
-	  msize (other.msize)
+	  msize (other.msize),
+	  msignature (other.msignature)
       { }
 
       /**
@@ -238,6 +265,33 @@ namespace mccore
        */
       unsigned int size () const { return msize; }
 
+      /**
+       * Gets the signature of the pattern: a bit set by each non ignored
+       * description.  A flow list may match the pattern only if its
+       * signature holds these bits.
+       * @return the signature.
+       */
+      unsigned long long getSignature () const { return msignature; }
+
+      /**
+       * Gets the signature of a flow list: a bit set by each H-bond, the
+       * bits of getSignature.
+       * @param hbf the HBondFlow list.
+       * @return the signature.
+       */
+      static unsigned long long getSignature (const list< HBondFlow > &hbf);
+
+      /**
+       * Gets the patterns whose residue types and base orientation fit a
+       * pair of residues, in the order of patternList.  Only these
+       * patterns may evaluate to a pairing type.
+       * @param ra a residue.
+       * @param rb another residue.
+       * @param bpori base pair orientation (para or anti).
+       * @return the patterns.
+       */
+      static const vector< const PairingPattern* >& getCandidates (const Residue *ra, const Residue *rb, const PropertyType *bpori);
+
       // METHODS --------------------------------------------------------------
 
       /**
@@ -273,6 +327,29 @@ namespace mccore
        * Initializes the Global vector of pairing patterns
        */
       static void init ();
+
+    private:
+
+      /**
+       * @internal
+       * Gets the signature bit of an H-bond from its atom types.
+       */
+      static unsigned long long _signature_bit (const HBond &hbond);
+
+      /**
+       * @internal
+       * Signs the patterns and fills the index buckets.
+       */
+      static void _build_index ();
+
+      /**
+       * @internal
+       * Gets the number of the pattern residue type that a residue type
+       * is, indexTypes.size () if none and -1 if several.
+       */
+      static int _type_number (const ResidueType *type);
+
+    public:
          
       /**
        * Ouputs the pairing pattern to the stream.
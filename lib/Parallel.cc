@@ -0,0 +1,202 @@
+//                              -*- Mode: C++ -*-
+// Parallel.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "Parallel.h"
+
+
+
+namespace mccore
+{
+
+  /**
+   * @internal
+   * Chunk of work given to a thread.
+   */
+  struct ParallelChunk
+  {
+    ParallelTask *task;
+    unsigned int chunk;
+    unsigned int first;
+    unsigned int last;
+    bool failed;
+    string message;
+  };
+
+
+#ifdef HAVE_PTHREAD
+  /**
+   * @internal
+   * The chunk executed by each thread, null outside tasks.
+   */
+  static pthread_key_t _parallel_chunk_key;
+  static pthread_once_t _parallel_chunk_once = PTHREAD_ONCE_INIT;
+
+
+  extern "C" void
+  _parallel_chunk_key_create ()
+  {
+    pthread_key_create (&_parallel_chunk_key, 0);
+  }
+#endif
+
+
+  static void
+  _parallel_execute (ParallelChunk &c)
+  {
+#ifdef HAVE_PTHREAD
+    void *outer = pthread_getspecific (_parallel_chunk_key);
+
+    pthread_setspecific (_parallel_chunk_key, &c);
+#endif
+    try
+      {
+	c.task->execute (c.chunk, c.first, c.last);
+      }
+    catch (exception &ex)
+      {
+	c.failed = true;
+	c.message = ex.what ();
+      }
+    catch (...)
+      {
+	c.failed = true;
+	c.message = "unknown exception";
+      }
+#ifdef HAVE_PTHREAD
+    pthread_setspecific (_parallel_chunk_key, outer);
+#endif
+  }
+
+
+#ifdef HAVE_PTHREAD
+  extern "C" void*
+  _parallel_start (void *arg)
+  {
+    _parallel_execute (*(ParallelChunk*) arg);
+    return 0;
+  }
+#endif
+
+
+  unsigned int
+  Parallel::getProcessorCount ()
+  {
+    long count = sysconf (_SC_NPROCESSORS_ONLN);
+
+    return 0 < count ? (unsigned int) count : 1;
+  }
+
+
+  unsigned int
+  Parallel::getChunkCount (unsigned int n, unsigned int nthreads)
+  {
+    unsigned int threads = 0 == nthreads ? getProcessorCount () : nthreads;
+
+    return n < threads ? n : threads;
+  }
+
+
+  bool
+  Parallel::inTask ()
+  {
+#ifdef HAVE_PTHREAD
+    pthread_once (&_parallel_chunk_once, _parallel_chunk_key_create);
+    return 0 != pthread_getspecific (_parallel_chunk_key);
+#else
+    return false;
+#endif
+  }
+
+
+  void
+  Parallel::run (ParallelTask &task, unsigned int n, unsigned int nthreads)
+  {
+    unsigned int nchunks = getChunkCount (n, nthreads);
+    unsigned int first;
+    unsigned int i;
+
+    if (1 >= nchunks)
+      {
+	if (0 < n)
+	  task.execute (0, 0, n);
+	return;
+      }
+
+#ifdef HAVE_PTHREAD
+    pthread_once (&_parallel_chunk_once, _parallel_chunk_key_create);
+#endif
+    vector< ParallelChunk > chunks (nchunks);
+
+    for (i = 0, first = 0; i < nchunks; ++i)
+      {
+	chunks[i].task = &task;
+	chunks[i].chunk = i;
+	chunks[i].first = first;
+	first += n / nchunks + (i < n % nchunks ? 1 : 0);
+	chunks[i].last = first;
+	chunks[i].failed = false;
+      }
+
+#ifdef HAVE_PTHREAD
+    vector< pthread_t > threads (nchunks);
+    vector< bool > started (nchunks, false);
+
+    for (i = 1; i < nchunks; ++i)
+      started[i] = 0 == pthread_create (&threads[i], 0, _parallel_start, &chunks[i]);
+
+    _parallel_execute (chunks[0]);
+
+    for (i = 1; i < nchunks; ++i)
+      {
+	if (started[i])
+	  pthread_join (threads[i], 0);
+	else
+	  _parallel_execute (chunks[i]);
+      }
+#else
+    for (i = 0; i < nchunks; ++i)
+      _parallel_execute (chunks[i]);
+#endif
+
+    for (i = 0; i < nchunks; ++i)
+      {
+	if (chunks[i].failed)
+	  {
+	    IntLibException ex ("", __FILE__, __LINE__);
+
+	    ex << "parallel task failed in chunk " << i << ": " << chunks[i].message;
+	    throw ex;
+	  }
+      }
+  }
+
+}
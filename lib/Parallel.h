@@ -0,0 +1,109 @@
+//                              -*- Mode: C++ -*-
+// Parallel.h
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef _mccore_Parallel_h_
+#define _mccore_Parallel_h_
+
+#include "Exception.h"
+
+
+
+namespace mccore
+{
+  /**
+   * @short Work unit for the Parallel helper.
+   *
+   * Derived classes implement execute over a contiguous range of item
+   * indices.  Each chunk is processed by a single thread, so a task can
+   * keep one result slot per chunk and merge them afterwards without
+   * locking.
+   */
+  class ParallelTask
+  {
+  public:
+
+    /**
+     * Destroys the task.
+     */
+    virtual ~ParallelTask () { }
+
+    /**
+     * Processes the items in [first, last).
+     * @param chunk the chunk index, in [0, number of chunks).
+     * @param first the first item index.
+     * @param last the index past the last item.
+     */
+    virtual void execute (unsigned int chunk, unsigned int first, unsigned int last) = 0;
+
+  };
+
+
+
+  /**
+   * @short Minimal fork-join helper over POSIX threads.
+   *
+   * The item range is split in contiguous chunks of equal size, one per
+   * thread; the calling thread processes the first chunk.  When the
+   * library is built without thread support, all chunks are executed
+   * sequentially in the calling thread.  Exceptions thrown by the task are
+   * reported once every chunk is done.
+   */
+  class Parallel
+  {
+  public:
+
+    /**
+     * Gets the number of online processors.
+     * @return the processor count (at least 1).
+     */
+    static unsigned int getProcessorCount ();
+
+    /**
+     * Gets the number of chunks that run will use.
+     * @param n the number of items.
+     * @param nthreads the requested number of threads (0 for one per processor).
+     * @return the number of chunks.
+     */
+    static unsigned int getChunkCount (unsigned int n, unsigned int nthreads);
+
+    /**
+     * Tells whether the calling thread is executing a chunk of a task
+     * run over several chunks.  Code writing shared statistics can use it
+     * to skip them in threads.
+     * @return whether a chunk is being executed.
+     */
+    static bool inTask ();
+
+    /**
+     * Runs the task over the items [0, n).
+     * @param task the task to execute.
+     * @param n the number of items.
+     * @param nthreads the number of threads (0 for one per processor).
+     * @exception IntLibException if the task failed in any chunk.
+     */
+    static void run (ParallelTask &task, unsigned int n, unsigned int nthreads);
+
+  };
+
+}
+
+#endif
@@ -34,6 +34,7 @@
 
 #include "Relation.h"
 
+#include "AnnotationStats.h"
 #include "Atom.h"
 #include "AtomSet.h"
 #include "AtomType.h"
@@ -44,6 +45,7 @@
 #include "PairingPattern.h"
 #include "PropertyType.h"
 #include "ResidueType.h"
+#include "SmallMaximumFlow.h"
 #include "Messagestream.h"
 
 namespace mccore
@@ -72,6 +74,169 @@ namespace mccore
   const float gc_stack_tilt_cutoff                = 0.61;  // 35 deg
   const float gc_stack_overlap_cutoff             = 0.61;  // 35 deg
 
+  /**
+   * Residue reach of the annotations: residues whose bounds are farther
+   * apart are not tested atom by atom (Angstroms), respectively:
+   *
+   * - the O3'-P or C-N bond length cutoff between adjacent residues.
+   * - the base center distance cutoff, the centers lying within the atoms.
+   * - the donor/acceptor distance over which HBond::evalStatistically
+   *   gives no bond.
+   * - the base-backbone H-bond distance cutoff.
+   */
+  const float gc_adjacency_reach = 2.0;
+  const float gc_stack_reach     = 4.5;
+  const float gc_pairing_reach   = 5.0;
+  const float gc_bhbond_reach    = 3.2;
+
+  /**
+   * Face lookup grids: margin around the face points and cell size
+   * (Angstroms).
+   */
+  const float gc_face_grid_margin = 3.0;
+  const float gc_face_grid_cell   = 1.0;
+
+
+  /**
+   * @internal
+   * Lookup grid over the faces of a base, in its local referential.  Each
+   * cell lists, in the faces' order, those that may be the closest to a
+   * point of the cell: a face farther than the farthest corner distance of
+   * some other face is left out.  The closest face is then found among a
+   * few candidates with the same result as a scan of all the faces.
+   * Points outside the grid scan all the faces.
+   */
+  class FaceGrid
+  {
+    typedef vector< pair< Vector3D, const PropertyType* > > Faces;
+
+    const Faces *faces;
+    float lower[3];
+    int dim[3];
+    vector< unsigned int > starts;
+    vector< unsigned char > candidates;
+
+  public:
+
+    FaceGrid () : faces (0) { }
+
+    void build (const Faces &f)
+    {
+      unsigned int x;
+      int c[3];
+      int d;
+
+      faces = &f;
+      for (d = 0; d < 3; ++d)
+	{
+	  float upper = -numeric_limits< float >::max ();
+
+	  lower[d] = numeric_limits< float >::max ();
+	  for (x = 0; x < f.size (); ++x)
+	    {
+	      lower[d] = min (lower[d], _coordinate (f[x].first, d));
+	      upper = max (upper, _coordinate (f[x].first, d));
+	    }
+	  lower[d] -= gc_face_grid_margin;
+	  dim[d] = (int) ceil ((upper + gc_face_grid_margin - lower[d]) / gc_face_grid_cell);
+	}
+
+      starts.assign (1, 0);
+      candidates.clear ();
+      for (c[0] = 0; c[0] < dim[0]; ++c[0])
+	for (c[1] = 0; c[1] < dim[1]; ++c[1])
+	  for (c[2] = 0; c[2] < dim[2]; ++c[2])
+	    {
+	      vector< float > nearest (f.size ());
+	      float bound = numeric_limits< float >::max ();
+
+	      for (x = 0; x < f.size (); ++x)
+		{
+		  float n = 0;
+		  float r = 0;
+
+		  for (d = 0; d < 3; ++d)
+		    {
+		      float a = lower[d] + c[d] * gc_face_grid_cell - _coordinate (f[x].first, d);
+		      float b = a + gc_face_grid_cell;
+		      float e = 0 < a ? a : (b < 0 ? -b : 0);
+		      float g = max (fabs (a), fabs (b));
+
+		      n += e * e;
+		      r += g * g;
+		    }
+		  nearest[x] = sqrt (n);
+		  bound = min (bound, sqrt (r));
+		}
+	      // -- widened against rounding in the distances
+	      bound += 1e-3f;
+	      for (x = 0; x < f.size (); ++x)
+		if (nearest[x] <= bound)
+		  candidates.push_back (x);
+	      starts.push_back (candidates.size ());
+	    }
+    }
+
+    const PropertyType* find (const Vector3D &p) const
+    {
+      unsigned int face_index = 0;
+      unsigned int k;
+      float dist = numeric_limits< float >::max ();
+      int c[3];
+      int d;
+
+      for (d = 0; d < 3; ++d)
+	{
+	  c[d] = (int) floor ((_coordinate (p, d) - lower[d]) / gc_face_grid_cell);
+	  if (0 > c[d] || dim[d] <= c[d])
+	    break;
+	}
+
+      if (3 == d)
+	{
+	  unsigned int cell = (c[0] * dim[1] + c[1]) * dim[2] + c[2];
+
+	  for (k = starts[cell]; k < starts[cell + 1]; ++k)
+	    {
+	      float tmp = p.distance ((*faces)[candidates[k]].first);
+
+	      if (tmp < dist)
+		{
+		  face_index = candidates[k];
+		  dist = tmp;
+		}
+	    }
+	}
+      else
+	for (k = 0; k < faces->size (); ++k)
+	  {
+	    float tmp = p.distance ((*faces)[k].first);
+
+	    if (tmp < dist)
+	      {
+		face_index = k;
+		dist = tmp;
+	      }
+	  }
+
+      return (*faces)[face_index].second;
+    }
+
+  private:
+
+    static float _coordinate (const Vector3D &v, int d)
+    {
+      return 0 == d ? v.getX () : (1 == d ? v.getY () : v.getZ ());
+    }
+
+  };
+
+  /**
+   * @internal
+   * The face lookup grids of A, C, G, U and T, built with the faces.
+   */
+  static FaceGrid gc_face_grids[5];
+
   // STATIC MEMBER  ---------------------------------------------------------
 
   vector< pair< Vector3D, const PropertyType* > > Relation::faces_A;
@@ -82,6 +247,19 @@ namespace mccore
 
   bool Relation::face_init = false;
 
+  bool Relation::pairing_sphere_test = true;
+  float Relation::pairing_normal_cutoff = M_PI / 2;
+  bool Relation::pairing_donor_test = true;
+  bool Relation::pairing_small_flow = true;
+
+  unsigned long Relation::pairing_tested = 0;
+  unsigned long Relation::pairing_bounds_rejects = 0;
+  unsigned long Relation::pairing_sphere_rejects = 0;
+  unsigned long Relation::pairing_normal_rejects = 0;
+  unsigned long Relation::pairing_donor_rejects = 0;
+  unsigned long Relation::pairing_hbonds = 0;
+  unsigned long Relation::pairing_flows = 0;
+
 
 
 
@@ -201,6 +379,23 @@ namespace mccore
   // METHODS --------------------------------------------------------------
 
 
+  void
+  Relation::swap (Relation &other)
+  {
+    std::swap (ref, other.ref);
+    std::swap (res, other.res);
+    std::swap (tfo, other.tfo);
+    std::swap (po4_tfo, other.po4_tfo);
+    std::swap (refFace, other.refFace);
+    std::swap (resFace, other.resFace);
+    std::swap (type_aspb, other.type_aspb);
+    labels.swap (other.labels);
+    hbonds.swap (other.hbonds);
+    std::swap (sum_flow, other.sum_flow);
+    pairedFaces.swap (other.pairedFaces);
+  }
+
+
   bool
   Relation::is (const PropertyType* t) const
   {
@@ -219,12 +414,21 @@ namespace mccore
   }
 
 
+  void
+  Relation::initTables ()
+  {
+    if (! Relation::face_init)
+      Relation::init ();
+    PairingPattern::patternList ();
+  }
+
+
   void
   Relation::reset (const Residue* org, const Residue* dest)
   {
     ref = org;
     res = dest;
-    tfo = ref->getReferential ().invert () * res->getReferential ();
+    tfo = ref->getReferentialInverse () * res->getReferential ();
     po4_tfo.setIdentity ();
     refFace = resFace = PropertyType::pNull;
     labels.clear ();
@@ -332,8 +536,32 @@ namespace mccore
   }
 
 
+  void
+  Relation::addPairingStats (const AnnotationStats &stats)
+  {
+    pairing_tested += stats.getPairingTested ();
+    pairing_bounds_rejects += stats.getBoundsRejects ();
+    pairing_sphere_rejects += stats.getSphereRejects ();
+    pairing_normal_rejects += stats.getNormalRejects ();
+    pairing_donor_rejects += stats.getDonorRejects ();
+    pairing_hbonds += stats.getHBonds ();
+    pairing_flows += stats.getFlows ();
+  }
+
+
   bool
   Relation::annotate (unsigned char aspb)
+  {
+    AnnotationStats stats;
+    bool found = annotate (aspb, stats);
+
+    addPairingStats (stats);
+    return found;
+  }
+
+
+  bool
+  Relation::annotate (unsigned char aspb, AnnotationStats &stats)
   {
     if (0 != (aspb & Relation::adjacent_mask))
     {
@@ -347,7 +575,7 @@ namespace mccore
 
     if (0 != (aspb & Relation::pairing_mask))
     {
-      arePaired ();
+      arePaired (stats);
     }
 
     if (0 != (aspb & Relation::bhbond_mask))
@@ -365,6 +593,12 @@ namespace mccore
     Residue::const_iterator up, down;
     const PropertyType * adj_type = PropertyType::pNull;
 
+    if (! ref->mayBeWithin (*res, gc_adjacency_reach))
+      {
+	po4_tfo.setIdentity ();
+	return;
+      }
+
     if (ref->end () != (down = ref->find (AtomType::aO3p)) &&
 	res->end () != (up = res->find (AtomType::aP)) &&
 	down->squareDistance (*up) <= gc_adjacency_distance_cutoff_square)
@@ -430,7 +664,7 @@ namespace mccore
 	    }
 
 	  pRes.finalize ();
-	  po4_tfo = ref->getReferential ().invert () * pRes.getReferential ();
+	  po4_tfo = ref->getReferentialInverse () * pRes.getReferential ();
 	}
       catch (IntLibException& ex)
 	{
@@ -443,52 +677,43 @@ namespace mccore
   void
   Relation::areBHBonded ()
   {
-    Residue::const_iterator i;
-    Residue::const_iterator j;
-    Residue::const_iterator k;
-    Residue::const_iterator l;
-    AtomSetOr as (new AtomSetSideChain (),
-		  new AtomSetOr (new AtomSetAtom (AtomType::aO2p),
-				 new AtomSetOr (new AtomSetAtom (AtomType::aO2P),
-						new AtomSetAtom (AtomType::aO1P))));
-
     if (ref->getType ()->isNucleicAcid ()
-	&& res->getType ()->isNucleicAcid ())
+	&& res->getType ()->isNucleicAcid ()
+	&& ref->mayBeWithin (*res, gc_bhbond_reach))
       {
-	for (i = ref->begin (as); ref->end () != i; ++i)
+	const vector< const Atom* > &ref_at = ref->getBHBondAtoms ();
+	const vector< const Atom* > &res_at = res->getBHBondAtoms ();
+	vector< const Atom* >::const_iterator i;
+	vector< const Atom* >::const_iterator j;
+
+	for (i = ref_at.begin (); ref_at.end () != i; ++i)
 	  {
-	    if (i->getType ()->isNitrogen () || i->getType ()->isOxygen ())
+	    for (j = res_at.begin (); res_at.end () != j; ++j)
 	      {
-		for (j = res->begin (as); res->end () != j; ++j)
+		const AtomType *refType = (*i)->getType ();
+		const AtomType *resType = (*j)->getType ();
+
+		if (((refType->isNitrogen () && resType->isBackbone ())
+		     || (resType->isNitrogen () && refType->isBackbone ()))
+		    && (*i)->distance (**j) > HBOND_DIST_MAX
+		    && (*i)->distance (**j) < 3.2)
 		  {
-		    if (((i->getType ()->isNitrogen ()
-			  && j->getType ()->isBackbone ())
-			 || (j->getType ()->isNitrogen ()
-			     && i->getType ()->isBackbone ()))
-			&& i->distance (*j) > HBOND_DIST_MAX
-			&& i->distance (*j) < 3.2)
-		      {
-			const PropertyType *refface;
-			const PropertyType *resface;
-			const AtomType *refType;
-			const AtomType *resType;
-
-			labels.insert (PropertyType::pBHbond);
-			type_aspb |= Relation::bhbond_mask;
-			refType = i->getType ();
-			resType = j->getType ();
-			refface = (refType->isNitrogen ()
-				   ? getFace (ref, *ref->safeFind (refType))
-				   : (AtomType::aO2p == refType
-				      ? PropertyType::pRibose
-				      : PropertyType::pPhosphate));
-			resface = (resType->isNitrogen ()
-				   ? getFace (res, *res->safeFind (resType))
-				   : (AtomType::aO2p == resType
-				      ? PropertyType::pRibose
-				      : PropertyType::pPhosphate));
-			pairedFaces.push_back (make_pair (refface, resface));
-		      }
+		    const PropertyType *refface;
+		    const PropertyType *resface;
+
+		    labels.insert (PropertyType::pBHbond);
+		    type_aspb |= Relation::bhbond_mask;
+		    refface = (refType->isNitrogen ()
+			       ? getFace (ref, **i)
+			       : (AtomType::aO2p == refType
+				  ? PropertyType::pRibose
+				  : PropertyType::pPhosphate));
+		    resface = (resType->isNitrogen ()
+			       ? getFace (res, **j)
+			       : (AtomType::aO2p == resType
+				  ? PropertyType::pRibose
+				  : PropertyType::pPhosphate));
+		    pairedFaces.push_back (make_pair (refface, resface));
 		  }
 	      }
 	  }
@@ -640,168 +865,123 @@ namespace mccore
   void
   Relation::arePaired ()
   {
-    typedef MaximumFlowGraph< unsigned int, HBond > HBondFlowGraph;
-    typedef map< Residue::const_iterator, unsigned int > AtomToInt;
+    AnnotationStats stats;
 
-    try
-      {
-	Residue::const_iterator i;
-	Residue::const_iterator j;
-	Residue::const_iterator k;
-	Residue::const_iterator l;
-	AtomToInt atomToInt;
-	unsigned int node;
-	HBondFlowGraph graph;
-	vector< Residue::const_iterator > ref_at;
-	vector< Residue::const_iterator > refn_at;
-	vector< Residue::const_iterator > res_at;
-	vector< Residue::const_iterator > resn_at;
-	vector< Residue::const_iterator >::size_type x;
-	vector< Residue::const_iterator >::size_type y;
-	AtomSetAnd da (new AtomSetSideChain (),
-		       new AtomSetNot (new AtomSetOr (new AtomSetAtom (AtomType::a2H5M),
-						      new AtomSetAtom (AtomType::a3H5M))));
-
-	node = 0;
-	graph.insert (node++, 1); // Source
-	graph.insert (node++, 1); // Sink
-
-	for (i = ref->begin (da); i != ref->end (); ++i)
-	  {
-	    if ((i->getType ()->isCarbon ()
-		 || i->getType ()->isNitrogen ()
-		 || i->getType ()->isOxygen ()))
-	      {
-		for (j = ref->begin (da); j != ref->end (); ++j)
-		  {
-		    if ((j->getType ()->isHydrogen ()
-			 || j->getType ()->isLonePair ())
-			&& i->distance (*j) < HBOND_DIST_MAX)
-		      {
-			ref_at.push_back (j);
-			refn_at.push_back (i);
-		      }
-		  }
-	      }
-	  }
+    arePaired (stats);
+    addPairingStats (stats);
+  }
 
-	for (i = res->begin (da); i != res->end (); ++i)
-	  {
-	    if ((i->getType ()->isCarbon ()
-		 || i->getType ()->isNitrogen ()
-		 || i->getType ()->isOxygen ()))
-	      {
-		for (j = res->begin (da); j != res->end (); ++j)
-		  {
-		    if ((j->getType ()->isHydrogen ()
-			 || j->getType ()->isLonePair ())
-			&& i->distance (*j) < HBOND_DIST_MAX)
-		      {
-			res_at.push_back (j);
-			resn_at.push_back (i);
-		      }
-		  }
-	      }
-	  }
 
+  void
+  Relation::arePaired (AnnotationStats &stats)
+  {
+    typedef vector< pair< const Atom*, const Atom* > > AtomCouples;
+
+    stats.addPairingTested ();
+
+    // -- no H-bond can be found, as with a graph without edges
+    if (! ref->mayBeWithin (*res, gc_pairing_reach))
+      {
+	stats.addBoundsReject ();
+	hbonds.clear ();
+	return;
+      }
+    if (! _pairing_prefilter (stats))
+      {
+	hbonds.clear ();
+	return;
+      }
+
+    try
+      {
+	const Atom *i;
+	const Atom *j;
+	const Atom *k;
+	const Atom *l;
+	unsigned int nodes;
+	const AtomCouples &ref_at = ref->getHBondCouples ();
+	const AtomCouples &res_at = res->getHBondCouples ();
+	AtomCouples::size_type x;
+	AtomCouples::size_type y;
+	vector< HBond > candidates;
+	AtomCouples ends;
+	vector< Vector3D > donors;
+	vector< Vector3D > hydrogens;
+	vector< Vector3D > acceptors;
+	vector< Vector3D > lonepairs;
+	vector< float > values;
+	vector< HBond >::size_type c;
+
+	// -- the candidate buffers are reserved once for all combinations
+	c = ref_at.size () * res_at.size ();
+	candidates.reserve (c);
+	ends.reserve (c);
+	donors.reserve (c);
+	hydrogens.reserve (c);
+	acceptors.reserve (c);
+	lonepairs.reserve (c);
+	values.reserve (c);
+
+	// -- the donor/acceptor combinations, with their (hydrogen, lone
+	//    pair) ends, evaluated together
 	for (x = 0; x < ref_at.size (); ++x)
 	  {
-	    i = ref_at[x];
-	    j = refn_at[x];
+	    i = ref_at[x].second;
+	    j = ref_at[x].first;
 	    for (y = 0; y < res_at.size (); ++y)
 	      {
-		k = res_at[y];
-		l = resn_at[y];
+		k = res_at[y].second;
+		l = res_at[y].first;
 
 		if (i->getType ()->isHydrogen () && k->getType ()->isLonePair ())
 		  {
-		    HBond h (j->getType (), i->getType (), l->getType (), k->getType ());
-
-		    h.evalStatistically (ref, res);
-#ifdef DEBUG
-		    gOut (4) << h << endl;
-#endif
-		    if (h.getValue () > 0.01)
-		      {
-			HBond fake (1);
-			pair< AtomToInt::iterator, bool > iIt = atomToInt.insert (make_pair (i, node));
-
-			if (iIt.second)
-			  {
-			    graph.insert (node, 1);
-			    graph.internalConnect (0, node, fake, 0);
-			    ++node;
-			  }
-			pair< AtomToInt::iterator, bool > kIt = atomToInt.insert (make_pair (k, node));
-			if (kIt.second)
-			  {
-			    graph.insert (node, 1);
-			    graph.internalConnect (node, 1, fake, 0);
-			    ++node;
-			  }
-			graph.internalConnect (iIt.first->second, kIt.first->second, h, 0);
-		      }
+		    candidates.push_back (HBond (j->getType (), i->getType (), l->getType (), k->getType ()));
+		    candidates.back ().resD = ref;
+		    candidates.back ().resA = res;
+		    ends.push_back (make_pair (i, k));
+		    donors.push_back (*j);
+		    hydrogens.push_back (*i);
+		    acceptors.push_back (*l);
+		    lonepairs.push_back (*k);
 		  }
 		else if (k->getType ()->isHydrogen () && i->getType ()->isLonePair ())
 		  {
-		    HBond h (l->getType (), k->getType (), j->getType (), i->getType ());
-
-		    h.evalStatistically (res, ref);
-#ifdef DEBUG
-		    gOut (4) << h << endl;
-#endif
-		    if (h.getValue () > 0.01)
-		      {
-			HBond fake (1);
-			pair< AtomToInt::iterator, bool > kIt = atomToInt.insert (make_pair (k, node));
-
-			if (kIt.second)
-			  {
-			    graph.insert (node, 1);
-			    graph.internalConnect (0, node, fake, 0);
-			    ++node;
-			  }
-			pair< AtomToInt::iterator, bool > iIt = atomToInt.insert (make_pair (i, node));
-			if (iIt.second)
-			  {
-			    graph.insert (node, 1);
-			    graph.internalConnect (node, 1, fake, 0);
-			    ++node;
-			  }
-			graph.internalConnect (kIt.first->second, iIt.first->second, h, 0);
-		      }
+		    candidates.push_back (HBond (l->getType (), k->getType (), j->getType (), i->getType ()));
+		    candidates.back ().resD = res;
+		    candidates.back ().resA = ref;
+		    ends.push_back (make_pair (k, i));
+		    donors.push_back (*l);
+		    hydrogens.push_back (*k);
+		    acceptors.push_back (*j);
+		    lonepairs.push_back (*i);
 		  }
 	      }
 	  }
 
-#ifdef DEBUG
-	gOut (4) << graph << endl;
-#endif
+	HBond::evalStatistically (donors, hydrogens, acceptors, lonepairs, values);
+	stats.addHBonds (candidates.size ());
 
-	if (graph.size () >= 3)
+	for (c = 0; c < candidates.size (); ++c)
 	  {
-	    HBondFlowGraph::size_type label;
-
-	    graph.preFlowPush (0, 1);
+	    HBond &h = candidates[c];
 
+	    // -- the hydrogen of a methyl donor is placed by the evaluation
+	    if (AtomType::aC5M == h.donor)
+	      h.evalStatistically (h.resD, h.resA);
+	    else
+	      h.value = values[c];
 #ifdef DEBUG
-	    gOut (4) << graph << endl;
+	    gOut (4) << h << endl;
 #endif
+	  }
 
-	    for (label = 0; label < graph.edgeSize (); ++label)
-	      {
-		HBond &hbond = graph.internalGetEdge (label);
-
-		if (0 != hbond.getDonorType ())
-		  {
-		    float flow;
-
-		    flow = graph.internalGetEdgeWeight (label);
-		    sum_flow += flow;
-		    hbonds.push_back (HBondFlow (hbond, flow));
-		  }
-	      }
+	if (! pairing_small_flow
+	    || ! _small_pairing_flows (candidates, ends, nodes))
+	  _graph_pairing_flows (candidates, ends, nodes);
 
+	if (nodes >= 3)
+	  {
+	    stats.addFlow ();
 #ifdef DEBUG
 	    gOut (4) << "Pairing annotation sum flow = " << sum_flow << endl;
 #endif
@@ -815,7 +995,7 @@ namespace mccore
 	else
 	  {
 #ifdef DEBUG
-	    gOut (4) << "MaximumFlowGraph.size () = " << graph.size ()
+	    gOut (4) << "MaximumFlowGraph.size () = " << nodes
 		     << endl << hbonds << endl;
 #endif
 	    hbonds.clear ();
@@ -828,6 +1008,214 @@ namespace mccore
   }
 
 
+  bool
+  Relation::_small_pairing_flows (const vector< HBond > &candidates, const vector< pair< const Atom*, const Atom* > > &ends, unsigned int &nodes)
+  {
+    typedef SmallMaximumFlow< 32, 96 > HBondFlowNetwork;
+
+    HBondFlowNetwork network;
+    const Atom *atoms[32];
+    unsigned int hbondEdges[96];
+    vector< HBond >::size_type c;
+    unsigned int e;
+
+    network.insert (); // Source
+    network.insert (); // Sink
+
+    // -- the vertices are numbered as in _graph_pairing_flows, a hydrogen
+    //    or lone pair being a single vertex
+    for (c = 0; c < candidates.size (); ++c)
+      {
+	const HBond &h = candidates[c];
+
+	if (h.getValue () > 0.01)
+	  {
+	    unsigned int d;
+	    unsigned int a;
+
+	    for (d = 2; d < network.size () && atoms[d] != ends[c].first; ++d)
+	      ;
+	    if (network.size () == d)
+	      {
+		if (! network.insert ()
+		    || ! network.connect (0, d, HBond (1).getValue ()))
+		  return false;
+		atoms[d] = ends[c].first;
+		hbondEdges[network.edgeSize () - 1] = candidates.size ();
+	      }
+	    for (a = 2; a < network.size () && atoms[a] != ends[c].second; ++a)
+	      ;
+	    if (network.size () == a)
+	      {
+		if (! network.insert ()
+		    || ! network.connect (a, 1, HBond (1).getValue ()))
+		  return false;
+		atoms[a] = ends[c].second;
+		hbondEdges[network.edgeSize () - 1] = candidates.size ();
+	      }
+	    if (! network.connect (d, a, h.getValue ()))
+	      return false;
+	    hbondEdges[network.edgeSize () - 1] = c;
+	  }
+      }
+
+    nodes = network.size ();
+    if (nodes >= 3)
+      {
+	if (! network.preFlowPush (0, 1))
+	  return false;
+	for (e = 0; e < network.edgeSize (); ++e)
+	  if (candidates.size () != hbondEdges[e])
+	    {
+	      float flow = network.getFlow (e);
+
+	      sum_flow += flow;
+	      hbonds.push_back (HBondFlow (candidates[hbondEdges[e]], flow));
+	    }
+      }
+    return true;
+  }
+
+
+  void
+  Relation::_graph_pairing_flows (const vector< HBond > &candidates, const vector< pair< const Atom*, const Atom* > > &ends, unsigned int &nodes)
+  {
+    typedef MaximumFlowGraph< unsigned int, HBond > HBondFlowGraph;
+    typedef map< pair< const Residue*, const Atom* >, unsigned int > AtomToInt;
+
+    AtomToInt atomToInt;
+    unsigned int node;
+    HBondFlowGraph graph;
+    vector< HBond >::size_type c;
+
+    node = 0;
+    graph.insert (node++, 1); // Source
+    graph.insert (node++, 1); // Sink
+
+    for (c = 0; c < candidates.size (); ++c)
+      {
+	const HBond &h = candidates[c];
+
+	if (h.getValue () > 0.01)
+	  {
+	    HBond fake (1);
+	    pair< AtomToInt::iterator, bool > dIt = atomToInt.insert (make_pair (make_pair (h.resD, ends[c].first), node));
+
+	    if (dIt.second)
+	      {
+		graph.insert (node, 1);
+		graph.internalConnect (0, node, fake, 0);
+		++node;
+	      }
+	    pair< AtomToInt::iterator, bool > aIt = atomToInt.insert (make_pair (make_pair (h.resA, ends[c].second), node));
+	    if (aIt.second)
+	      {
+		graph.insert (node, 1);
+		graph.internalConnect (node, 1, fake, 0);
+		++node;
+	      }
+	    graph.internalConnect (dIt.first->second, aIt.first->second, h, 0);
+	  }
+      }
+
+#ifdef DEBUG
+    gOut (4) << graph << endl;
+#endif
+
+    nodes = graph.size ();
+    if (nodes >= 3)
+      {
+	HBondFlowGraph::size_type label;
+
+	graph.preFlowPush (0, 1);
+
+#ifdef DEBUG
+	gOut (4) << graph << endl;
+#endif
+
+	for (label = 0; label < graph.edgeSize (); ++label)
+	  {
+	    HBond &hbond = graph.internalGetEdge (label);
+
+	    if (0 != hbond.getDonorType ())
+	      {
+		float flow;
+
+		flow = graph.internalGetEdgeWeight (label);
+		sum_flow += flow;
+		hbonds.push_back (HBondFlow (hbond, flow));
+	      }
+	  }
+      }
+  }
+
+
+  bool
+  Relation::_pairing_prefilter (AnnotationStats &stats) const
+  {
+    typedef vector< pair< const Atom*, const Atom* > > AtomCouples;
+
+    if (pairing_sphere_test)
+      {
+	Vector3D refCenter;
+	Vector3D resCenter;
+	float refRadius;
+	float resRadius;
+
+	if (! ref->getHBondSphere (refCenter, refRadius)
+	    || ! res->getHBondSphere (resCenter, resRadius)
+	    || (refCenter.distance (resCenter) - refRadius - resRadius
+		> gc_pairing_reach))
+	  {
+	    stats.addSphereReject ();
+	    return false;
+	  }
+      }
+
+    if (pairing_normal_cutoff < M_PI / 2
+	&& ref->getType ()->isNucleicAcid ()
+	&& res->getType ()->isNucleicAcid ())
+      {
+	try
+	  {
+	    const Vector3D &refNormal = ref->getPyrimidineRingNormal ();
+	    const Vector3D &resNormal = res->getPyrimidineRingNormal ();
+
+	    if (acos (min (fabs (refNormal.dot (resNormal)), 1.0f)) > pairing_normal_cutoff)
+	      {
+		stats.addNormalReject ();
+		return false;
+	      }
+	  }
+	catch (IntLibException &ex)
+	  {
+	    // -- the bases are left to the full evaluation
+	  }
+      }
+
+    if (pairing_donor_test)
+      {
+	const AtomCouples &ref_at = ref->getHBondCouples ();
+	const AtomCouples &res_at = res->getHBondCouples ();
+	AtomCouples::const_iterator x;
+	AtomCouples::const_iterator y;
+
+	// -- a candidate needs a donor within the reach of an acceptor,
+	//    the precheck of HBond::evalStatistically
+	for (x = ref_at.begin (); ref_at.end () != x; ++x)
+	  for (y = res_at.begin (); res_at.end () != y; ++y)
+	    if (((x->second->getType ()->isHydrogen () && y->second->getType ()->isLonePair ())
+		 || (y->second->getType ()->isHydrogen () && x->second->getType ()->isLonePair ()))
+		&& x->first->distance (*y->first) <= gc_pairing_reach)
+	      return true;
+	stats.addDonorReject ();
+	return false;
+      }
+
+    return true;
+  }
+
+
   void
   Relation::addPairingLabels ()
   {
@@ -850,9 +1238,7 @@ namespace mccore
       }
 
     // -- parallel/antiparallel orientation
-    bpo = (Relation::_pyrimidine_ring_normal (*ref,
-					      Relation::_pyrimidine_ring_center (*ref)).dot (Relation::_pyrimidine_ring_normal (*res,
-																Relation::_pyrimidine_ring_center (*res))) > 0
+    bpo = (ref->getPyrimidineRingNormal ().dot (res->getPyrimidineRingNormal ()) > 0
 	   ? PropertyType::pParallel
 	   : PropertyType::pAntiparallel);
     labels.insert (bpo);
@@ -907,8 +1293,8 @@ namespace mccore
       }
 
     // -- cis/trans orientation
-    Vector3D refpyr = Relation::_pyrimidine_ring_center (*ref);
-    Vector3D respyr = Relation::_pyrimidine_ring_center (*res);
+    const Vector3D &refpyr = ref->getPyrimidineRingCenter ();
+    const Vector3D &respyr = res->getPyrimidineRingCenter ();
 
     pc = *ref->safeFind (AtomType::aC1p);
     pc = pc - *ref->safeFind (AtomType::aPSY);
@@ -921,64 +1307,6 @@ namespace mccore
   }
 
 
-  Vector3D
-  Relation::_pyrimidine_ring_center (const Residue& res)
-  {
-    return (*(res.safeFind (AtomType::aN1)) + *(res.safeFind (AtomType::aC2)) +
-	    *(res.safeFind (AtomType::aN3)) + *(res.safeFind (AtomType::aC4)) +
-	    *(res.safeFind (AtomType::aC5)) + *(res.safeFind (AtomType::aC6))) / 6.0;
-  }
-
-
-  Vector3D
-  Relation::_imidazole_ring_center (const Residue& res)
-  {
-    return (*(res.safeFind (AtomType::aC4)) + *(res.safeFind (AtomType::aC5)) +
-	    *(res.safeFind (AtomType::aN7)) + *(res.safeFind (AtomType::aC8)) +
-	    *(res.safeFind (AtomType::aN9))) / 5.0;
-  }
-
-
-  Vector3D
-  Relation::_pyrimidine_ring_normal (const Residue& res, const Vector3D& center)
-  {
-    Vector3D r1 = (((*(res.safeFind (AtomType::aN1)) - center) * 1) +
-		   ((*(res.safeFind (AtomType::aC2)) - center) * 0.5) +
-		   ((*(res.safeFind (AtomType::aN3)) - center) * -0.5) +
-		   ((*(res.safeFind (AtomType::aC4)) - center) * -1) +
-		   ((*(res.safeFind (AtomType::aC5)) - center) * -0.5) +
-		   ((*(res.safeFind (AtomType::aC6)) - center) * 0.5));
-
-    Vector3D r2 = (((*(res.safeFind (AtomType::aC2)) - center) * 0.8660254) +
-		   ((*(res.safeFind (AtomType::aN3)) - center) * 0.8660254) +
-		   ((*(res.safeFind (AtomType::aC5)) - center) * -0.8660254) +
-		   ((*(res.safeFind (AtomType::aC6)) - center) * -0.8660254));
-
-    if (res.getType ()->isPurine ())
-      return -(r1.cross (r2).normalize ());
-
-    return r1.cross (r2).normalize ();
-  }
-
-
-  Vector3D
-  Relation::_imidazole_ring_normal (const Residue& res, const Vector3D& center)
-  {
-    Vector3D r1 = (((*(res.safeFind (AtomType::aC4)) - center) * 1) +
-		   ((*(res.safeFind (AtomType::aC5)) - center) * 0.30901699) +
-		   ((*(res.safeFind (AtomType::aN7)) - center) * -0.80901699) +
-		   ((*(res.safeFind (AtomType::aC8)) - center) * -0.80901699) +
-		   ((*(res.safeFind (AtomType::aN9)) - center) * 0.30901699));
-
-    Vector3D r2 = (((*(res.safeFind (AtomType::aC5)) - center) * 0.95105652) +
-		   ((*(res.safeFind (AtomType::aN7)) - center) * 0.58778525) +
-		   ((*(res.safeFind (AtomType::aC8)) - center) * -0.58778525) +
-		   ((*(res.safeFind (AtomType::aN9)) - center) * -0.95105652));
-
-    return r1.cross (r2).normalize ();
-  }
-
-
   const PropertyType*
   Relation::_ring_stacking (const Vector3D& centerA, const Vector3D& normalA,
 			    const Vector3D& centerB, const Vector3D& normalB)
@@ -1060,7 +1388,9 @@ namespace mccore
   void
   Relation::areStacked ()
   {
-    if (ref->getType ()->isNucleicAcid () && res->getType ()->isNucleicAcid ())
+    if (ref->getType ()->isNucleicAcid ()
+	&& res->getType ()->isNucleicAcid ()
+	&& ref->mayBeWithin (*res, gc_stack_reach))
       {
 	try
 	  {
@@ -1077,18 +1407,19 @@ namespace mccore
 	      11 (3) => Pyr / Pyr:                                         pyr /  pyr
 	    */
 
-	    pyrCA = Relation::_pyrimidine_ring_center (*ref);
-	    pyrNA = Relation::_pyrimidine_ring_normal (*ref, pyrCA);
+	    // -- the ring geometry is cached by the residues
+	    pyrCA = ref->getPyrimidineRingCenter ();
+	    pyrNA = ref->getPyrimidineRingNormal ();
 
-	    pyrCB = Relation::_pyrimidine_ring_center (*res);
-	    pyrNB = Relation::_pyrimidine_ring_normal (*res, pyrCB);
+	    pyrCB = res->getPyrimidineRingCenter ();
+	    pyrNB = res->getPyrimidineRingNormal ();
 
 	    if (ref->getType ()->isPurine ())
 	      {
 		rtypes = 0;
 		//pyrNA = -pyrNA;
-		imidCA = Relation::_imidazole_ring_center (*ref);
-		imidNA = Relation::_imidazole_ring_normal (*ref, imidCA);
+		imidCA = ref->getImidazoleRingCenter ();
+		imidNA = ref->getImidazoleRingNormal ();
 	      }
 	    else if (ref->getType ()->isPyrimidine ())
 	      {
@@ -1105,8 +1436,8 @@ namespace mccore
 	    if (res->getType ()->isPurine ())
 	      {
 		//pyrNB = -pyrNB;
-		imidCB = Relation::_imidazole_ring_center (*res);
-		imidNB = Relation::_imidazole_ring_normal (*res, imidCB);
+		imidCB = res->getImidazoleRingCenter ();
+		imidNB = res->getImidazoleRingNormal ();
 	      }
 	    else if (res->getType ()->isPyrimidine ())
 	      {
@@ -1193,7 +1524,7 @@ namespace mccore
     labels = lt;
     for (pfit = pairedFaces.begin (); pairedFaces.end () != pfit; ++pfit)
       {
-	swap (pfit->first, pfit->second);
+	std::swap (pfit->first, pfit->second);
       }
     return *this;
   }
@@ -1275,50 +1606,32 @@ namespace mccore
     if (!Relation::face_init)
       Relation::init ();
 
-    HomogeneousTransfo t;
-    t = r->getReferential ();
-    t = t.invert ();
-    Vector3D pp = t * p;
-    vector< pair< Vector3D, const PropertyType* > > *faces = 0;
+    const FaceGrid *grid = 0;
 
     if (r->getType ()->isA ())
       {
-	faces = &faces_A;
+	grid = &gc_face_grids[0];
       }
     else if (r->getType ()->isC ())
       {
-	faces = &faces_C;
+	grid = &gc_face_grids[1];
       }
     else if (r->getType ()->isG ())
       {
-	faces = &faces_G;
+	grid = &gc_face_grids[2];
       }
     else if (r->getType ()->isU ())
       {
-	faces = &faces_U;
+	grid = &gc_face_grids[3];
       }
     else if (r->getType ()->isT ())
       {
-	faces = &faces_T;
+	grid = &gc_face_grids[4];
       }
 
-    if (0 != faces)
+    if (0 != grid)
       {
-	int face_index = 0;
-	unsigned int x;
-	float dist = numeric_limits< float >::max ();
-
-	for (x = 0; x < faces->size (); ++x)
-	  {
-	    float tmp = pp.distance ((*faces)[x].first);
-	    if (tmp < dist)
-	      {
-		face_index = x;
-		dist = tmp;
-	      }
-	  }
-
-	return (*faces)[face_index].second;
+	return grid->find (r->getReferentialInverse () * p);
       }
     else
       {
@@ -1459,6 +1772,12 @@ namespace mccore
 	ta = *T.safeFind (AtomType::a1LP2);
 	Relation::faces_T.push_back (make_pair (ta, PropertyType::pSs));
 
+	gc_face_grids[0].build (Relation::faces_A);
+	gc_face_grids[1].build (Relation::faces_C);
+	gc_face_grids[2].build (Relation::faces_G);
+	gc_face_grids[3].build (Relation::faces_U);
+	gc_face_grids[4].build (Relation::faces_T);
+
 	Relation::face_init = true;
       }
     catch (IntLibException& ex)
@@ -1474,23 +1793,24 @@ namespace mccore
   const PropertyType*
   Relation::translatePairing (const Residue *ra, const Residue *rb, const PropertyType *bpo, list< HBondFlow > &hbf, float total_flow, unsigned int size_hint)
   {
-    list< PairingPattern >::const_iterator i;
+    const vector< const PairingPattern* > &candidates = PairingPattern::getCandidates (ra, rb, bpo);
+    vector< const PairingPattern* >::const_iterator i;
+    unsigned long long signature = PairingPattern::getSignature (hbf);
     const PropertyType *type;
     const PropertyType *best_type = 0;
     unsigned int best_size = 0;
 
-    for (i = PairingPattern::patternList ().begin ();
-	 i != PairingPattern::patternList().end ();
-	 ++i)
+    // -- only the patterns of the residue types whose H-bonds are all in
+    //    the flows can match
+    for (i = candidates.begin (); candidates.end () != i; ++i)
       {
-	if (size_hint >= (*i).size ()
-	    && (type = (*i).evaluate (ra, rb, bpo, hbf)) != 0)
+	if (size_hint >= (*i)->size ()
+	    && (*i)->size () > best_size
+	    && 0 == ((*i)->getSignature () & ~signature)
+	    && (type = (*i)->evaluate (ra, rb, bpo, hbf)) != 0)
 	  {
-	    if ((*i).size () > best_size)
-	      {
-		best_size = (*i).size ();
-		best_type = type;
-	      }
+	    best_size = (*i)->size ();
+	    best_type = type;
 	  }
       }
     return best_type;
@@ -46,6 +46,7 @@ using namespace std;
 
 namespace mccore
 {
+  class AnnotationStats;
   class PropertyType;
   class iBinstream;
   class oBinstream;
@@ -175,6 +176,37 @@ namespace mccore
 
     static bool face_init;
 
+  private:
+
+    /**
+     * Pairing prefilter settings, see setPairingSphereTest,
+     * setPairingNormalCutoff and setPairingDonorTest.
+     */
+    static bool pairing_sphere_test;
+    static float pairing_normal_cutoff;
+    static bool pairing_donor_test;
+
+    /**
+     * Pairing flow solver setting, see setPairingSmallFlow.
+     */
+    static bool pairing_small_flow;
+
+    /**
+     * Pairing prefilter statistics, shared by all relations: the tested
+     * residue pairs and the rejections of each stage.  The relations
+     * annotated with their own statistics are only counted once these are
+     * added by addPairingStats.
+     */
+    static unsigned long pairing_tested;
+    static unsigned long pairing_bounds_rejects, pairing_sphere_rejects;
+    static unsigned long pairing_normal_rejects, pairing_donor_rejects;
+
+    /**
+     * Pairing evaluation statistics, shared by all relations: the H-bonds
+     * evaluated and the maximum flow networks solved.
+     */
+    static unsigned long pairing_hbonds, pairing_flows;
+
   public:
     
     // LIFECYCLE ------------------------------------------------------------
@@ -328,6 +360,13 @@ namespace mccore
 
     // METHODS --------------------------------------------------------------
 
+    /**
+     * Exchanges the object's content with the other's.  The labels, faces
+     * and H-bond containers are swapped, not copied.
+     * @param other the object with which to exchange content.
+     */
+    void swap (Relation &other);
+
     /**
      * Check if a label or its children is in the annotation.
      * @param t The property type label to find.
@@ -385,6 +424,136 @@ namespace mccore
      */
     static unsigned char parseAnnotationMask (const string& mask_str) throw (IntLibException);
 
+    /**
+     * Builds the shared tables of the annotation, which are otherwise
+     * built on first use.  It must be called before relations are
+     * annotated in several threads.
+     */
+    static void initTables ();
+
+    /**
+     * Sets whether the pairing prefilter tests the spheres of the
+     * residues' H-bond atoms against the donor/acceptor reach (default
+     * true).  This stage never changes the annotations.  The prefilter
+     * settings are not synchronized: changing them while annotate
+     * (nthreads) runs is undefined.
+     * @param test whether the spheres are tested.
+     */
+    static void setPairingSphereTest (bool test) { pairing_sphere_test = test; }
+
+    /**
+     * Gets whether the pairing prefilter tests the H-bond atom spheres.
+     * @return whether the spheres are tested.
+     */
+    static bool getPairingSphereTest () { return pairing_sphere_test; }
+
+    /**
+     * Sets the largest angle between the base normals of two nucleic
+     * acids tested for pairing (radians, default pi/2 which rejects
+     * nothing).  A cutoff under pi/2 may change the annotations.  Changing
+     * it while annotate (nthreads) runs is undefined.
+     * @param cutoff the normal angle cutoff.
+     */
+    static void setPairingNormalCutoff (float cutoff) { pairing_normal_cutoff = cutoff; }
+
+    /**
+     * Gets the pairing base normal angle cutoff.
+     * @return the normal angle cutoff (radians).
+     */
+    static float getPairingNormalCutoff () { return pairing_normal_cutoff; }
+
+    /**
+     * Sets whether the pairing prefilter requires a donor of either
+     * residue within the reach of an acceptor of the other (default true).
+     * This stage never changes the annotations.  Changing it while
+     * annotate (nthreads) runs is undefined.
+     * @param test whether the donors are tested.
+     */
+    static void setPairingDonorTest (bool test) { pairing_donor_test = test; }
+
+    /**
+     * Gets whether the pairing prefilter tests the donors and acceptors.
+     * @return whether the donors are tested.
+     */
+    static bool getPairingDonorTest () { return pairing_donor_test; }
+
+    /**
+     * Sets whether the pairing H-bond flows are solved on the stack by
+     * SmallMaximumFlow, a network too large falling back to
+     * MaximumFlowGraph (default true).  Both give the same flows.
+     * Changing it while annotate (nthreads) runs is undefined.
+     * @param small whether SmallMaximumFlow is used.
+     */
+    static void setPairingSmallFlow (bool small) { pairing_small_flow = small; }
+
+    /**
+     * Gets whether the pairing H-bond flows are solved by SmallMaximumFlow.
+     * @return whether SmallMaximumFlow is used.
+     */
+    static bool getPairingSmallFlow () { return pairing_small_flow; }
+
+    /**
+     * Gets the number of residue pairs tested for pairing since the last
+     * reset.  The statistics are not synchronized between threads: the
+     * threads count into their own AnnotationStats, added afterwards.
+     * @return the tested pair count.
+     */
+    static unsigned long getPairingTested () { return pairing_tested; }
+
+    /**
+     * Gets the number of pairs rejected by the residue bounds.
+     * @return the rejected pair count.
+     */
+    static unsigned long getPairingBoundsRejects () { return pairing_bounds_rejects; }
+
+    /**
+     * Gets the number of pairs rejected by the H-bond atom spheres.
+     * @return the rejected pair count.
+     */
+    static unsigned long getPairingSphereRejects () { return pairing_sphere_rejects; }
+
+    /**
+     * Gets the number of pairs rejected by the base normal angle.
+     * @return the rejected pair count.
+     */
+    static unsigned long getPairingNormalRejects () { return pairing_normal_rejects; }
+
+    /**
+     * Gets the number of pairs rejected for lack of a close donor and
+     * acceptor.
+     * @return the rejected pair count.
+     */
+    static unsigned long getPairingDonorRejects () { return pairing_donor_rejects; }
+
+    /**
+     * Gets the number of H-bonds evaluated for pairing.
+     * @return the evaluated H-bond count.
+     */
+    static unsigned long getPairingHBonds () { return pairing_hbonds; }
+
+    /**
+     * Gets the number of H-bond maximum flow networks solved for pairing.
+     * @return the solved network count.
+     */
+    static unsigned long getPairingFlows () { return pairing_flows; }
+
+    /**
+     * Resets the pairing prefilter and evaluation statistics.
+     */
+    static void resetPairingStats ()
+    {
+      pairing_tested = pairing_bounds_rejects = pairing_sphere_rejects
+	= pairing_normal_rejects = pairing_donor_rejects
+	= pairing_hbonds = pairing_flows = 0;
+    }
+
+    /**
+     * Adds the pairing counts of annotation statistics to the shared
+     * pairing statistics.
+     * @param stats the statistics to add.
+     */
+    static void addPairingStats (const AnnotationStats &stats);
+
     /**
      * Resets the relation's annotation data and set it up from two new residues.
      * @param rA The new origin.
@@ -399,6 +568,16 @@ namespace mccore
      * @return true if there is indeed a relation between the bases.
      */
     bool annotate (unsigned char aspb = adjacent_mask|pairing_mask|stacking_mask|bhbond_mask);
+
+    /**
+     * Describes the interaction, counting the pairing tests in statistics
+     * instead of the shared ones.  Relations annotated in several threads
+     * each count into their thread's statistics.
+     * @param asbp Bit mask controlling annotation tasks.
+     * @param stats the statistics counting the pairing tests.
+     * @return true if there is indeed a relation between the bases.
+     */
+    bool annotate (unsigned char aspb, AnnotationStats &stats);
     
     /**
      * Tests for adjacency relation.
@@ -415,6 +594,13 @@ namespace mccore
      */
     void arePaired ();
 
+    /**
+     * Test for pairing relation, counting the test in statistics instead
+     * of the shared ones.
+     * @param stats the statistics counting the test.
+     */
+    void arePaired (AnnotationStats &stats);
+
     /**
      * Tests for stacking relation.
      */
@@ -427,6 +613,36 @@ namespace mccore
      */
     void addPairingLabels ();
 
+    /**
+     * @internal
+     * Runs the pairing prefilter stages after the bounds test, counting
+     * the rejections.
+     * @param stats the statistics counting the rejections.
+     * @return false if the residues cannot pair.
+     */
+    bool _pairing_prefilter (AnnotationStats &stats) const;
+
+    /**
+     * @internal
+     * Solves the flows of the pairing H-bond candidates with
+     * SmallMaximumFlow, adding the H-bond flows and their sum.
+     * @param candidates the evaluated H-bonds.
+     * @param ends the hydrogen and lone pair of each candidate.
+     * @param nodes the number of network vertices, set.
+     * @return false if the network does not fit, nothing is added then.
+     */
+    bool _small_pairing_flows (const vector< HBond > &candidates, const vector< pair< const Atom*, const Atom* > > &ends, unsigned int &nodes);
+
+    /**
+     * @internal
+     * Solves the flows of the pairing H-bond candidates with
+     * MaximumFlowGraph, adding the H-bond flows and their sum.
+     * @param candidates the evaluated H-bonds.
+     * @param ends the hydrogen and lone pair of each candidate.
+     * @param nodes the number of network vertices, set.
+     */
+    void _graph_pairing_flows (const vector< HBond > &candidates, const vector< pair< const Atom*, const Atom* > > &ends, unsigned int &nodes);
+
   public:
 
     /**
@@ -490,44 +706,6 @@ namespace mccore
 
   protected:
     
-    /**
-     * Calculates the pyrimidine ring's geometrical center from a nucleic acid residue.
-     * @param res The residue.
-     * @return The ring center.
-     * @exception NoSuchAtomException
-     */
-    static Vector3D _pyrimidine_ring_center (const Residue& res);
-
-    /**
-     * Calculates the imidazole ring's geometrical center from a nucleic acid residue.
-     * @param res The residue.
-     * @return The ring center.
-     * @exception NoSuchAtomException
-     */
-    static Vector3D _imidazole_ring_center (const Residue& res);
-
-    /**
-     * Calculates the pyrimidine ring's normal vector from a nucleic acid residue using
-     * the Cremer and Pople method.
-     * Cremer D., Pople J.A., J. Am. Chem. Soc. 1975, 97, 1354-1358
-     * @param res The residue.
-     * @param center The ring center.
-     * @return The normal vector (normalized).
-     * @exception NoSuchAtomException
-     */
-    static Vector3D _pyrimidine_ring_normal (const Residue& res, const Vector3D& center);
-
-    /**
-     * Calculates the imidazole ring's normal vector from a nucleic acid residue using
-     * the Cremer and Pople method.
-     * Cremer D., Pople J.A., J. Am. Chem. Soc. 1975, 97, 1354-1358
-     * @param res The residue.
-     * @param center The ring center.
-     * @return The normal vector (normalized).
-     * @exception NoSuchAtomException
-     */
-    static Vector3D _imidazole_ring_normal (const Residue& res, const Vector3D& center);
-
     /**
      * Check if two nitrogen base rings are stacking on each other. Three criteria are to be
      * satisfied: the rings' center distance, the rings' plane tilt angle and horizontal overlapping. 
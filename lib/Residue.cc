@@ -28,7 +28,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <set>
+#include <typeinfo>
 
 #include "Binstream.h"
 #include "Pdbstream.h"
@@ -40,6 +42,7 @@
 #include "ResidueFactoryMethod.h"
 #include "Rmsd.h"
 #include "Messagestream.h"
+#include "Parallel.h"
 
 #define RAD_36  0.6283185
 #define RAD_72  1.2566371
@@ -96,14 +99,57 @@ namespace mccore
   float Residue::s_rib_mindrop   = 0.00001;
   float Residue::s_rib_shiftrate = 0.5;
 
+  unsigned long Residue::ref_cache_hits   = 0;
+  unsigned long Residue::ref_cache_misses = 0;
+
+  unsigned long Residue::hbond_cache_hits   = 0;
+  unsigned long Residue::hbond_cache_misses = 0;
+
+
+  /**
+   * @internal
+   * Counts a cache request in the shared statistics, except in the chunks
+   * of a parallel task where the increment would race.
+   */
+  static inline void
+  _count_cache_request (unsigned long &counter)
+  {
+    if (! Parallel::inTask ())
+      ++counter;
+  }
+
+
+  /**
+   * @internal
+   * Widening of the cached bounds against rounding, so that the rejection
+   * tests never miss an atom pair at the cutoff (Angstroms).
+   */
+  static const float BOUNDS_SLACK = 1e-3f;
+
+  /**
+   * @internal
+   * Largest distance between a heavy atom and its hydrogens or lone pairs
+   * (Angstroms), as used by the relation annotation.
+   */
+  static const float HBOND_COUPLE_DIST = 1.7;
+
   // LIFECYCLE ---------------------------------------------------------------
 
   Residue::Residue ()
-    : rib_C1p (0), rib_C2p (0), rib_C3p (0), rib_C4p (0), rib_C5p (0), rib_O2p (0),
+    : store (new AtomStore ()),
+      rib_C1p (0), rib_C2p (0), rib_C3p (0), rib_C4p (0), rib_C5p (0), rib_O2p (0),
       rib_O3p (0), rib_O4p (0), rib_O5p (0), rib_O1P (0), rib_O2P (0), rib_P (0),
       rib_dirty_ref (true),
       rib_built_valid (false),
-      rib_built_count (0)
+      rib_built_count (0),
+      ref_cache_valid (false),
+      ref_inv_cache_valid (false),
+      bounds_radius (0),
+      bounds_valid (false),
+      hbond_radius (0),
+      hbond_cache_valid (false),
+      pyr_cache_valid (false),
+      imid_cache_valid (false)
   {
     this->setType (0);
   }
@@ -111,11 +157,20 @@ namespace mccore
 
   Residue::Residue (const ResidueType *t, const ResId &i)
     : resId (i),
+      store (new AtomStore ()),
       rib_C1p (0), rib_C2p (0), rib_C3p (0), rib_C4p (0), rib_C5p (0), rib_O2p (0),
       rib_O3p (0), rib_O4p (0), rib_O5p (0), rib_O1P (0), rib_O2P (0), rib_P (0),
       rib_dirty_ref (true),
       rib_built_valid (false),
-      rib_built_count (0)
+      rib_built_count (0),
+      ref_cache_valid (false),
+      ref_inv_cache_valid (false),
+      bounds_radius (0),
+      bounds_valid (false),
+      hbond_radius (0),
+      hbond_cache_valid (false),
+      pyr_cache_valid (false),
+      imid_cache_valid (false)
   {
     this->setType (t);
   }
@@ -123,11 +178,20 @@ namespace mccore
 
   Residue::Residue (const ResidueType *t, const ResId &i, const vector< Atom > &vec)
     : resId (i),
+      store (new AtomStore ()),
       rib_C1p (0), rib_C2p (0), rib_C3p (0), rib_C4p (0), rib_C5p (0), rib_O2p (0),
       rib_O3p (0), rib_O4p (0), rib_O5p (0), rib_O1P (0), rib_O2P (0), rib_P (0),
       rib_dirty_ref (true),
       rib_built_valid (false),
-      rib_built_count (0)
+      rib_built_count (0),
+      ref_cache_valid (false),
+      ref_inv_cache_valid (false),
+      bounds_radius (0),
+      bounds_valid (false),
+      hbond_radius (0),
+      hbond_cache_valid (false),
+      pyr_cache_valid (false),
+      imid_cache_valid (false)
   {
     vector< Atom >::const_iterator it;
 
@@ -141,30 +205,56 @@ namespace mccore
   Residue::Residue (const Residue& res)
     : type (res.type),
       resId (res.resId),
-      atomIndex (res.atomIndex),
+      store (0),
       rib_C1p (0), rib_C2p (0), rib_C3p (0), rib_C4p (0), rib_C5p (0), rib_O2p (0),
       rib_O3p (0), rib_O4p (0), rib_O5p (0), rib_O1P (0), rib_O2P (0), rib_P (0),
       rib_dirty_ref (true),
       rib_built_valid (res.rib_built_valid),
-      rib_built_count (res.rib_built_count)
+      rib_built_count (res.rib_built_count),
+      ref_cache_valid (false),
+      ref_inv_cache_valid (false),
+      bounds_radius (0),
+      bounds_valid (false),
+      hbond_radius (0),
+      hbond_cache_valid (false),
+      pyr_cache_valid (false),
+      imid_cache_valid (false)
   {
-    vector< Atom* >::iterator cit;
+    this->_share (res);
+  }
+
+
+  Residue::~Residue ()
+  {
+    this->_release ();
+  }
 
-    res.place (); // places globals if "res" is an ExtendedResidue
-    this->atomGlobal = res.atomGlobal;
+
+  Residue::AtomStore::AtomStore (const AtomStore &right)
+    : atomGlobal (right.atomGlobal),
+      atomLocal (right.atomLocal),
+      atomIndex (right.atomIndex),
+      refs (1),
+      shareable (true)
+  {
+    vector< Atom* >::iterator it;
 
     // harden atoms
-    for (cit = this->atomGlobal.begin (); cit != this->atomGlobal.end (); ++cit)
-      *cit = (*cit)->clone ();
+    for (it = this->atomGlobal.begin (); it != this->atomGlobal.end (); ++it)
+      *it = (*it)->clone ();
+    for (it = this->atomLocal.begin (); it != this->atomLocal.end (); ++it)
+      *it = (*it)->clone ();
   }
 
 
-  Residue::~Residue ()
+  Residue::AtomStore::~AtomStore ()
   {
     vector< Atom* >::iterator it;
 
     for (it = this->atomGlobal.begin (); it != this->atomGlobal.end (); ++it)
       delete *it;
+    for (it = this->atomLocal.begin (); it != this->atomLocal.end (); ++it)
+      delete *it;
   }
 
   // VIRTUAL ASSIGNATION --------------------------------------------------
@@ -179,21 +269,81 @@ namespace mccore
 
 
   void
-  Residue::_assign (const Residue& res)
+  Residue::swap (Residue &res)
   {
-    vector< Atom* >::iterator it;
-    vector< Atom* >::const_iterator cit;
+    if (this == &res)
+      return;
+
+    if (typeid (*this) == typeid (res))
+      this->_swap (res);
+    else
+    {
+      // -- polymorphic types differ: exchange through copies, atoms are shared
+      Residue *tmp = this->clone ();
+
+      this->assign (res);
+      res.assign (*tmp);
+      delete tmp;
+    }
+  }
+
+
+  void
+  Residue::_swap (Residue &res)
+  {
+    std::swap (this->type, res.type);
+    std::swap (this->resId, res.resId);
+    std::swap (this->store, res.store);
+    std::swap (this->rib_C1p, res.rib_C1p);
+    std::swap (this->rib_C2p, res.rib_C2p);
+    std::swap (this->rib_C3p, res.rib_C3p);
+    std::swap (this->rib_C4p, res.rib_C4p);
+    std::swap (this->rib_C5p, res.rib_C5p);
+    std::swap (this->rib_O2p, res.rib_O2p);
+    std::swap (this->rib_O3p, res.rib_O3p);
+    std::swap (this->rib_O4p, res.rib_O4p);
+    std::swap (this->rib_O5p, res.rib_O5p);
+    std::swap (this->rib_O1P, res.rib_O1P);
+    std::swap (this->rib_O2P, res.rib_O2P);
+    std::swap (this->rib_P, res.rib_P);
+    std::swap (this->rib_dirty_ref, res.rib_dirty_ref);
+    std::swap (this->rib_built_valid, res.rib_built_valid);
+    std::swap (this->rib_built_count, res.rib_built_count);
+    std::swap (this->ref_cache, res.ref_cache);
+    std::swap (this->ref_inv_cache, res.ref_inv_cache);
+    std::swap (this->ref_cache_valid, res.ref_cache_valid);
+    std::swap (this->ref_inv_cache_valid, res.ref_inv_cache_valid);
+    std::swap (this->bounds_lower, res.bounds_lower);
+    std::swap (this->bounds_upper, res.bounds_upper);
+    std::swap (this->bounds_center, res.bounds_center);
+    std::swap (this->bounds_radius, res.bounds_radius);
+    std::swap (this->bounds_valid, res.bounds_valid);
+    std::swap (this->hbond_couples, res.hbond_couples);
+    std::swap (this->hbond_bh_atoms, res.hbond_bh_atoms);
+    std::swap (this->hbond_center, res.hbond_center);
+    std::swap (this->hbond_radius, res.hbond_radius);
+    std::swap (this->hbond_cache_valid, res.hbond_cache_valid);
+    std::swap (this->pyr_center, res.pyr_center);
+    std::swap (this->pyr_normal, res.pyr_normal);
+    std::swap (this->imid_center, res.imid_center);
+    std::swap (this->imid_normal, res.imid_normal);
+    std::swap (this->pyr_cache_valid, res.pyr_cache_valid);
+    std::swap (this->imid_cache_valid, res.imid_cache_valid);
+  }
+
 
+  void
+  Residue::_assign (const Residue& res)
+  {
     this->type = res.type;
     this->resId = res.resId;
-    this->atomIndex = res.atomIndex;
 
-    // -- deep copy for atomGlobal
-    for (it = this->atomGlobal.begin (); it != this->atomGlobal.end (); ++it)
-      delete *it;
-    this->atomGlobal = res.atomGlobal;
-    for (it = this->atomGlobal.begin (); it != this->atomGlobal.end (); ++it)
-      *it = (*it)->clone ();
+    // -- atoms are shared until either residue is modified
+    if (this->store != res.store)
+    {
+      this->_release ();
+      this->_share (res);
+    }
 
     // -- ribose pointers are reset, but building validity is kept from
     //    copied object.
@@ -204,6 +354,8 @@ namespace mccore
     this->rib_dirty_ref = true;
     this->rib_built_valid = res.rib_built_valid;
     this->rib_built_count = res.rib_built_count;
+    this->_invalidate_referential ();
+    this->_invalidate_geometry ();
   }
 
   // OPERATORS ------------------------------------------------------------
@@ -249,19 +401,28 @@ namespace mccore
   Residue::setType (const ResidueType* t)
   {
     type = t == 0 ? ResidueType::rNull : t;
+    this->_invalidate_referential ();
+    this->_invalidate_geometry ();
   }
 
   Residue::iterator
   Residue::begin ()
   {
-    iterator it (this, atomIndex.begin ());
+    // atoms may be modified through the iterator
+    this->_unshare ();
+    this->_invalidate_referential ();
+
+    iterator it (this, store->atomIndex.begin ());
     return it;
   }
 
   Residue::iterator
   Residue::begin (const AtomSet& atomset)
   {
-    iterator it (this, atomIndex.begin (), atomset);
+    this->_unshare ();
+    this->_invalidate_referential ();
+
+    iterator it (this, store->atomIndex.begin (), atomset);
     return it;
   }
 
@@ -269,7 +430,7 @@ namespace mccore
   Residue::iterator
   Residue::end ()
   {
-    iterator it (this, atomIndex.end ());
+    iterator it (this, store->atomIndex.end ());
     return it;
   }
 
@@ -277,7 +438,7 @@ namespace mccore
   Residue::const_iterator
   Residue::begin () const
   {
-    const_iterator it (this, atomIndex.begin ());
+    const_iterator it (this, store->atomIndex.begin ());
     return it;
   }
 
@@ -285,7 +446,7 @@ namespace mccore
   Residue::const_iterator
   Residue::begin (const AtomSet& atomset) const
   {
-    const_iterator it (this, atomIndex.begin (), atomset);
+    const_iterator it (this, store->atomIndex.begin (), atomset);
     return it;
   }
 
@@ -293,7 +454,7 @@ namespace mccore
   Residue::const_iterator
   Residue::end () const
   {
-    const_iterator it (this, atomIndex.end ());
+    const_iterator it (this, store->atomIndex.end ());
     return it;
   }
 
@@ -301,9 +462,14 @@ namespace mccore
   Residue::iterator
   Residue::find (const AtomType *k)
   {
-    AtomMap::iterator it = atomIndex.find (k);
+    this->_unshare ();
 
-    if (it == atomIndex.end ())
+    AtomMap::iterator it = store->atomIndex.find (k);
+
+    if (this->_is_referential_atom (k))
+      this->_invalidate_referential ();
+
+    if (it == store->atomIndex.end ())
       return end ();
     else
     {
@@ -316,9 +482,9 @@ namespace mccore
   Residue::const_iterator
   Residue::find (const AtomType *k) const
   {
-    AtomMap::const_iterator cit = atomIndex.find (k);
+    AtomMap::const_iterator cit = store->atomIndex.find (k);
 
-    if (cit == atomIndex.end ())
+    if (cit == store->atomIndex.end ())
       return end ();
     else
     {
@@ -331,9 +497,14 @@ namespace mccore
   Residue::iterator
   Residue::safeFind (const AtomType *k)
   {
-    AtomMap::iterator mit = atomIndex.find (k);
+    this->_unshare ();
+
+    AtomMap::iterator mit = store->atomIndex.find (k);
 
-    if (mit == atomIndex.end ())
+    if (this->_is_referential_atom (k))
+      this->_invalidate_referential ();
+
+    if (mit == store->atomIndex.end ())
     {
       NoSuchAtomException ex ("", __FILE__, __LINE__);
       ex << "residue " << *this << " is missing atom " << k;
@@ -348,9 +519,9 @@ namespace mccore
   Residue::const_iterator
   Residue::safeFind (const AtomType *k) const
   {
-    AtomMap::const_iterator cit = atomIndex.find (k);
+    AtomMap::const_iterator cit = store->atomIndex.find (k);
 
-    if (cit == atomIndex.end ())
+    if (cit == store->atomIndex.end ())
     {
       NoSuchAtomException ex ("", __FILE__, __LINE__);
       ex << "residue " << *this << " is missing atom " << k;
@@ -390,21 +561,180 @@ namespace mccore
     // needed to patch numerical instability
     //this->_set_pseudos ();
 
-    return this->_compute_referential ();
+    if (this->ref_cache_valid)
+      _count_cache_request (ref_cache_hits);
+    else
+    {
+      _count_cache_request (ref_cache_misses);
+      this->ref_cache = this->_compute_referential ();
+      this->ref_cache_valid = true;
+    }
+    return this->ref_cache;
+  }
+
+
+  const HomogeneousTransfo&
+  Residue::getReferentialInverse () const
+  {
+    if (this->ref_inv_cache_valid)
+      _count_cache_request (ref_cache_hits);
+    else
+    {
+      _count_cache_request (ref_cache_misses);
+      this->ref_inv_cache = this->getReferential ().invert ();
+      this->ref_inv_cache_valid = true;
+    }
+    return this->ref_inv_cache;
+  }
+
+
+  bool
+  Residue::getBoundingBox (Vector3D &lower, Vector3D &upper) const
+  {
+    this->_compute_bounds ();
+    lower = this->bounds_lower;
+    upper = this->bounds_upper;
+    return this->bounds_lower.getX () <= this->bounds_upper.getX ();
+  }
+
+
+  bool
+  Residue::getBoundingSphere (Vector3D &center, float &radius) const
+  {
+    this->_compute_bounds ();
+    center = this->bounds_center;
+    radius = this->bounds_radius;
+    return this->bounds_lower.getX () <= this->bounds_upper.getX ();
+  }
+
+
+  const vector< pair< const Atom*, const Atom* > >&
+  Residue::getHBondCouples () const
+  {
+    this->_compute_hbond_candidates ();
+    return this->hbond_couples;
+  }
+
+
+  const vector< const Atom* >&
+  Residue::getBHBondAtoms () const
+  {
+    this->_compute_hbond_candidates ();
+    return this->hbond_bh_atoms;
+  }
+
+
+  bool
+  Residue::getHBondSphere (Vector3D &center, float &radius) const
+  {
+    this->_compute_hbond_candidates ();
+    center = this->hbond_center;
+    radius = this->hbond_radius;
+    return ! this->hbond_couples.empty ();
+  }
+
+
+  const Vector3D&
+  Residue::getPyrimidineRingCenter () const
+  {
+    this->_compute_pyrimidine_ring ();
+    return this->pyr_center;
+  }
+
+
+  const Vector3D&
+  Residue::getPyrimidineRingNormal () const
+  {
+    this->_compute_pyrimidine_ring ();
+    return this->pyr_normal;
+  }
+
+
+  const Vector3D&
+  Residue::getImidazoleRingCenter () const
+  {
+    this->_compute_imidazole_ring ();
+    return this->imid_center;
+  }
+
+
+  const Vector3D&
+  Residue::getImidazoleRingNormal () const
+  {
+    this->_compute_imidazole_ring ();
+    return this->imid_normal;
+  }
+
+
+  float
+  Residue::getBoundingDistance (const Residue &res) const
+  {
+    float gap[3];
+    float box;
+    float sphere;
+
+    this->_compute_bounds ();
+    res._compute_bounds ();
+
+    if (this->bounds_lower.getX () > this->bounds_upper.getX ()
+	|| res.bounds_lower.getX () > res.bounds_upper.getX ())
+      return numeric_limits< float >::max ();
+
+    gap[0] = max (max (res.bounds_lower.getX () - this->bounds_upper.getX (),
+		       this->bounds_lower.getX () - res.bounds_upper.getX ()), 0.0f);
+    gap[1] = max (max (res.bounds_lower.getY () - this->bounds_upper.getY (),
+		       this->bounds_lower.getY () - res.bounds_upper.getY ()), 0.0f);
+    gap[2] = max (max (res.bounds_lower.getZ () - this->bounds_upper.getZ (),
+		       this->bounds_lower.getZ () - res.bounds_upper.getZ ()), 0.0f);
+    box = sqrt (gap[0] * gap[0] + gap[1] * gap[1] + gap[2] * gap[2]) - BOUNDS_SLACK;
+    sphere = this->bounds_center.distance (res.bounds_center)
+      - this->bounds_radius - res.bounds_radius;
+
+    return max (max (box, sphere), 0.0f);
+  }
+
+
+  bool
+  Residue::mayBeWithin (const Residue &res, float cutoff) const
+  {
+    float reach;
+
+    this->_compute_bounds ();
+    res._compute_bounds ();
+
+    if (this->bounds_lower.getX () > this->bounds_upper.getX ()
+	|| res.bounds_lower.getX () > res.bounds_upper.getX ())
+      return false;
+
+    // -- spheres first, the boxes reject along the axes only
+    reach = this->bounds_radius + res.bounds_radius + cutoff;
+    if (this->bounds_center.squareDistance (res.bounds_center) > reach * reach)
+      return false;
+
+    cutoff += BOUNDS_SLACK;
+    return (res.bounds_lower.getX () - this->bounds_upper.getX () <= cutoff
+	    && this->bounds_lower.getX () - res.bounds_upper.getX () <= cutoff
+	    && res.bounds_lower.getY () - this->bounds_upper.getY () <= cutoff
+	    && this->bounds_lower.getY () - res.bounds_upper.getY () <= cutoff
+	    && res.bounds_lower.getZ () - this->bounds_upper.getZ () <= cutoff
+	    && this->bounds_lower.getZ () - res.bounds_upper.getZ () <= cutoff);
   }
 
 
   void
   Residue::setReferential (const HomogeneousTransfo& m)
   {
+    this->_detach ();
+
     // needed to patch numerical instability
     this->_set_pseudos ();
 
     vector< Atom* >::iterator it;
     HomogeneousTransfo t  = m * this->_compute_referential ().invert ();
 
-    for (it = this->atomGlobal.begin (); it != this->atomGlobal.end (); ++it)
+    for (it = this->store->atomGlobal.begin (); it != this->store->atomGlobal.end (); ++it)
       (*it)->transform (t);
+    this->_invalidate_referential ();
   }
 
 
@@ -413,34 +743,48 @@ namespace mccore
   {
     vector< Atom* >::iterator it;
 
-    for (it = this->atomGlobal.begin (); it != this->atomGlobal.end (); ++it)
+    this->_detach ();
+
+    for (it = this->store->atomGlobal.begin (); it != this->store->atomGlobal.end (); ++it)
       (*it)->transform (m);
+    this->_invalidate_referential ();
   }
 
 
   void
   Residue::insert (const Atom &atom)
   {
+    this->_detach ();
+
     int pos = size ();
     pair< AtomMap::iterator, bool > inserted =
-      atomIndex.insert (make_pair (atom.getType (), pos));
+      store->atomIndex.insert (make_pair (atom.getType (), pos));
 
     if (inserted.second)
     {
-      atomGlobal.push_back (atom.clone ());
+      store->atomGlobal.push_back (atom.clone ());
       rib_dirty_ref = true;
     }
     else
     {
-      *atomGlobal[inserted.first->second] = atom;
+      *store->atomGlobal[inserted.first->second] = atom;
     }
+
+    if (this->_is_referential_atom (atom.getType ()))
+      this->_invalidate_referential ();
   }
 
 
   Residue::iterator
   Residue::erase (const AtomType *atype)
   {
-    return erase (find (atype));
+    this->_detach ();
+
+    AtomMap::iterator mit = store->atomIndex.find (atype);
+
+    if (store->atomIndex.end () == mit)
+      return end ();
+    return erase (iterator (this, mit));
   }
 
 
@@ -457,6 +801,9 @@ namespace mccore
 
       // -- invalidate ribose pointers
       this->rib_dirty_ref = true;
+      if (this->_is_referential_atom (rit.pos->first))
+	this->_invalidate_referential ();
+      this->_invalidate_geometry ();
 
       // -- get type for the following atom.
       iterator nrit = rit + 1;
@@ -464,19 +811,19 @@ namespace mccore
 	atype = nrit.pos->first;
 
       // -- delete the indexed atom
-      avit = this->atomGlobal.begin () + rit.pos->second;
+      avit = this->store->atomGlobal.begin () + rit.pos->second;
       delete *avit;
-      this->atomGlobal.erase (avit);
+      this->store->atomGlobal.erase (avit);
 
       // -- recreate the atom index
-      this->atomIndex.clear ();
-      for (cavit = this->atomGlobal.begin (); cavit != this->atomGlobal.end (); ++cavit)
-	this->atomIndex.insert (make_pair ((*cavit)->getType (), index++));
+      this->store->atomIndex.clear ();
+      for (cavit = this->store->atomGlobal.begin (); cavit != this->store->atomGlobal.end (); ++cavit)
+	this->store->atomIndex.insert (make_pair ((*cavit)->getType (), index++));
 
       if (atype)
       {
 	// -- retrieve the appropriate iterator following the deletion point.
-	if (this->atomIndex.end () == (next_position = this->atomIndex.find (atype)))
+	if (this->store->atomIndex.end () == (next_position = this->store->atomIndex.find (atype)))
 	{
 	  FatalIntLibException ex ("", __FILE__, __LINE__);
 	  ex << "failed to erase atom " << rit.pos->first << " from " << *this;
@@ -493,31 +840,28 @@ namespace mccore
   Residue::size_type
   Residue::size () const
   {
-    return atomIndex.size ();
+    return store->atomIndex.size ();
   }
 
 
   bool
   Residue::empty () const
   {
-    return atomIndex.empty ();
+    return store->atomIndex.empty ();
   }
 
 
   void
   Residue::clear ()
   {
-    vector< Atom* >::iterator it;
-
-    for (it = this->atomGlobal.begin (); it != this->atomGlobal.end (); ++it)
-      delete *it;
-
-    this->atomGlobal.clear ();
-    this->atomIndex.clear();
+    this->_release ();
+    this->store = new AtomStore ();
 
     this->rib_C1p = this->rib_C2p = this->rib_C3p = this->rib_C4p = this->rib_C5p = this->rib_O2p = this->rib_O3p = this->rib_O4p = this->rib_O5p = this->rib_O1P = this->rib_O2P = this->rib_P = 0;
     this->rib_dirty_ref = true;
     this->rib_built_valid = false;
+    this->_invalidate_referential ();
+    this->_invalidate_geometry ();
   }
 
 
@@ -741,6 +1085,8 @@ namespace mccore
       - if both O3P and O3' are present -> remove O3P atom
       - if O3P is present but O3' isn't -> rename O3P atom type to O3'
     */
+    this->_detach ();
+
     Atom* O3_P = this->_get (AtomType::aO3P);
     if (0 != O3_P)
     {
@@ -764,7 +1110,7 @@ namespace mccore
     set< const AtomType* >::const_iterator ait;
     AtomMap::iterator i;
 
-    for (i=atomIndex.begin (); i!=atomIndex.end (); ++i)
+    for (i=store->atomIndex.begin (); i!=store->atomIndex.end (); ++i)
       actset.insert (i->first);
 
 //     gOut (7) << "\t\thas\tneed" << endl;
@@ -836,7 +1182,7 @@ namespace mccore
 	  AtomMap::const_iterator i;
 
 	  // Get the actual list of atoms
-	  for (i=atomIndex.begin (); i!=atomIndex.end (); ++i)
+	  for (i=store->atomIndex.begin (); i!=store->atomIndex.end (); ++i)
 	  {
 		  actset.insert (i->first);
 	  }
@@ -858,7 +1204,8 @@ namespace mccore
     iterator i;
     const AtomType* t;
 
-    i = begin ();
+    this->_detach ();
+    i = iterator (this, store->atomIndex.begin ());
     while (i != end ())
     {
       t = i->getType ();
@@ -1717,11 +2064,11 @@ namespace mccore
     else if (this->getType ()->isNucleicAcid ())
     {
       // nucleic acid
-      Residue *tmpRef = this->clone ();
       Residue *tmpRes = r.clone ();
+      const Residue &aligned = *tmpRes;
       float result;
 
-      tmpRes->setReferential (tmpRef->getReferential ());
+      tmpRes->setReferential (this->getReferential ());
 
       // This supposes that the atoms are in the same order in the two
       // residues, which is the case since we iterate on sorted residues
@@ -1730,9 +2077,8 @@ namespace mccore
 		     new AtomSetNot (new AtomSetOr (new AtomSetHydrogen (),
 						    new AtomSetAtom (AtomType::aO2p))));
 
-      result = Rmsd::rmsd (tmpRef->begin (as), tmpRef->end (),
-			   tmpRes->begin (as), tmpRes->end ());
-      delete tmpRef;
+      result = Rmsd::rmsd (this->begin (as), this->end (),
+			   aligned.begin (as), aligned.end ());
       delete tmpRes;
       return result;
     }
@@ -2286,17 +2632,231 @@ namespace mccore
 
   // INTERNAL METHODS ------------------------------------------------------
 
+  void
+  Residue::_detach ()
+  {
+    if (1 < this->store->refs)
+    {
+      --this->store->refs;
+      this->store = new AtomStore (*this->store);
+
+      // -- ribose pointers refer to the shared atoms
+      this->rib_C1p = this->rib_C2p = this->rib_C3p = this->rib_C4p = this->rib_C5p = this->rib_O2p = this->rib_O3p = this->rib_O4p = this->rib_O5p = this->rib_O1P = this->rib_O2P = this->rib_P = 0;
+      this->rib_dirty_ref = true;
+    }
+
+    // -- the atoms are about to move
+    this->_invalidate_geometry ();
+  }
+
+
+  void
+  Residue::_compute_bounds () const
+  {
+    if (this->bounds_valid)
+      return;
+
+    AtomSetNot as_nopse (new AtomSetPSE ());
+    const_iterator it;
+    float lower[3];
+    float upper[3];
+    float r2 = 0;
+
+    lower[0] = lower[1] = lower[2] = numeric_limits< float >::max ();
+    upper[0] = upper[1] = upper[2] = -numeric_limits< float >::max ();
+
+    for (it = this->begin (as_nopse); this->end () != it; ++it)
+    {
+      lower[0] = min (lower[0], it->getX ());
+      lower[1] = min (lower[1], it->getY ());
+      lower[2] = min (lower[2], it->getZ ());
+      upper[0] = max (upper[0], it->getX ());
+      upper[1] = max (upper[1], it->getY ());
+      upper[2] = max (upper[2], it->getZ ());
+    }
+
+    this->bounds_lower = Vector3D (lower[0], lower[1], lower[2]);
+    this->bounds_upper = Vector3D (upper[0], upper[1], upper[2]);
+    this->bounds_center = Vector3D ();
+    this->bounds_radius = 0;
+
+    if (lower[0] <= upper[0])
+    {
+      this->bounds_center = Vector3D ((lower[0] + upper[0]) / 2,
+				      (lower[1] + upper[1]) / 2,
+				      (lower[2] + upper[2]) / 2);
+      for (it = this->begin (as_nopse); this->end () != it; ++it)
+	r2 = max (r2, it->squareDistance (this->bounds_center));
+      this->bounds_radius = sqrt (r2) + BOUNDS_SLACK;
+    }
+    this->bounds_valid = true;
+  }
+
+
+  void
+  Residue::_compute_hbond_candidates () const
+  {
+    if (this->hbond_cache_valid)
+    {
+      _count_cache_request (hbond_cache_hits);
+      return;
+    }
+    _count_cache_request (hbond_cache_misses);
+
+    AtomSetAnd da (new AtomSetSideChain (),
+		   new AtomSetNot (new AtomSetOr (new AtomSetAtom (AtomType::a2H5M),
+						  new AtomSetAtom (AtomType::a3H5M))));
+    AtomSetOr bh (new AtomSetSideChain (),
+		  new AtomSetOr (new AtomSetAtom (AtomType::aO2p),
+				 new AtomSetOr (new AtomSetAtom (AtomType::aO2P),
+						new AtomSetAtom (AtomType::aO1P))));
+    const_iterator i;
+    const_iterator j;
+
+    this->hbond_couples.clear ();
+    this->hbond_bh_atoms.clear ();
+
+    for (i = this->begin (da); this->end () != i; ++i)
+      if (i->getType ()->isCarbon ()
+	  || i->getType ()->isNitrogen ()
+	  || i->getType ()->isOxygen ())
+	for (j = this->begin (da); this->end () != j; ++j)
+	  if ((j->getType ()->isHydrogen () || j->getType ()->isLonePair ())
+	      && i->distance (*j) < HBOND_COUPLE_DIST)
+	    this->hbond_couples.push_back (make_pair (&*i, &*j));
+
+    for (i = this->begin (bh); this->end () != i; ++i)
+      if (i->getType ()->isNitrogen () || i->getType ()->isOxygen ())
+	this->hbond_bh_atoms.push_back (&*i);
+
+    this->hbond_center = Vector3D ();
+    this->hbond_radius = 0;
+    if (! this->hbond_couples.empty ())
+    {
+      vector< pair< const Atom*, const Atom* > >::const_iterator cit;
+      float r2 = 0;
+
+      for (cit = this->hbond_couples.begin (); this->hbond_couples.end () != cit; ++cit)
+	this->hbond_center += *cit->first + *cit->second;
+      this->hbond_center /= 2.0f * this->hbond_couples.size ();
+      for (cit = this->hbond_couples.begin (); this->hbond_couples.end () != cit; ++cit)
+	r2 = max (r2, max (cit->first->squareDistance (this->hbond_center),
+			   cit->second->squareDistance (this->hbond_center)));
+      this->hbond_radius = sqrt (r2) + BOUNDS_SLACK;
+    }
+
+    this->hbond_cache_valid = true;
+  }
+
+
+  void
+  Residue::_compute_pyrimidine_ring () const
+  {
+    if (this->pyr_cache_valid)
+      return;
+
+    const Vector3D &n1 = *this->safeFind (AtomType::aN1);
+    const Vector3D &c2 = *this->safeFind (AtomType::aC2);
+    const Vector3D &n3 = *this->safeFind (AtomType::aN3);
+    const Vector3D &c4 = *this->safeFind (AtomType::aC4);
+    const Vector3D &c5 = *this->safeFind (AtomType::aC5);
+    const Vector3D &c6 = *this->safeFind (AtomType::aC6);
+    Vector3D center = (n1 + c2 + n3 + c4 + c5 + c6) / 6.0;
+
+    Vector3D r1 = (((n1 - center) * 1) +
+		   ((c2 - center) * 0.5) +
+		   ((n3 - center) * -0.5) +
+		   ((c4 - center) * -1) +
+		   ((c5 - center) * -0.5) +
+		   ((c6 - center) * 0.5));
+
+    Vector3D r2 = (((c2 - center) * 0.8660254) +
+		   ((n3 - center) * 0.8660254) +
+		   ((c5 - center) * -0.8660254) +
+		   ((c6 - center) * -0.8660254));
+
+    this->pyr_center = center;
+    if (this->type->isPurine ())
+      this->pyr_normal = -(r1.cross (r2).normalize ());
+    else
+      this->pyr_normal = r1.cross (r2).normalize ();
+    this->pyr_cache_valid = true;
+  }
+
+
+  void
+  Residue::_compute_imidazole_ring () const
+  {
+    if (this->imid_cache_valid)
+      return;
+
+    const Vector3D &c4 = *this->safeFind (AtomType::aC4);
+    const Vector3D &c5 = *this->safeFind (AtomType::aC5);
+    const Vector3D &n7 = *this->safeFind (AtomType::aN7);
+    const Vector3D &c8 = *this->safeFind (AtomType::aC8);
+    const Vector3D &n9 = *this->safeFind (AtomType::aN9);
+    Vector3D center = (c4 + c5 + n7 + c8 + n9) / 5.0;
+
+    Vector3D r1 = (((c4 - center) * 1) +
+		   ((c5 - center) * 0.30901699) +
+		   ((n7 - center) * -0.80901699) +
+		   ((c8 - center) * -0.80901699) +
+		   ((n9 - center) * 0.30901699));
+
+    Vector3D r2 = (((c5 - center) * 0.95105652) +
+		   ((n7 - center) * 0.58778525) +
+		   ((c8 - center) * -0.58778525) +
+		   ((n9 - center) * -0.95105652));
+
+    this->imid_center = center;
+    this->imid_normal = r1.cross (r2).normalize ();
+    this->imid_cache_valid = true;
+  }
+
+
+  void
+  Residue::_unshare ()
+  {
+    this->_detach ();
+    this->store->shareable = false;
+  }
+
+
+  void
+  Residue::_share (const Residue &res)
+  {
+    res.place (); // places globals if "res" is an ExtendedResidue
+
+    if (res.store->shareable)
+    {
+      this->store = res.store;
+      ++this->store->refs;
+    }
+    else
+      this->store = new AtomStore (*res.store);
+  }
+
+
+  void
+  Residue::_release ()
+  {
+    if (0 == --this->store->refs)
+      delete this->store;
+    this->store = 0;
+  }
+
+
   Atom&
   Residue::_get (size_type pos) const
   {
-    return *atomGlobal[pos];
+    return *store->atomGlobal[pos];
   }
 
   Atom*
   Residue::_get (const AtomType* aType) const
   {
-    AtomMap::const_iterator it = atomIndex.find (aType);
-    if (it == atomIndex.end ())
+    AtomMap::const_iterator it = store->atomIndex.find (aType);
+    if (it == store->atomIndex.end ())
       return 0;
     else
       return &_get (it->second);
@@ -2306,8 +2866,8 @@ namespace mccore
   Atom*
   Residue::_safe_get (const AtomType* aType) const
   {
-    AtomMap::const_iterator it = atomIndex.find (aType);
-    if (it == atomIndex.end ())
+    AtomMap::const_iterator it = store->atomIndex.find (aType);
+    if (it == store->atomIndex.end ())
     {
       NoSuchAtomException ex ("", __FILE__, __LINE__);
       ex << "residue " << *this << " is missing atom " << aType;
@@ -2320,19 +2880,23 @@ namespace mccore
   Atom*
   Residue::_get_or_create (const AtomType *aType)
   {
+    this->_detach ();
+
     size_type pos = size ();
     pair< AtomMap::iterator, bool > inserted =
-      atomIndex.insert (make_pair (aType, pos));
+      store->atomIndex.insert (make_pair (aType, pos));
 
     if (inserted.second)
     {
-      atomGlobal.push_back (new Atom (0.0, 0.0, 0.0, aType));
+      store->atomGlobal.push_back (new Atom (0.0, 0.0, 0.0, aType));
       rib_dirty_ref = true;
-      return atomGlobal[pos];
+      if (this->_is_referential_atom (aType))
+	this->_invalidate_referential ();
+      return store->atomGlobal[pos];
     }
     else
     {
-      return atomGlobal[inserted.first->second];
+      return store->atomGlobal[inserted.first->second];
     }
   }
 
@@ -2438,9 +3002,9 @@ namespace mccore
       }
       else if (this->size () >= 3)
       {
-	pivot[0] = (Atom*)this->atomGlobal[0];
-	pivot[1] = (Atom*)this->atomGlobal[1];
-	pivot[2] = (Atom*)this->atomGlobal[2];
+	pivot[0] = (Atom*)this->store->atomGlobal[0];
+	pivot[1] = (Atom*)this->store->atomGlobal[1];
+	pivot[2] = (Atom*)this->store->atomGlobal[2];
 	gOut (4) << "default referential with first three atoms for residue type " << *this << endl;
       }
       else
@@ -2459,6 +3023,33 @@ namespace mccore
   }
 
 
+  bool
+  Residue::_is_referential_atom (const AtomType *aType) const
+  {
+    // must follow the atom selection in _compute_referential
+    if (this->type->isNucleicAcid ())
+      return (AtomType::aPSO == aType
+	      || AtomType::aPSX == aType
+	      || AtomType::aPSY == aType
+	      || AtomType::aPSZ == aType);
+    else if (this->type->isPhosphate ())
+      return (AtomType::aP == aType
+	      || AtomType::aO3p == aType
+	      || AtomType::aO5p == aType);
+    else if (this->type->isRibose ())
+      return (AtomType::aC1p == aType
+	      || AtomType::aC2p == aType
+	      || AtomType::aO4p == aType);
+    else if (this->type->isAminoAcid ())
+      return (AtomType::aCA == aType
+	      || AtomType::aN == aType
+	      || AtomType::aPSAZ == aType);
+
+    // default referential depends on the atom ordering
+    return true;
+  }
+
+
   void
   Residue::_build_ribose_preprocess (const Residue* po4_5p,
 				     const Residue* po4_3p,
@@ -2468,8 +3059,9 @@ namespace mccore
 				     Atom& o3p,
 				     const HomogeneousTransfo& referential)
   {
-    // set reference to ribose's atoms
+    // set reference to ribose's atoms (detaching shared atoms resets them)
 
+    this->_detach ();
     if (this->rib_dirty_ref ||
 	(build5p && 0 == this->rib_O5p) ||
 	(build3p && 0 == this->rib_O3p))
@@ -2975,6 +3567,7 @@ namespace mccore
     // place built ribose's atoms back in referential
     this->_transform_ribose (referential, build5p, build3p);
     this->_add_ribose_hydrogens (true);
+    this->_invalidate_geometry ();
   }
 
   // I/O  --------------------------------------------------------------------
@@ -2984,8 +3577,8 @@ namespace mccore
   {
     os << this->resId << this->type;
     //     AtomMap::const_iterator cit;
-    //     for (cit=atomIndex.begin (); cit!=atomIndex.end (); ++cit) {
-    //       os << endl << *(atomGlobal[cit->second]);
+    //     for (cit=store->atomIndex.begin (); cit!=store->atomIndex.end (); ++cit) {
+    //       os << endl << *(store->atomGlobal[cit->second]);
     //     }
     return os;
   }
@@ -3010,19 +3603,23 @@ namespace mccore
        << "# dirty backbone?: " << this->rib_dirty_ref << endl
        << "# valid backbone?: " << this->rib_built_valid << endl
        << "# backbone count:  " << this->rib_built_count << endl
-       << "# atoms mapping: " << this->atomIndex.size () << " entries" << endl;
+       << "# cached referential?: " << this->ref_cache_valid << endl
+       << "# cached bounds?: " << this->bounds_valid << endl
+       << "# cached H-bond candidates?: " << this->hbond_cache_valid << endl
+       << "# shared atoms: " << this->store->refs << " owners" << endl
+       << "# atoms mapping: " << this->store->atomIndex.size () << " entries" << endl;
 
-    for (mit = this->atomIndex.begin (); mit != atomIndex.end (); ++mit)
+    for (mit = this->store->atomIndex.begin (); mit != store->atomIndex.end (); ++mit)
       os << "\t[" << mit->first << "]\t" << mit->second << endl;
 
-    os << "# global atoms: " << this->atomGlobal.size () << " entries" << endl;
+    os << "# global atoms: " << this->store->atomGlobal.size () << " entries" << endl;
 
-    for (ait = this->atomGlobal.begin (); ait != atomGlobal.end (); ++ait)
+    for (ait = this->store->atomGlobal.begin (); ait != store->atomGlobal.end (); ++ait)
     {
       os << "\t";
       os.width (3);
       os.setf (ios::right);
-      os << (ait - this->atomGlobal.begin ()) << ": " << **ait << endl;
+      os << (ait - this->store->atomGlobal.begin ()) << ": " << **ait << endl;
     }
 
     return os;
@@ -3118,7 +3715,7 @@ namespace mccore
       pos (p),
       filter (new AtomSetAll ())
   {
-    AtomMap::iterator last = res->atomIndex.end ();
+    AtomMap::iterator last = res->store->atomIndex.end ();
     while (pos != last && ! (*filter) (res->_get (pos->second)))
       ++pos;
   }
@@ -3131,7 +3728,7 @@ namespace mccore
       pos (p),
       filter (f.clone ())
   {
-    AtomMap::iterator last = res->atomIndex.end ();
+    AtomMap::iterator last = res->store->atomIndex.end ();
     while (pos != last && ! (*filter) (res->_get (pos->second)))
       ++pos;
   }
@@ -3167,7 +3764,7 @@ namespace mccore
   Residue::ResidueIterator&
   Residue::ResidueIterator::operator+= (difference_type k)
   {
-    AtomMap::iterator last = res->atomIndex.end ();
+    AtomMap::iterator last = res->store->atomIndex.end ();
 
     while (k > 0 && pos != last)
       if (++pos != last && (*filter) (res->_get (pos->second)))
@@ -3179,7 +3776,7 @@ namespace mccore
   Residue::iterator&
   Residue::ResidueIterator::operator++ ()
   {
-    AtomMap::iterator last = res->atomIndex.end ();
+    AtomMap::iterator last = res->store->atomIndex.end ();
 
     while (pos != last)
       if (++pos == last || (*filter) (res->_get (pos->second)))
@@ -3192,7 +3789,7 @@ namespace mccore
   Residue::ResidueIterator::operator++ (int ign)
   {
     ResidueIterator ret = *this;
-    AtomMap::iterator last = res->atomIndex.end ();
+    AtomMap::iterator last = res->store->atomIndex.end ();
 
     while (pos != last)
       if (++pos == last || (*filter) (res->_get (pos->second)))
@@ -3214,7 +3811,7 @@ namespace mccore
       pos (p),
       filter (f.clone ())
   {
-    AtomMap::const_iterator last = res->atomIndex.end ();
+    AtomMap::const_iterator last = res->store->atomIndex.end ();
     while (!(pos == last || (*filter) (res->_get (pos->second))))
       ++pos;
   }
@@ -3226,7 +3823,7 @@ namespace mccore
       pos (p),
       filter (new AtomSetAll ())
   {
-    AtomMap::const_iterator last = res->atomIndex.end ();
+    AtomMap::const_iterator last = res->store->atomIndex.end ();
     while (pos != last && ! (*filter) (res->_get (pos->second)))
       ++pos;
   }
@@ -3280,7 +3877,7 @@ namespace mccore
   Residue::const_iterator&
   Residue::ResidueConstIterator::operator+= (difference_type k)
   {
-    AtomMap::const_iterator last = res->atomIndex.end ();
+    AtomMap::const_iterator last = res->store->atomIndex.end ();
 
     while (k > 0 && pos != last)
       if (++pos != last && (*filter) (res->_get (pos->second)))
@@ -3292,7 +3889,7 @@ namespace mccore
   Residue::const_iterator&
   Residue::ResidueConstIterator::operator++ ()
   {
-    AtomMap::const_iterator last = res->atomIndex.end ();
+    AtomMap::const_iterator last = res->store->atomIndex.end ();
 
     while (pos != last)
       if (++pos == last || (*filter) (res->_get (pos->second)))
@@ -3305,7 +3902,7 @@ namespace mccore
   Residue::ResidueConstIterator::operator++ (int ign)
   {
     ResidueConstIterator ret = *this;
-    AtomMap::const_iterator last = res->atomIndex.end ();
+    AtomMap::const_iterator last = res->store->atomIndex.end ();
 
     while (pos != last)
       if (++pos == last || (*filter) (res->_get (pos->second)))
@@ -107,14 +107,60 @@ namespace mccore
     ResId resId;
 
     /**
-     * The container for atoms expressed in the global referential.
+     * @internal
+     * @short Atom storage shared between copies of a residue.
+     *
+     * Copying a residue only shares its storage and increments the
+     * reference count; the atoms are duplicated by _detach when one of the
+     * copies is about to be modified.  The reference count is not
+     * synchronized, residues sharing a store must not be copied or
+     * destroyed concurrently.
      */
-    mutable vector< Atom* > atomGlobal;
+    struct AtomStore
+    {
+      /**
+       * The container for atoms expressed in the global referential.
+       */
+      vector< Atom* > atomGlobal;
+
+      /**
+       * The container for atoms expressed in the local referential (only
+       * used by ExtendedResidue).
+       */
+      vector< Atom* > atomLocal;
+
+      /**
+       * The associative array between atom types and atom container positions.
+       */
+      AtomMap atomIndex;
+
+      /**
+       * The number of residues using this store.
+       */
+      unsigned int refs;
+
+      /**
+       * Whether the store can be shared.  It is lowered once a mutable
+       * iterator is handed out, since atoms may then be modified behind
+       * the residue's back.
+       */
+      bool shareable;
+
+      AtomStore () : refs (1), shareable (true) { }
+
+      AtomStore (const AtomStore &right);
+
+      ~AtomStore ();
+
+    private:
+
+      AtomStore& operator= (const AtomStore &right);
+    };
 
     /**
-     * The associative array between atom types and atom container positions.
+     * The atom storage, possibly shared with other residues.
      */
-    AtomMap atomIndex;
+    AtomStore *store;
 
     /**
      * Ribose's atom aliases used in the theoretical building method.
@@ -137,6 +183,92 @@ namespace mccore
      */
     unsigned int rib_built_count;
 
+    /**
+     * Cached local referential, as computed by _compute_referential.
+     */
+    mutable HomogeneousTransfo ref_cache;
+
+    /**
+     * Cached inverse of the referential returned by getReferential.
+     */
+    mutable HomogeneousTransfo ref_inv_cache;
+
+    /**
+     * Flag asserting the cached referential's validity.  Any method
+     * modifying an atom used by the referential must lower this flag.
+     */
+    mutable bool ref_cache_valid;
+
+    /**
+     * Flag asserting the cached inverse referential's validity.
+     */
+    mutable bool ref_inv_cache_valid;
+
+    /**
+     * Cached bounding box corners of the atoms, pseudo-atoms excluded.
+     */
+    mutable Vector3D bounds_lower, bounds_upper;
+
+    /**
+     * Cached bounding sphere center (the box center) and radius.
+     */
+    mutable Vector3D bounds_center;
+    mutable float bounds_radius;
+
+    /**
+     * Flag asserting the cached bounds' validity.  Any method modifying
+     * the atoms must lower this flag, which _detach does.
+     */
+    mutable bool bounds_valid;
+
+    /**
+     * Cached hydrogen bond candidates of the side chain: the (heavy atom,
+     * hydrogen or lone pair) couples, see getHBondCouples.
+     */
+    mutable vector< pair< const Atom*, const Atom* > > hbond_couples;
+
+    /**
+     * Cached nitrogens and oxygens of the side chain and of the O2', O1P
+     * and O2P atoms, see getBHBondAtoms.
+     */
+    mutable vector< const Atom* > hbond_bh_atoms;
+
+    /**
+     * Cached sphere enclosing the atoms of the hydrogen bond couples,
+     * centered on their centroid.
+     */
+    mutable Vector3D hbond_center;
+    mutable float hbond_radius;
+
+    /**
+     * Flag asserting the cached hydrogen bond candidates' validity.  It is
+     * lowered with the bounds.
+     */
+    mutable bool hbond_cache_valid;
+
+    /**
+     * Cached centers and normals of the base rings, see
+     * getPyrimidineRingCenter and getImidazoleRingCenter.
+     */
+    mutable Vector3D pyr_center, pyr_normal;
+    mutable Vector3D imid_center, imid_normal;
+
+    /**
+     * Flags asserting the cached rings' validity.  They are lowered with
+     * the bounds.
+     */
+    mutable bool pyr_cache_valid, imid_cache_valid;
+
+    /**
+     * Referential cache statistics, shared by all residues.
+     */
+    static unsigned long ref_cache_hits, ref_cache_misses;
+
+    /**
+     * Hydrogen bond candidates cache statistics, shared by all residues.
+     */
+    static unsigned long hbond_cache_hits, hbond_cache_misses;
+
   public:
 
     /**
@@ -561,6 +693,14 @@ namespace mccore
      */
     virtual Residue& assign (const Residue& res);
 
+    /**
+     * Exchanges this object's content with another's by resolving its
+     * polymorphic type.  When both residues are of the same type, no atom
+     * is copied or allocated.  Iterators on both residues are invalidated.
+     * @param res the other object with which to exchange content.
+     */
+    virtual void swap (Residue &res);
+
   protected:
 
     /**
@@ -570,6 +710,13 @@ namespace mccore
      */
     void _assign (const Residue& res);
 
+    /**
+     * @internal
+     * Exchanges this object's content with another's.
+     * @param res the other object with which to exchange content.
+     */
+    void _swap (Residue &res);
+
   public:
 
     // OPERATORS ------------------------------------------------------------
@@ -728,6 +875,13 @@ namespace mccore
      */
     unsigned int getRiboseBuiltCount () const;
 
+    /**
+     * Tells if the atoms are shared with copies of this residue.  Shared
+     * atoms are duplicated when either residue is modified.
+     * @return whether the atom storage is shared.
+     */
+    bool isShared () const { return 1 < store->refs; }
+
     // METHODS -----------------------------------------------------------------
 
     /**
@@ -737,12 +891,120 @@ namespace mccore
      */
     virtual const HomogeneousTransfo getReferential () const;
 
+    /**
+     * Gets the inverse of the local referential.  The inverse is cached
+     * until the referential changes.
+     * @return the inverted referential.
+     */
+    const HomogeneousTransfo& getReferentialInverse () const;
+
     /**
      * Sets the homogeneous matrix representing the local referential.
      * @param m the new referential.
      */
     virtual void setReferential (const HomogeneousTransfo& m);
 
+    /**
+     * Gets the bounding box of the atoms, pseudo-atoms excluded.  The box
+     * is cached until the atoms are modified.  A residue without atoms has
+     * an empty box, its lower corner above its upper corner.
+     * @param lower the lower corner.
+     * @param upper the upper corner.
+     * @return false if the residue has no atoms.
+     */
+    bool getBoundingBox (Vector3D &lower, Vector3D &upper) const;
+
+    /**
+     * Gets a sphere enclosing the atoms, pseudo-atoms excluded, centered on
+     * the bounding box.  The sphere is cached with the box.
+     * @param center the sphere center.
+     * @param radius the sphere radius.
+     * @return false if the residue has no atoms.
+     */
+    bool getBoundingSphere (Vector3D &center, float &radius) const;
+
+    /**
+     * Gets a lower bound on the distance between the atoms of two
+     * residues, pseudo-atoms excluded, from their cached bounds.
+     * @param res the other residue.
+     * @return the bound, the largest float if a residue has no atoms.
+     */
+    float getBoundingDistance (const Residue &res) const;
+
+    /**
+     * Tells whether two residues may have atoms within a cutoff, from
+     * their cached bounds.  A false answer is exact: no atom pair,
+     * pseudo-atoms excluded, is that close.  Callers use it to skip whole
+     * residue pairs before any atom test.
+     * @param res the other residue.
+     * @param cutoff the distance cutoff.
+     * @return false if the residues are certainly farther than cutoff.
+     */
+    bool mayBeWithin (const Residue &res, float cutoff) const;
+
+    /**
+     * Gets the hydrogen bond donor and acceptor candidates of the side
+     * chain, the 2H5M and 3H5M methyl hydrogens excluded: each hydrogen or
+     * lone pair closer than 1.7 Angstroms to a carbon, nitrogen or oxygen,
+     * as (heavy atom, hydrogen or lone pair) couples in atom order.  The
+     * couples are cached until the atoms are modified.
+     * @return the couples.
+     */
+    const vector< pair< const Atom*, const Atom* > >& getHBondCouples () const;
+
+    /**
+     * Gets the atoms that may form base-backbone hydrogen bonds: the
+     * nitrogens and oxygens of the side chain and the O2', O1P and O2P
+     * atoms, in atom order.  The atoms are cached with the couples of
+     * getHBondCouples.
+     * @return the atoms.
+     */
+    const vector< const Atom* >& getBHBondAtoms () const;
+
+    /**
+     * Gets a sphere enclosing the atoms of the hydrogen bond couples of
+     * getHBondCouples, centered on their centroid.  The sphere is cached
+     * with the couples.
+     * @param center the sphere center.
+     * @param radius the sphere radius.
+     * @return false if the residue has no couples.
+     */
+    bool getHBondSphere (Vector3D &center, float &radius) const;
+
+    /**
+     * Gets the geometrical center of the pyrimidine ring of a nucleic
+     * acid base (N1, C2, N3, C4, C5, C6).  The ring center and normal
+     * are cached until the atoms or the type are modified.
+     * @return the ring center.
+     * @exception NoSuchAtomException if a ring atom is missing.
+     */
+    const Vector3D& getPyrimidineRingCenter () const;
+
+    /**
+     * Gets the normal of the pyrimidine ring of a nucleic acid base by
+     * the Cremer and Pople method, reversed for purines.
+     * Cremer D., Pople J.A., J. Am. Chem. Soc. 1975, 97, 1354-1358
+     * @return the normal vector (normalized).
+     * @exception NoSuchAtomException if a ring atom is missing.
+     */
+    const Vector3D& getPyrimidineRingNormal () const;
+
+    /**
+     * Gets the geometrical center of the imidazole ring of a purine (C4,
+     * C5, N7, C8, N9), cached as the pyrimidine ring.
+     * @return the ring center.
+     * @exception NoSuchAtomException if a ring atom is missing.
+     */
+    const Vector3D& getImidazoleRingCenter () const;
+
+    /**
+     * Gets the normal of the imidazole ring of a purine by the Cremer and
+     * Pople method.
+     * @return the normal vector (normalized).
+     * @exception NoSuchAtomException if a ring atom is missing.
+     */
+    const Vector3D& getImidazoleRingNormal () const;
+
     /**
      * Applies a tfo over each atoms.
      * @param m the transfo to apply.
@@ -755,6 +1017,12 @@ namespace mccore
      */
     virtual void place () const { }
 
+    /**
+     * Tells if the global atoms coordinates are up to date.
+     * @return always true, global atoms are always positionned.
+     */
+    virtual bool isPlaced () const { return true; }
+
     /**
      * Inserts an atom in the residue.  It crushes the existing atom if it
      * exists.
@@ -1170,6 +1438,54 @@ namespace mccore
      */
     static float getMaxChi (const PropertyType* glycosyl) throw (TypeException);
 
+    /**
+     * Gets the number of referential requests served from the residues'
+     * cache since the last reset.  The statistics are shared by all
+     * residues; the requests made in the chunks of a parallel task are not
+     * counted.
+     * @return the number of cache hits.
+     */
+    static unsigned long getReferentialCacheHits () { return ref_cache_hits; }
+
+    /**
+     * Gets the number of referential requests that needed a computation
+     * since the last reset.
+     * @return the number of cache misses.
+     */
+    static unsigned long getReferentialCacheMisses () { return ref_cache_misses; }
+
+    /**
+     * Resets the referential cache statistics.
+     */
+    static void resetReferentialCacheStats ()
+    {
+      ref_cache_hits = ref_cache_misses = 0;
+    }
+
+    /**
+     * Gets the number of hydrogen bond candidate requests served from the
+     * residues' cache since the last reset.  The statistics are shared by
+     * all residues; the requests made in the chunks of a parallel task are
+     * not counted.
+     * @return the number of cache hits.
+     */
+    static unsigned long getHBondCacheHits () { return hbond_cache_hits; }
+
+    /**
+     * Gets the number of hydrogen bond candidate requests that needed a
+     * scan of the atoms since the last reset.
+     * @return the number of cache misses.
+     */
+    static unsigned long getHBondCacheMisses () { return hbond_cache_misses; }
+
+    /**
+     * Resets the hydrogen bond candidates cache statistics.
+     */
+    static void resetHBondCacheStats ()
+    {
+      hbond_cache_hits = hbond_cache_misses = 0;
+    }
+
     // INTERNAL METHODS ------------------------------------------------------
 
   protected:
@@ -1231,6 +1547,91 @@ namespace mccore
      */
     HomogeneousTransfo _compute_referential () const;
 
+    /**
+     * @internal
+     * Makes this residue the only owner of its atom storage, duplicating
+     * the atoms if the storage is shared.  Must be called before any
+     * modification of the atoms.
+     */
+    void _detach ();
+
+    /**
+     * @internal
+     * Detaches the atom storage and keeps it from being shared again.  Used
+     * before handing out mutable iterators over the atoms.
+     */
+    void _unshare ();
+
+    /**
+     * @internal
+     * Shares the atom storage of another residue, or copies it if it
+     * cannot be shared.  The current storage is released.
+     * @param res the residue to share with.
+     */
+    void _share (const Residue &res);
+
+    /**
+     * @internal
+     * Releases the atom storage, deleting it if it is no longer shared.
+     */
+    void _release ();
+
+    /**
+     * @internal
+     * Invalidates the cached referential and its inverse.
+     */
+    void _invalidate_referential () const
+    {
+      ref_cache_valid = ref_inv_cache_valid = false;
+    }
+
+    /**
+     * @internal
+     * Invalidates the caches derived from the atom positions: bounding
+     * box and sphere, hydrogen bond candidates, base rings.
+     */
+    void _invalidate_geometry () const
+    {
+      bounds_valid = hbond_cache_valid = false;
+      pyr_cache_valid = imid_cache_valid = false;
+    }
+
+    /**
+     * @internal
+     * Computes the cached bounding box and sphere if needed.
+     */
+    void _compute_bounds () const;
+
+    /**
+     * @internal
+     * Computes the cached hydrogen bond candidates if needed, counting the
+     * cache hits and misses.
+     */
+    void _compute_hbond_candidates () const;
+
+    /**
+     * @internal
+     * Computes the cached pyrimidine ring if needed.
+     * @exception NoSuchAtomException if a ring atom is missing.
+     */
+    void _compute_pyrimidine_ring () const;
+
+    /**
+     * @internal
+     * Computes the cached imidazole ring if needed.
+     * @exception NoSuchAtomException if a ring atom is missing.
+     */
+    void _compute_imidazole_ring () const;
+
+    /**
+     * @internal
+     * Tells if an atom type is used to compute the residue's referential,
+     * in which case modifying it invalidates the cached referential.
+     * @param aType the atom type.
+     * @return whether the atom type is part of the referential.
+     */
+    bool _is_referential_atom (const AtomType *aType) const;
+
     /**
      * @internal
      * Adds backbone's hydrogens only if they aren't already in the residue.
@@ -0,0 +1,440 @@
+//                              -*- Mode: C++ -*-
+// Sasa.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "AbstractModel.h"
+#include "Atom.h"
+#include "AtomType.h"
+#include "Parallel.h"
+#include "Residue.h"
+#include "Sasa.h"
+
+
+
+namespace mccore
+{
+
+  /**
+   * @internal
+   * Number of neighbours tested together for the occlusion of a point.
+   */
+  static const unsigned int OCCLUSION_BLOCK = 8;
+
+
+  /**
+   * @internal
+   * Atom spheres of a model in a grid of cells: cell c holds the spheres
+   * cellItems[cellStart[c], cellStart[c+1]).
+   */
+  struct SasaGrid
+  {
+    vector< float > x;
+    vector< float > y;
+    vector< float > z;
+    vector< float > radius;
+    vector< unsigned int > cellOf;
+    vector< unsigned int > cellStart;
+    vector< unsigned int > cellItems;
+    float origin[3];
+    float cell;
+    unsigned int dims[3];
+
+    /**
+     * Fills the cells from the spheres.
+     */
+    void build ()
+    {
+      unsigned int n = radius.size ();
+      float limit[3];
+      float maxRadius = 0;
+      unsigned int i;
+      unsigned int k;
+      size_t ncells;
+
+      for (k = 0; k < 3; ++k)
+	{
+	  origin[k] = numeric_limits< float >::max ();
+	  limit[k] = -numeric_limits< float >::max ();
+	}
+      for (i = 0; i < n; ++i)
+	{
+	  float p[3] = { x[i], y[i], z[i] };
+
+	  for (k = 0; k < 3; ++k)
+	    {
+	      origin[k] = min (origin[k], p[k]);
+	      limit[k] = max (limit[k], p[k]);
+	    }
+	  maxRadius = max (maxRadius, radius[i]);
+	}
+
+      // -- overlapping spheres are in the same or adjacent cells
+      cell = max (2 * maxRadius, 1.0f);
+      for (k = 0, ncells = 1; k < 3; ++k)
+	{
+	  dims[k] = (unsigned int) ((limit[k] - origin[k]) / cell) + 1;
+	  ncells *= dims[k];
+	}
+
+      cellOf.resize (n);
+      cellStart.assign (ncells + 1, 0);
+      cellItems.resize (n);
+      for (i = 0; i < n; ++i)
+	{
+	  cellOf[i] = ((unsigned int) ((x[i] - origin[0]) / cell) * dims[1]
+		       + (unsigned int) ((y[i] - origin[1]) / cell)) * dims[2]
+	    + (unsigned int) ((z[i] - origin[2]) / cell);
+	  ++cellStart[cellOf[i] + 1];
+	}
+      for (size_t c = 0; c < ncells; ++c)
+	cellStart[c + 1] += cellStart[c];
+
+      vector< unsigned int > fill (cellStart.begin (), cellStart.end () - 1);
+
+      for (i = 0; i < n; ++i)
+	cellItems[fill[cellOf[i]]++] = i;
+    }
+  };
+
+
+  /**
+   * @internal
+   * Computes the accessible areas of the spheres [first, last).
+   */
+  class SasaTask : public ParallelTask
+  {
+    const SasaGrid &grid;
+    const vector< float > &sphere;
+    vector< float > &area;
+
+  public:
+
+    SasaTask (const SasaGrid &g, const vector< float > &s, vector< float > &a)
+      : grid (g), sphere (s), area (a)
+    { }
+
+    virtual void execute (unsigned int chunk, unsigned int first, unsigned int last)
+    {
+      vector< float > nx;
+      vector< float > ny;
+      vector< float > nz;
+      vector< float > nr2;
+      unsigned int npoints = sphere.size () / 3;
+
+      for (; first < last; ++first)
+	{
+	  float cx = grid.x[first];
+	  float cy = grid.y[first];
+	  float cz = grid.z[first];
+	  float r = grid.radius[first];
+	  unsigned int c = grid.cellOf[first];
+	  unsigned int cz0 = c % grid.dims[2];
+	  unsigned int cy0 = c / grid.dims[2] % grid.dims[1];
+	  unsigned int cx0 = c / grid.dims[2] / grid.dims[1];
+	  unsigned int gx, gy, gz;
+	  unsigned int accessible = 0;
+	  unsigned int occluder = 0;
+	  unsigned int p;
+
+	  // -- neighbours, as coordinates relative to the atom center
+	  nx.clear ();
+	  ny.clear ();
+	  nz.clear ();
+	  nr2.clear ();
+	  for (gx = 0 < cx0 ? cx0 - 1 : 0; gx <= cx0 + 1 && gx < grid.dims[0]; ++gx)
+	    for (gy = 0 < cy0 ? cy0 - 1 : 0; gy <= cy0 + 1 && gy < grid.dims[1]; ++gy)
+	      for (gz = 0 < cz0 ? cz0 - 1 : 0; gz <= cz0 + 1 && gz < grid.dims[2]; ++gz)
+		{
+		  size_t g = ((size_t) gx * grid.dims[1] + gy) * grid.dims[2] + gz;
+		  unsigned int q;
+
+		  for (q = grid.cellStart[g]; q < grid.cellStart[g + 1]; ++q)
+		    {
+		      unsigned int j = grid.cellItems[q];
+		      float dx = grid.x[j] - cx;
+		      float dy = grid.y[j] - cy;
+		      float dz = grid.z[j] - cz;
+		      float reach = r + grid.radius[j];
+
+		      if (j != first && dx * dx + dy * dy + dz * dz < reach * reach)
+			{
+			  nx.push_back (dx);
+			  ny.push_back (dy);
+			  nz.push_back (dz);
+			  nr2.push_back (grid.radius[j] * grid.radius[j]);
+			}
+		    }
+		}
+
+	  for (p = 0; p < npoints; ++p)
+	    {
+	      float px = r * sphere[3 * p];
+	      float py = r * sphere[3 * p + 1];
+	      float pz = r * sphere[3 * p + 2];
+	      unsigned int n = nx.size ();
+	      unsigned int b;
+	      bool covered = false;
+
+	      // -- the neighbour covering the previous point often covers this one
+	      if (occluder < n)
+		{
+		  float dx = nx[occluder] - px;
+		  float dy = ny[occluder] - py;
+		  float dz = nz[occluder] - pz;
+
+		  covered = dx * dx + dy * dy + dz * dz < nr2[occluder];
+		}
+
+	      for (b = 0; ! covered && b < n; b += OCCLUSION_BLOCK)
+		{
+		  unsigned int e = min (b + OCCLUSION_BLOCK, n);
+		  unsigned int hit = 0;
+		  unsigned int j;
+
+		  for (j = b; j < e; ++j)
+		    {
+		      float dx = nx[j] - px;
+		      float dy = ny[j] - py;
+		      float dz = nz[j] - pz;
+
+		      hit |= dx * dx + dy * dy + dz * dz < nr2[j];
+		    }
+		  if (0 != hit)
+		    {
+		      for (j = b; j < e; ++j)
+			{
+			  float dx = nx[j] - px;
+			  float dy = ny[j] - py;
+			  float dz = nz[j] - pz;
+
+			  if (dx * dx + dy * dy + dz * dz < nr2[j])
+			    break;
+			}
+		      occluder = j;
+		      covered = true;
+		    }
+		}
+	      if (! covered)
+		++accessible;
+	    }
+	  area[first] = 4 * (float) M_PI * r * r * accessible / npoints;
+	}
+    }
+  };
+
+
+  /**
+   * @internal
+   * Computes the accessible areas of the models [first, last).
+   */
+  class SasaModelTask : public ParallelTask
+  {
+    const vector< const AbstractModel* > &models;
+    vector< Sasa > &results;
+
+  public:
+
+    SasaModelTask (const vector< const AbstractModel* > &m, vector< Sasa > &r)
+      : models (m), results (r)
+    { }
+
+    virtual void execute (unsigned int chunk, unsigned int first, unsigned int last)
+    {
+      for (; first < last; ++first)
+	results[first].compute (*models[first], 1);
+    }
+  };
+
+  // LIFECYCLE ------------------------------------------------------------
+
+  Sasa::Sasa (float pr, unsigned int points)
+    : probe (pr)
+  {
+    if (0 == points || 0 > probe)
+      {
+	IntLibException ex ("", __FILE__, __LINE__);
+	ex << "invalid probe " << probe << " or point count " << points;
+	throw ex;
+      }
+    _sphere (points);
+  }
+
+
+  Sasa::Sasa (const AbstractModel &model, unsigned int nthreads)
+    : probe (1.4)
+  {
+    _sphere (200);
+    compute (model, nthreads);
+  }
+
+  // ACCESS ---------------------------------------------------------------
+
+  float
+  Sasa::getRadius (const Atom &atom) const
+  {
+    const AtomType *t = atom.getType ();
+    map< const AtomType*, float >::const_iterator it;
+
+    if (radii.end () != (it = radii.find (t)))
+      return it->second;
+    if (t->isPseudo () || t->isLonePair () || t->isHydrogen ())
+      return 0;
+    if (t->isCarbon ())
+      return 1.70;
+    if (t->isNitrogen ())
+      return 1.55;
+    if (t->isOxygen ())
+      return 1.52;
+    return 1.80;
+  }
+
+
+  float
+  Sasa::getArea () const
+  {
+    vector< float >::const_iterator it;
+    float area = 0;
+
+    for (it = atomArea.begin (); atomArea.end () != it; ++it)
+      area += *it;
+    return area;
+  }
+
+
+  float
+  Sasa::getArea (const Residue &res) const
+  {
+    map< const Residue*, unsigned int >::const_iterator it = residueIndex.find (&res);
+    float area = 0;
+    unsigned int i;
+
+    if (residueIndex.end () == it)
+      {
+	NoSuchElementException ex ("", __FILE__, __LINE__);
+	ex << "no area computed for residue " << res.getResId ();
+	throw ex;
+      }
+    for (i = residueStart[it->second]; i < residueStart[it->second + 1]; ++i)
+      area += atomArea[i];
+    return area;
+  }
+
+
+  float
+  Sasa::getArea (const Residue &res, const AtomType *type) const
+  {
+    map< const Residue*, unsigned int >::const_iterator it = residueIndex.find (&res);
+
+    if (residueIndex.end () != it)
+      {
+	unsigned int i;
+
+	for (i = residueStart[it->second]; i < residueStart[it->second + 1]; ++i)
+	  if (type == atomType[i])
+	    return atomArea[i];
+      }
+
+    NoSuchElementException ex ("", __FILE__, __LINE__);
+    ex << "no area computed for atom " << type << " of residue " << res.getResId ();
+    throw ex;
+  }
+
+  // METHODS --------------------------------------------------------------
+
+  void
+  Sasa::compute (const AbstractModel &model, unsigned int nthreads)
+  {
+    AbstractModel::const_iterator rit;
+    SasaGrid grid;
+
+    atomType.clear ();
+    atomArea.clear ();
+    residueStart.clear ();
+    residueIndex.clear ();
+
+    for (rit = model.begin (); model.end () != rit; ++rit)
+      {
+	Residue::const_iterator ait;
+
+	residueIndex.insert (make_pair (&*rit, residueStart.size ()));
+	residueStart.push_back (atomType.size ());
+	for (ait = rit->begin (); rit->end () != ait; ++ait)
+	  {
+	    float radius = getRadius (*ait);
+
+	    if (0 < radius)
+	      {
+		grid.x.push_back (ait->getX ());
+		grid.y.push_back (ait->getY ());
+		grid.z.push_back (ait->getZ ());
+		grid.radius.push_back (radius + probe);
+		atomType.push_back (ait->getType ());
+	      }
+	  }
+      }
+    residueStart.push_back (atomType.size ());
+
+    atomArea.resize (atomType.size (), 0);
+    if (atomType.empty ())
+      return;
+    grid.build ();
+
+    SasaTask task (grid, sphere, atomArea);
+    Parallel::run (task, atomArea.size (), nthreads);
+  }
+
+
+  void
+  Sasa::compute (const vector< const AbstractModel* > &models, vector< Sasa > &results, unsigned int nthreads) const
+  {
+    results.assign (models.size (), *this);
+
+    SasaModelTask task (models, results);
+    Parallel::run (task, models.size (), nthreads);
+  }
+
+
+  void
+  Sasa::_sphere (unsigned int points)
+  {
+    float increment = (float) M_PI * (3 - sqrt (5.0f));
+    unsigned int k;
+
+    sphere.resize (3 * points);
+    for (k = 0; k < points; ++k)
+      {
+	float y = 1 - (2 * k + 1) / (float) points;
+	float r = sqrt (1 - y * y);
+	float phi = k * increment;
+
+	sphere[3 * k] = cos (phi) * r;
+	sphere[3 * k + 1] = y;
+	sphere[3 * k + 2] = sin (phi) * r;
+      }
+  }
+
+}
@@ -0,0 +1,208 @@
+//                              -*- Mode: C++ -*-
+// Sasa.h
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef _mccore_Sasa_h_
+#define _mccore_Sasa_h_
+
+#include <map>
+#include <vector>
+
+#include "Exception.h"
+
+using namespace std;
+
+
+
+namespace mccore
+{
+  class AbstractModel;
+  class Atom;
+  class AtomType;
+  class Residue;
+
+
+
+  /**
+   * @short Solvent accessible surface area of a model.
+   *
+   * The areas are computed by the Shrake-Rupley method: points evenly
+   * spread on the sphere of each atom, its radius enlarged by the probe,
+   * are counted accessible when no neighbouring sphere covers them.  The
+   * neighbours of an atom are found through a grid of cells as large as
+   * the largest sphere diameter.
+   *
+   * Hydrogens, pseudo-atoms and lone pairs are ignored; the other atoms
+   * get united atom radii by element (C 1.70, N 1.55, O 1.52, P and S
+   * 1.80, others 1.80 Angstroms) unless set for an atom type.
+   *
+   * The object keeps the areas of the last computed model, by atom and by
+   * residue.  The residues must outlive the results.
+   */
+  class Sasa
+  {
+    /**
+     * The probe radius.
+     */
+    float probe;
+
+    /**
+     * Unit vectors of the sphere points.
+     */
+    vector< float > sphere;
+
+    /**
+     * Radii set by atom type.
+     */
+    map< const AtomType*, float > radii;
+
+    /**
+     * Type of each atom.
+     */
+    vector< const AtomType* > atomType;
+
+    /**
+     * Accessible area of each atom.
+     */
+    vector< float > atomArea;
+
+    /**
+     * First atom of each residue, plus a sentinel.
+     */
+    vector< unsigned int > residueStart;
+
+    /**
+     * Positions of the residues.
+     */
+    map< const Residue*, unsigned int > residueIndex;
+
+  public:
+
+    // LIFECYCLE ------------------------------------------------------------
+
+    /**
+     * Initializes the object.
+     * @param probe the probe radius (default = 1.4 Angstroms).
+     * @param points the number of points on each sphere (default = 200).
+     * @exception IntLibException if there is no point or the probe is
+     * negative.
+     */
+    Sasa (float probe = 1.4, unsigned int points = 200);
+
+    /**
+     * Initializes the object with the areas of a model.
+     * @param model the model.
+     * @param nthreads the number of threads (0 for one per processor).
+     */
+    Sasa (const AbstractModel &model, unsigned int nthreads = 1);
+
+    /**
+     * Destroys the object.
+     */
+    ~Sasa () { }
+
+    // ACCESS ---------------------------------------------------------------
+
+    /**
+     * Gets the probe radius.
+     * @return the probe radius.
+     */
+    float getProbe () const { return probe; }
+
+    /**
+     * Gets the number of points on each sphere.
+     * @return the point count.
+     */
+    unsigned int getPointCount () const { return sphere.size () / 3; }
+
+    /**
+     * Sets the radius of an atom type for the next computations.
+     * @param type the atom type.
+     * @param radius the radius, 0 to ignore the atoms of this type.
+     */
+    void setRadius (const AtomType *type, float radius) { radii[type] = radius; }
+
+    /**
+     * Gets the radius used for an atom.
+     * @param atom the atom.
+     * @return the radius, 0 when the atom is ignored.
+     */
+    float getRadius (const Atom &atom) const;
+
+    /**
+     * Gets the total accessible area of the last computed model.
+     * @return the area in square Angstroms.
+     */
+    float getArea () const;
+
+    /**
+     * Gets the accessible area of a residue.
+     * @param res the residue.
+     * @return the area in square Angstroms.
+     * @exception NoSuchElementException if the residue was not computed.
+     */
+    float getArea (const Residue &res) const;
+
+    /**
+     * Gets the accessible area of an atom.
+     * @param res the residue.
+     * @param type the atom type.
+     * @return the area in square Angstroms.
+     * @exception NoSuchElementException if the residue was not computed
+     * or the atom was ignored.
+     */
+    float getArea (const Residue &res, const AtomType *type) const;
+
+    // METHODS --------------------------------------------------------------
+
+    /**
+     * Computes the accessible areas of a model, the atoms being
+     * distributed among threads.
+     * @param model the model.
+     * @param nthreads the number of threads (0 for one per processor).
+     * @exception IntLibException if the computation failed in a thread.
+     */
+    void compute (const AbstractModel &model, unsigned int nthreads = 1);
+
+    /**
+     * Computes the accessible areas of many models, the models being
+     * distributed among threads.  Each result gets the probe, points and
+     * radii of this object.
+     * @param models the models.
+     * @param results the areas of each model, replaced.
+     * @param nthreads the number of threads (0 for one per processor).
+     * @exception IntLibException if the computation failed in a thread.
+     */
+    void compute (const vector< const AbstractModel* > &models, vector< Sasa > &results, unsigned int nthreads = 1) const;
+
+  private:
+
+    /**
+     * @internal
+     * Spreads the sphere points on a golden section spiral.
+     */
+    void _sphere (unsigned int points);
+
+  };
+
+}
+
+#endif
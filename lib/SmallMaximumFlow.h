@@ -0,0 +1,446 @@
+//                              -*- Mode: C++ -*-
+// SmallMaximumFlow.h
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+
+#ifndef _mccore_SmallMaximumFlow_h_
+#define _mccore_SmallMaximumFlow_h_
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+
+
+namespace mccore
+{
+
+  /**
+   * @short Maximum flow of a network of fixed capacity.
+   *
+   * The network holds at most MaxVertices vertices and MaxEdges edges in
+   * arrays, so that it lives on the stack.  It is meant for the tiny
+   * source/sink networks of H-bonds between two residues.  The flows are
+   * computed by the pre-flow push of MaximumFlowGraph, in the same order
+   * and with the same arithmetic, so both give the same flows.
+   *
+   * Vertices are numbered from 0 in their insertion order and edges in
+   * their connection order.  The pushes may outgrow the active queue,
+   * preFlowPush then fails and the network should be solved by
+   * MaximumFlowGraph.
+   */
+  template< unsigned int MaxVertices, unsigned int MaxEdges >
+  class SmallMaximumFlow
+  {
+    /**
+     * The capacity of the active vertex queue.
+     */
+    static const unsigned int queue_size = 4 * (MaxVertices + MaxEdges);
+
+    /**
+     * The number of vertices.
+     */
+    unsigned int nvertices;
+
+    /**
+     * The number of edges.
+     */
+    unsigned int nedges;
+
+    /**
+     * The head and tail vertices of the edges.
+     */
+    unsigned int heads[MaxEdges];
+    unsigned int tails[MaxEdges];
+
+    /**
+     * The capacity and flow of the edges.
+     */
+    float capacities[MaxEdges];
+    float flows[MaxEdges];
+
+    /**
+     * The out-edges of vertex v, sorted on their tails, are
+     * outEdges[outStart[v], outStart[v+1]); the in-edges, sorted on their
+     * heads, are inEdges[inStart[v], inStart[v+1]).
+     */
+    unsigned int outStart[MaxVertices + 1];
+    unsigned int outEdges[MaxEdges];
+    unsigned int inStart[MaxVertices + 1];
+    unsigned int inEdges[MaxEdges];
+
+    /**
+     * The distance labels and excesses of the vertices.
+     */
+    int labels[MaxVertices];
+    float excess[MaxVertices];
+
+    /**
+     * The active vertices, a ring of queue_size.
+     */
+    unsigned int active[queue_size];
+    unsigned int activeFront;
+    unsigned int activeSize;
+
+  public:
+
+    // LIFECYCLE ------------------------------------------------------------
+
+    /**
+     * Initializes an empty network.
+     */
+    SmallMaximumFlow () : nvertices (0), nedges (0) { }
+
+    // ACCESS ---------------------------------------------------------------
+
+    /**
+     * Gets the number of vertices.
+     * @return the vertex count.
+     */
+    unsigned int size () const { return nvertices; }
+
+    /**
+     * Gets the number of edges.
+     * @return the edge count.
+     */
+    unsigned int edgeSize () const { return nedges; }
+
+    /**
+     * Gets the flow of an edge, set by preFlowPush.
+     * @param e the edge number.
+     * @return the flow.
+     */
+    float getFlow (unsigned int e) const { return flows[e]; }
+
+    // METHODS --------------------------------------------------------------
+
+    /**
+     * Adds a vertex, numbered size () - 1.
+     * @return false if the network is full.
+     */
+    bool insert ()
+    {
+      if (MaxVertices == nvertices)
+	return false;
+      ++nvertices;
+      return true;
+    }
+
+    /**
+     * Connects two vertices with an edge, numbered edgeSize () - 1.
+     * @param h the head vertex.
+     * @param t the tail vertex.
+     * @param capacity the edge capacity.
+     * @return false if the network is full, a vertex is missing or the
+     * vertices are already connected.
+     */
+    bool connect (unsigned int h, unsigned int t, float capacity)
+    {
+      unsigned int e;
+
+      if (MaxEdges == nedges || h >= nvertices || t >= nvertices)
+	return false;
+      for (e = 0; e < nedges; ++e)
+	if (heads[e] == h && tails[e] == t)
+	  return false;
+      heads[nedges] = h;
+      tails[nedges] = t;
+      capacities[nedges] = capacity;
+      flows[nedges] = 0;
+      ++nedges;
+      return true;
+    }
+
+    /**
+     * Computes the flows from source to sink by the pre-flow push of
+     * MaximumFlowGraph, which splits the excess of a vertex evenly among
+     * its edges.
+     * @param source the source vertex.
+     * @param sink the sink vertex.
+     * @return false if the active queue overflowed, the flows are then
+     * meaningless.
+     */
+    bool preFlowPush (unsigned int source, unsigned int sink)
+    {
+      unsigned int queue[MaxVertices];
+      unsigned int qfront = 0;
+      unsigned int qback = 0;
+      unsigned int v;
+      unsigned int k;
+
+      if (source >= nvertices || sink >= nvertices)
+	return true;
+      _adjacency ();
+
+      // -- distances from the source, over edges in both directions
+      for (v = 0; v < nvertices; ++v)
+	{
+	  labels[v] = numeric_limits< int >::max ();
+	  excess[v] = 0;
+	}
+      labels[source] = 0;
+      queue[qback++] = source;
+      while (qfront < qback)
+	{
+	  int distance;
+
+	  v = queue[qfront++];
+	  distance = labels[v] + 1;
+	  for (k = outStart[v]; k < outStart[v + 1]; ++k)
+	    _reach (tails[outEdges[k]], distance, queue, qback);
+	  for (k = inStart[v]; k < inStart[v + 1]; ++k)
+	    _reach (heads[inEdges[k]], distance, queue, qback);
+	}
+
+      // -- flood from the source
+      activeFront = activeSize = 0;
+      for (k = outStart[source]; k < outStart[source + 1]; ++k)
+	{
+	  unsigned int e = outEdges[k];
+
+	  flows[e] = capacities[e];
+	  excess[tails[e]] = flows[e];
+	  excess[source] -= excess[tails[e]];
+	  if (! _activate (tails[e]))
+	    return false;
+	}
+
+      while (0 != activeSize)
+	{
+	  if (! _pushRelabel (source, sink))
+	    return false;
+	  if (0 == excess[active[activeFront]])
+	    {
+	      activeFront = (activeFront + 1) % queue_size;
+	      --activeSize;
+	    }
+	}
+      return true;
+    }
+
+  private:
+
+    /**
+     * @internal
+     * Sorts the out-edges and in-edges of each vertex.
+     */
+    void _adjacency ()
+    {
+      unsigned int v;
+      unsigned int e;
+
+      for (v = 0; v <= nvertices; ++v)
+	outStart[v] = inStart[v] = 0;
+      for (e = 0; e < nedges; ++e)
+	{
+	  ++outStart[heads[e] + 1];
+	  ++inStart[tails[e] + 1];
+	}
+      for (v = 0; v < nvertices; ++v)
+	{
+	  outStart[v + 1] += outStart[v];
+	  inStart[v + 1] += inStart[v];
+	}
+      for (v = 0; v < nvertices; ++v)
+	{
+	  _sort (outEdges, outStart[v], outStart[v + 1], heads, tails, v);
+	  _sort (inEdges, inStart[v], inStart[v + 1], tails, heads, v);
+	}
+    }
+
+    /**
+     * @internal
+     * Fills the edges of a vertex in [first, last) of edges, sorted on
+     * their other end.
+     */
+    void _sort (unsigned int *edges, unsigned int first, unsigned int last,
+		const unsigned int *ends, const unsigned int *others, unsigned int v)
+    {
+      unsigned int n = first;
+      unsigned int e;
+
+      for (e = 0; e < nedges; ++e)
+	if (v == ends[e])
+	  {
+	    unsigned int k;
+
+	    for (k = n++; k > first && others[edges[k - 1]] > others[e]; --k)
+	      edges[k] = edges[k - 1];
+	    edges[k] = e;
+	  }
+    }
+
+    /**
+     * @internal
+     * Labels and queues a vertex reached at a distance, if closer.
+     */
+    void _reach (unsigned int v, int distance, unsigned int *queue, unsigned int &qback)
+    {
+      if (labels[v] > distance)
+	{
+	  labels[v] = distance;
+	  queue[qback++] = v;
+	}
+    }
+
+    /**
+     * @internal
+     * Appends a vertex to the active queue.
+     * @return false if the queue is full.
+     */
+    bool _activate (unsigned int v)
+    {
+      if (queue_size == activeSize)
+	return false;
+      active[(activeFront + activeSize) % queue_size] = v;
+      ++activeSize;
+      return true;
+    }
+
+    /**
+     * @internal
+     * Pushes the excess of the front active vertex forward, then back,
+     * and relabels it if some excess is left.
+     * @return false if the active queue overflowed.
+     */
+    bool _pushRelabel (unsigned int source, unsigned int sink)
+    {
+      unsigned int front = active[activeFront];
+      float cap[MaxEdges];
+      unsigned int ncap;
+      unsigned int k;
+      float eq;
+
+      if (0 < excess[front])
+	{
+	  for (k = outStart[front], ncap = 0; k < outStart[front + 1]; ++k)
+	    {
+	      unsigned int e = outEdges[k];
+
+	      if (labels[tails[e]] > labels[front] && flows[e] < capacities[e])
+		cap[ncap++] = capacities[e] - flows[e];
+	    }
+	  eq = _equilibrate (cap, ncap, excess[front]);
+
+	  for (k = outStart[front]; k < outStart[front + 1]; ++k)
+	    {
+	      unsigned int e = outEdges[k];
+	      unsigned int t = tails[e];
+
+	      if (labels[t] > labels[front] && flows[e] < capacities[e])
+		{
+		  float push_delta = min (eq, capacities[e] - flows[e]);
+
+		  flows[e] = flows[e] + push_delta;
+		  excess[front] -= push_delta;
+		  if (fabs (excess[front]) < 1e-5)
+		    excess[front] = 0;
+		  if (t != source && t != sink && ! _activate (t))
+		    return false;
+		  excess[t] += push_delta;
+		}
+	    }
+	}
+
+      if (0 < excess[front])
+	{
+	  for (k = inStart[front], ncap = 0; k < inStart[front + 1]; ++k)
+	    {
+	      unsigned int e = inEdges[k];
+
+	      if (labels[heads[e]] > labels[front] && 0 < flows[e])
+		cap[ncap++] = flows[e];
+	    }
+	  eq = _equilibrate (cap, ncap, excess[front]);
+
+	  for (k = inStart[front]; k < inStart[front + 1]; ++k)
+	    {
+	      unsigned int e = inEdges[k];
+	      unsigned int h = heads[e];
+
+	      if (labels[h] > labels[front] && 0 < flows[e])
+		{
+		  float push_delta = min (eq, flows[e]);
+
+		  flows[e] = flows[e] - push_delta;
+		  excess[front] -= push_delta;
+		  if (fabs (excess[front]) < 1e-5)
+		    excess[front] = 0;
+		  if (h != source && h != sink && ! _activate (h))
+		    return false;
+		  excess[h] += push_delta;
+		}
+	    }
+	}
+
+      if (0 < excess[front])
+	{
+	  int max_dist = -2 * (int) nvertices;
+
+	  for (k = outStart[front]; k < outStart[front + 1]; ++k)
+	    {
+	      unsigned int e = outEdges[k];
+
+	      if (0 < capacities[e] - flows[e] && labels[tails[e]] > max_dist)
+		max_dist = labels[tails[e]];
+	    }
+	  for (k = inStart[front]; k < inStart[front + 1]; ++k)
+	    {
+	      unsigned int e = inEdges[k];
+
+	      if (0 < flows[e] && labels[heads[e]] > max_dist)
+		max_dist = labels[heads[e]];
+	    }
+	  labels[front] = max_dist - 1;
+	}
+      return true;
+    }
+
+    /**
+     * @internal
+     * Splits an excess evenly among capacities, the capacities too small
+     * for their share being filled.
+     * @return the share of the other capacities, 1 if all are filled.
+     */
+    static float _equilibrate (float *capacities, unsigned int n, float excess)
+    {
+      unsigned int i;
+
+      sort (capacities, capacities + n);
+      for (i = 0; i < n; ++i)
+	{
+	  if (capacities[i] < (excess / (n - i)))
+	    excess -= capacities[i];
+	  else
+	    break;
+	}
+      if (i == n)
+	return 1;
+      return excess / (n - i);
+    }
+
+  };
+
+}
+
+#endif
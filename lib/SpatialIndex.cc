@@ -0,0 +1,539 @@
+//                              -*- Mode: C++ -*-
+// SpatialIndex.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <set>
+
+#include "AbstractModel.h"
+#include "Atom.h"
+#include "AtomType.h"
+#include "Residue.h"
+#include "SpatialIndex.h"
+#include "Vector3D.h"
+
+
+
+namespace mccore
+{
+
+  /**
+   * @internal
+   * Orders atom numbers along a coordinate axis.
+   */
+  class SpatialIndexAxisLess
+  {
+    const vector< float > &coords;
+    unsigned int axis;
+
+  public:
+
+    SpatialIndexAxisLess (const vector< float > &c, unsigned int a)
+      : coords (c), axis (a)
+    { }
+
+    bool operator() (unsigned int a, unsigned int b) const
+    {
+      return coords[3 * a + axis] < coords[3 * b + axis];
+    }
+  };
+
+
+  /**
+   * @internal
+   * Tells whether an atom is indexed.
+   */
+  static bool
+  _is_indexed (const Atom &atom)
+  {
+    return ! atom.getType ()->isPseudo () && ! atom.getType ()->isLonePair ();
+  }
+
+
+  /**
+   * @internal
+   * Squared distance between a point and a box.
+   */
+  static float
+  _box_distance2 (const float *lower, const float *upper, const float *p)
+  {
+    float d2 = 0;
+    unsigned int k;
+
+    for (k = 0; k < 3; ++k)
+      {
+	float d = 0;
+
+	if (p[k] < lower[k])
+	  d = lower[k] - p[k];
+	else if (p[k] > upper[k])
+	  d = p[k] - upper[k];
+	d2 += d * d;
+      }
+    return d2;
+  }
+
+
+  static float
+  _distance2 (const float *a, const float *p)
+  {
+    float dx = a[0] - p[0];
+    float dy = a[1] - p[1];
+    float dz = a[2] - p[2];
+
+    return dx * dx + dy * dy + dz * dz;
+  }
+
+  // LIFECYCLE ------------------------------------------------------------
+
+  SpatialIndex::SpatialIndex (const AbstractModel &model)
+  {
+    build (model);
+  }
+
+  // METHODS --------------------------------------------------------------
+
+  void
+  SpatialIndex::build (const AbstractModel &model)
+  {
+    AbstractModel::const_iterator rit;
+    vector< float > coords;
+    vector< unsigned int > owner;
+    vector< const AtomType* > types;
+    vector< unsigned int > perm;
+    unsigned int n;
+    unsigned int pos;
+
+    clear ();
+    for (rit = model.begin (); model.end () != rit; ++rit)
+      {
+	Residue::const_iterator ait;
+
+	residueIndex.insert (make_pair (&*rit, residues.size ()));
+	residueStart.push_back (types.size ());
+	for (ait = rit->begin (); rit->end () != ait; ++ait)
+	  if (_is_indexed (*ait))
+	    {
+	      coords.push_back (ait->getX ());
+	      coords.push_back (ait->getY ());
+	      coords.push_back (ait->getZ ());
+	      owner.push_back (residues.size ());
+	      types.push_back (ait->getType ());
+	    }
+	residues.push_back (&*rit);
+      }
+    residueStart.push_back (types.size ());
+
+    n = types.size ();
+    if (0 == n)
+      return;
+
+    perm.resize (n);
+    for (pos = 0; pos < n; ++pos)
+      perm[pos] = pos;
+    _build (perm, coords, 0, n, -1);
+
+    // -- store the atoms in hierarchy order
+    xyz.resize (3 * n);
+    atomResidue.resize (n);
+    atomType.resize (n);
+    slot.resize (n);
+    for (pos = 0; pos < n; ++pos)
+      {
+	unsigned int o = perm[pos];
+
+	xyz[3 * pos] = coords[3 * o];
+	xyz[3 * pos + 1] = coords[3 * o + 1];
+	xyz[3 * pos + 2] = coords[3 * o + 2];
+	atomResidue[pos] = owner[o];
+	atomType[pos] = types[o];
+	slot[o] = pos;
+      }
+
+    leafOf.resize (n);
+    for (pos = nodes.size (); pos > 0; --pos)
+      {
+	unsigned int l = pos - 1;
+
+	if (0 > nodes[l].left)
+	  fill (leafOf.begin () + nodes[l].first, leafOf.begin () + nodes[l].last, l);
+	_refit_node (l);
+      }
+  }
+
+
+  int
+  SpatialIndex::_build (vector< unsigned int > &perm, const vector< float > &coords, unsigned int first, unsigned int last, int parent)
+  {
+    int n = nodes.size ();
+    Node node;
+    unsigned int i;
+    unsigned int k;
+
+    node.first = first;
+    node.last = last;
+    node.left = node.right = -1;
+    node.parent = parent;
+    for (k = 0; k < 3; ++k)
+      {
+	node.lower[k] = numeric_limits< float >::max ();
+	node.upper[k] = -numeric_limits< float >::max ();
+      }
+    for (i = first; i < last; ++i)
+      for (k = 0; k < 3; ++k)
+	{
+	  node.lower[k] = min (node.lower[k], coords[3 * perm[i] + k]);
+	  node.upper[k] = max (node.upper[k], coords[3 * perm[i] + k]);
+	}
+    nodes.push_back (node);
+
+    if (LEAF_SIZE < last - first)
+      {
+	unsigned int axis = 0;
+	unsigned int mid = first + (last - first) / 2;
+	int left;
+	int right;
+
+	// -- median split along the widest axis
+	for (k = 1; k < 3; ++k)
+	  if (node.upper[k] - node.lower[k] > node.upper[axis] - node.lower[axis])
+	    axis = k;
+	nth_element (perm.begin () + first, perm.begin () + mid, perm.begin () + last,
+		     SpatialIndexAxisLess (coords, axis));
+
+	left = _build (perm, coords, first, mid, n);
+	right = _build (perm, coords, mid, last, n);
+	nodes[n].left = left;
+	nodes[n].right = right;
+      }
+    return n;
+  }
+
+
+  void
+  SpatialIndex::_refit_node (unsigned int n)
+  {
+    Node &node = nodes[n];
+    unsigned int k;
+
+    if (0 > node.left)
+      {
+	unsigned int i;
+
+	for (k = 0; k < 3; ++k)
+	  {
+	    node.lower[k] = numeric_limits< float >::max ();
+	    node.upper[k] = -numeric_limits< float >::max ();
+	  }
+	for (i = node.first; i < node.last; ++i)
+	  for (k = 0; k < 3; ++k)
+	    {
+	      node.lower[k] = min (node.lower[k], xyz[3 * i + k]);
+	      node.upper[k] = max (node.upper[k], xyz[3 * i + k]);
+	    }
+      }
+    else
+      {
+	const Node &l = nodes[node.left];
+	const Node &r = nodes[node.right];
+
+	for (k = 0; k < 3; ++k)
+	  {
+	    node.lower[k] = min (l.lower[k], r.lower[k]);
+	    node.upper[k] = max (l.upper[k], r.upper[k]);
+	  }
+      }
+  }
+
+
+  void
+  SpatialIndex::refit (const Residue &res)
+  {
+    map< const Residue*, unsigned int >::const_iterator it;
+    Residue::const_iterator ait;
+    set< unsigned int > dirty;
+    set< unsigned int >::reverse_iterator dit;
+    unsigned int o;
+
+    if (residueIndex.end () == (it = residueIndex.find (&res)))
+      {
+	NoSuchElementException ex ("", __FILE__, __LINE__);
+	ex << "residue " << res.getResId () << " is not indexed";
+	throw ex;
+      }
+
+    // -- the atoms are checked before any coordinate is written, so that
+    //    a rejected residue leaves the index untouched
+    o = residueStart[it->second];
+    for (ait = res.begin (); res.end () != ait; ++ait)
+      if (_is_indexed (*ait))
+	{
+	  if (residueStart[it->second + 1] == o
+	      || atomType[slot[o]] != ait->getType ())
+	    break;
+	  ++o;
+	}
+    if (res.end () != ait || residueStart[it->second + 1] != o)
+      {
+	IntLibException ex ("", __FILE__, __LINE__);
+	ex << "atoms of residue " << res.getResId () << " changed since the index was built";
+	throw ex;
+      }
+
+    o = residueStart[it->second];
+    for (ait = res.begin (); res.end () != ait; ++ait)
+      if (_is_indexed (*ait))
+	{
+	  unsigned int pos = slot[o++];
+	  int n;
+
+	  xyz[3 * pos] = ait->getX ();
+	  xyz[3 * pos + 1] = ait->getY ();
+	  xyz[3 * pos + 2] = ait->getZ ();
+
+	  // -- the leaf and its ancestors must be refitted
+	  for (n = leafOf[pos]; 0 <= n && dirty.insert (n).second; n = nodes[n].parent)
+	    ;
+	}
+
+    // -- parents precede their children: refit in decreasing order
+    for (dit = dirty.rbegin (); dirty.rend () != dit; ++dit)
+      _refit_node (*dit);
+  }
+
+
+  void
+  SpatialIndex::clear ()
+  {
+    xyz.clear ();
+    atomResidue.clear ();
+    atomType.clear ();
+    slot.clear ();
+    residueStart.clear ();
+    residues.clear ();
+    residueIndex.clear ();
+    nodes.clear ();
+    leafOf.clear ();
+  }
+
+
+  void
+  SpatialIndex::_radius (const float *p, float radius, vector< unsigned int > &result) const
+  {
+    vector< int > stack;
+    float r2 = radius * radius;
+
+    if (nodes.empty ())
+      return;
+
+    stack.push_back (0);
+    while (! stack.empty ())
+      {
+	const Node &node = nodes[stack.back ()];
+
+	stack.pop_back ();
+	if (_box_distance2 (node.lower, node.upper, p) <= r2)
+	  {
+	    if (0 > node.left)
+	      {
+		unsigned int i;
+
+		for (i = node.first; i < node.last; ++i)
+		  if (_distance2 (&xyz[3 * i], p) <= r2)
+		    result.push_back (i);
+	      }
+	    else
+	      {
+		stack.push_back (node.right);
+		stack.push_back (node.left);
+	      }
+	  }
+      }
+  }
+
+
+  SpatialIndex::AtomRef
+  SpatialIndex::_atom (unsigned int pos) const
+  {
+    const Residue *res = residues[atomResidue[pos]];
+    Residue::const_iterator it = res->find (atomType[pos]);
+
+    return make_pair (res, res->end () == it ? (const Atom*) 0 : &*it);
+  }
+
+
+  void
+  SpatialIndex::findAtoms (const Vector3D &p, float radius, vector< AtomRef > &result) const
+  {
+    float q[3] = { p.getX (), p.getY (), p.getZ () };
+    vector< unsigned int > found;
+    vector< unsigned int >::iterator it;
+
+    _radius (q, radius, found);
+    for (it = found.begin (); found.end () != it; ++it)
+      result.push_back (_atom (*it));
+  }
+
+
+  void
+  SpatialIndex::findResidues (const Vector3D &p, float radius, vector< const Residue* > &result) const
+  {
+    float q[3] = { p.getX (), p.getY (), p.getZ () };
+    vector< unsigned int > found;
+    vector< unsigned int > owners;
+    vector< unsigned int >::iterator it;
+
+    _radius (q, radius, found);
+    for (it = found.begin (); found.end () != it; ++it)
+      owners.push_back (atomResidue[*it]);
+    sort (owners.begin (), owners.end ());
+    owners.erase (unique (owners.begin (), owners.end ()), owners.end ());
+    for (it = owners.begin (); owners.end () != it; ++it)
+      result.push_back (residues[*it]);
+  }
+
+
+  void
+  SpatialIndex::findResidues (const Residue &res, float radius, vector< const Residue* > &result) const
+  {
+    map< const Residue*, unsigned int >::const_iterator rit;
+    vector< unsigned int > found;
+    vector< unsigned int > owners;
+    vector< unsigned int >::iterator it;
+    unsigned int o;
+
+    if (residueIndex.end () == (rit = residueIndex.find (&res)))
+      {
+	NoSuchElementException ex ("", __FILE__, __LINE__);
+	ex << "residue " << res.getResId () << " is not indexed";
+	throw ex;
+      }
+
+    for (o = residueStart[rit->second]; o < residueStart[rit->second + 1]; ++o)
+      {
+	found.clear ();
+	_radius (&xyz[3 * slot[o]], radius, found);
+	for (it = found.begin (); found.end () != it; ++it)
+	  if (rit->second != atomResidue[*it])
+	    owners.push_back (atomResidue[*it]);
+      }
+    sort (owners.begin (), owners.end ());
+    owners.erase (unique (owners.begin (), owners.end ()), owners.end ());
+    for (it = owners.begin (); owners.end () != it; ++it)
+      result.push_back (residues[*it]);
+  }
+
+
+  void
+  SpatialIndex::findNearest (const Vector3D &p, unsigned int k, vector< AtomRef > &result) const
+  {
+    typedef pair< float, unsigned int > Candidate;
+    float q[3] = { p.getX (), p.getY (), p.getZ () };
+    priority_queue< Candidate, vector< Candidate >, greater< Candidate > > open;
+    priority_queue< Candidate > best;
+    vector< Candidate > sorted;
+    vector< Candidate >::iterator it;
+
+    if (nodes.empty () || 0 == k)
+      return;
+
+    // -- best first traversal, nodes ordered by distance to their box
+    open.push (make_pair (_box_distance2 (nodes[0].lower, nodes[0].upper, q), 0u));
+    while (! open.empty ()
+	   && (best.size () < k || open.top ().first <= best.top ().first))
+      {
+	const Node &node = nodes[open.top ().second];
+
+	open.pop ();
+	if (0 > node.left)
+	  {
+	    unsigned int i;
+
+	    for (i = node.first; i < node.last; ++i)
+	      {
+		Candidate c (_distance2 (&xyz[3 * i], q), i);
+
+		if (best.size () < k)
+		  best.push (c);
+		else if (c < best.top ())
+		  {
+		    best.pop ();
+		    best.push (c);
+		  }
+	      }
+	  }
+	else
+	  {
+	    const Node &l = nodes[node.left];
+	    const Node &r = nodes[node.right];
+
+	    open.push (make_pair (_box_distance2 (l.lower, l.upper, q), (unsigned int) node.left));
+	    open.push (make_pair (_box_distance2 (r.lower, r.upper, q), (unsigned int) node.right));
+	  }
+      }
+
+    for (; ! best.empty (); best.pop ())
+      sorted.push_back (best.top ());
+    for (it = sorted.end (); sorted.begin () != it; )
+      result.push_back (_atom ((--it)->second));
+  }
+
+
+  void
+  SpatialIndex::findContacts (float cutoff, vector< ResiduePair > &result) const
+  {
+    vector< unsigned int > stamp (residues.size (), 0);
+    vector< unsigned int > found;
+    vector< unsigned int > partners;
+    vector< unsigned int >::iterator it;
+    unsigned int r;
+    unsigned int o;
+
+    for (r = 0; r < residues.size (); ++r)
+      {
+	partners.clear ();
+	for (o = residueStart[r]; o < residueStart[r + 1]; ++o)
+	  {
+	    found.clear ();
+	    _radius (&xyz[3 * slot[o]], cutoff, found);
+	    for (it = found.begin (); found.end () != it; ++it)
+	      {
+		unsigned int s = atomResidue[*it];
+
+		if (r < s && r + 1 != stamp[s])
+		  {
+		    stamp[s] = r + 1;
+		    partners.push_back (s);
+		  }
+	      }
+	  }
+	sort (partners.begin (), partners.end ());
+	for (it = partners.begin (); partners.end () != it; ++it)
+	  result.push_back (make_pair (residues[r], residues[*it]));
+      }
+  }
+
+}
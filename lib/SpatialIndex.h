@@ -0,0 +1,274 @@
+//                              -*- Mode: C++ -*-
+// SpatialIndex.h
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef _mccore_SpatialIndex_h_
+#define _mccore_SpatialIndex_h_
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Exception.h"
+
+using namespace std;
+
+
+
+namespace mccore
+{
+  class AbstractModel;
+  class Atom;
+  class AtomType;
+  class Residue;
+  class Vector3D;
+
+
+
+  /**
+   * @short Spatial index over the atoms of a model.
+   *
+   * The atoms (pseudo-atoms and lone pairs excluded) are stored in a
+   * bounding volume hierarchy built by median splits along the widest
+   * axis, each atom keeping a reference to its residue.  The index answers
+   * radius, k-nearest and residue contact queries without scanning the
+   * whole model.
+   *
+   * The index keeps copies of the atom coordinates.  When residues are
+   * moved, refit updates their atoms and the node volumes in place; the
+   * hierarchy quality degrades with large moves, build restores it.  The
+   * indexed residues must outlive the index, and atoms returned by
+   * queries are valid until their residue is modified.
+   */
+  class SpatialIndex
+  {
+  public:
+
+    typedef pair< const Residue*, const Atom* > AtomRef;
+    typedef pair< const Residue*, const Residue* > ResiduePair;
+
+  private:
+
+    /**
+     * Hierarchy node: the bounding box of the atoms [first, last) and the
+     * child nodes (-1 for leaves).
+     */
+    struct Node
+    {
+      float lower[3];
+      float upper[3];
+      unsigned int first;
+      unsigned int last;
+      int left;
+      int right;
+      int parent;
+    };
+
+    /**
+     * Atom coordinates, in hierarchy order.
+     */
+    vector< float > xyz;
+
+    /**
+     * Index of the residue of each atom, in hierarchy order.
+     */
+    vector< unsigned int > atomResidue;
+
+    /**
+     * Type of each atom, in hierarchy order.
+     */
+    vector< const AtomType* > atomType;
+
+    /**
+     * Hierarchy position of the atoms in residue order.
+     */
+    vector< unsigned int > slot;
+
+    /**
+     * First atom of each residue in residue order, plus a sentinel.
+     */
+    vector< unsigned int > residueStart;
+
+    /**
+     * The indexed residues, in model order.
+     */
+    vector< const Residue* > residues;
+
+    /**
+     * Positions of the indexed residues.
+     */
+    map< const Residue*, unsigned int > residueIndex;
+
+    /**
+     * The hierarchy nodes, the root first.  Parents precede their
+     * children.
+     */
+    vector< Node > nodes;
+
+    /**
+     * The leaf holding each hierarchy position.
+     */
+    vector< unsigned int > leafOf;
+
+    /**
+     * Maximum number of atoms in a leaf.
+     */
+    static const unsigned int LEAF_SIZE = 8;
+
+  public:
+
+    // LIFECYCLE ------------------------------------------------------------
+
+    /**
+     * Initializes an empty index.
+     */
+    SpatialIndex () { }
+
+    /**
+     * Initializes the index over the model's atoms.
+     * @param model the model to index.
+     */
+    SpatialIndex (const AbstractModel &model);
+
+    /**
+     * Destroys the object.
+     */
+    ~SpatialIndex () { }
+
+    // ACCESS ---------------------------------------------------------------
+
+    /**
+     * Gets the number of indexed atoms.
+     * @return the atom count.
+     */
+    unsigned int size () const { return atomType.size (); }
+
+    /**
+     * Tells whether the index holds no atom.
+     * @return whether the index is empty.
+     */
+    bool empty () const { return atomType.empty (); }
+
+    /**
+     * Gets the number of indexed residues.
+     * @return the residue count.
+     */
+    unsigned int residueSize () const { return residues.size (); }
+
+    // METHODS --------------------------------------------------------------
+
+    /**
+     * Rebuilds the index over the model's atoms.
+     * @param model the model to index.
+     */
+    void build (const AbstractModel &model);
+
+    /**
+     * Updates the coordinates of a residue's atoms and the enclosing
+     * volumes, typically after the residue was transformed.
+     * @param res the indexed residue.
+     * @exception NoSuchElementException if the residue is not indexed.
+     * @exception IntLibException if the residue atoms changed since the
+     * last build; the index is then left unchanged.
+     */
+    void refit (const Residue &res);
+
+    /**
+     * Removes all atoms from the index.
+     */
+    void clear ();
+
+    /**
+     * Finds the atoms within a distance of a point.
+     * @param p the point.
+     * @param radius the distance.
+     * @param result the atoms found, appended in no particular order.
+     */
+    void findAtoms (const Vector3D &p, float radius, vector< AtomRef > &result) const;
+
+    /**
+     * Finds the residues having an atom within a distance of a point.
+     * @param p the point.
+     * @param radius the distance.
+     * @param result the residues found, appended in model order.
+     */
+    void findResidues (const Vector3D &p, float radius, vector< const Residue* > &result) const;
+
+    /**
+     * Finds the residues having an atom within a distance of any atom of
+     * an indexed residue, the residue itself excluded.
+     * @param res the indexed residue.
+     * @param radius the distance.
+     * @param result the residues found, appended in model order.
+     * @exception NoSuchElementException if the residue is not indexed.
+     */
+    void findResidues (const Residue &res, float radius, vector< const Residue* > &result) const;
+
+    /**
+     * Finds the k atoms nearest to a point.
+     * @param p the point.
+     * @param k the number of atoms.
+     * @param result the atoms found, appended by increasing distance.
+     */
+    void findNearest (const Vector3D &p, unsigned int k, vector< AtomRef > &result) const;
+
+    /**
+     * Enumerates the residue pairs having atoms within a distance.  Pairs
+     * are ordered by model position, the first residue preceding the
+     * second.
+     * @param cutoff the distance.
+     * @param result the residue pairs, appended.
+     */
+    void findContacts (float cutoff, vector< ResiduePair > &result) const;
+
+  private:
+
+    /**
+     * @internal
+     * Builds the subtree over the atoms [first, last) of the permutation.
+     * @return the node index.
+     */
+    int _build (vector< unsigned int > &perm, const vector< float > &coords, unsigned int first, unsigned int last, int parent);
+
+    /**
+     * @internal
+     * Recomputes the bounding box of a node from its atoms or children.
+     */
+    void _refit_node (unsigned int n);
+
+    /**
+     * @internal
+     * Collects the hierarchy positions of the atoms within a distance of
+     * a point.
+     */
+    void _radius (const float *p, float radius, vector< unsigned int > &result) const;
+
+    /**
+     * @internal
+     * Gets an atom of the index.
+     */
+    AtomRef _atom (unsigned int pos) const;
+
+  };
+
+}
+
+#endif
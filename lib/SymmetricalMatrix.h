@@ -168,6 +168,8 @@ namespace mccore
      */
     oBinstream& write (oBinstream& obs) const;
 
+  };
+
 
     template< class Type >
     SymmetricalMatrix< Type >::SymmetricalMatrix (int n, void (*cf) (Type&))
@@ -182,7 +184,8 @@ namespace mccore
     template< class Type >
     SymmetricalMatrix< Type >::SymmetricalMatrix (const SymmetricalMatrix< Type >& right)
       : oneSize (right.oneSize),
-	twoSize (right.twoSize)
+	twoSize (right.twoSize),
+	cleanup (NULL)
     {
       matrix = new Type[oneSize];
       for (int i = 0; i < oneSize; ++i)
@@ -214,12 +217,12 @@ namespace mccore
     {
       if (this != &right)
 	{
-	  oneSize = right.oneSize;
-	  twoSize = right.twoSize;
 	  if (cleanup)
 	    for (int i = 0; i < oneSize; ++i)
 	      (*cleanup) (matrix[i]);
 	  delete[] matrix;
+	  oneSize = right.oneSize;
+	  twoSize = right.twoSize;
 	  matrix = new Type[oneSize];
 	  for (int i = 0; i < oneSize; ++i)
 	    matrix[i] = right.matrix[i];
@@ -250,6 +253,7 @@ namespace mccore
 	for (int i = 0; i < oneSize; ++i)
 	  (*cleanup) (matrix[i]);
       delete[] matrix;
+      matrix = 0;
       oneSize = 0;
       twoSize = 0;
     }
@@ -313,7 +317,6 @@ namespace mccore
       return obs;
     }
     
-  };
   
   /**
    * Initialize object from a binary stream.
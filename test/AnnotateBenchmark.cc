@@ -0,0 +1,168 @@
+//                              -*- Mode: C++ -*-
+// AnnotateBenchmark.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/time.h>
+
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Parallel.h"
+#include "Pdbstream.h"
+#include "Relation.h"
+#include "ResId.h"
+#include "Residue.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+static double
+milliseconds ()
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, 0);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+
+/**
+ * Builds a model from copies of the source model set apart along x.
+ */
+static void
+tile (GraphModel &model, const GraphModel &source, unsigned int copies)
+{
+  GraphModel::const_iterator it;
+  unsigned int c;
+  int n = 0;
+
+  model.clear ();
+  for (c = 0; c < copies; ++c)
+    for (it = source.begin (); source.end () != it; ++it)
+      {
+	Residue res (*it);
+
+	res.transform (HomogeneousTransfo::translation (200.0 * c, 0, 0));
+	res.setResId (ResId ('A', ++n));
+	model.insert (res);
+      }
+}
+
+
+/**
+ * Prints the edges by label, to compare the annotations.
+ */
+static string
+edges (const GraphModel &model)
+{
+  ostringstream oss;
+  GraphModel::edge_size_type label;
+
+  for (label = 0; label < model.edgeSize (); ++label)
+    model.internalGetEdge (label)->write (oss) << endl;
+  return oss.str ();
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel pdb;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> pdb;
+      ifs.close ();
+      pdb.addHLP ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  gOut (0) << Parallel::getProcessorCount () << " processors" << endl
+	   << "residues\trelations\tthreads\tannotate (ms)\tspeedup" << endl;
+  for (unsigned int copies = 1; copies <= 4; copies *= 4)
+    {
+      GraphModel model;
+      string reference;
+      double sequentialms = 0;
+
+      tile (model, pdb, copies);
+
+      // -- an untimed annotation fills the residue caches, as for the
+      //    annotations measured afterwards
+      model.reannotate ();
+      model.setAnnotationStats (true);
+      for (unsigned int nthreads = 1; nthreads <= 8; nthreads *= 2)
+	{
+	  double t;
+	  double ms;
+
+	  Residue::resetHBondCacheStats ();
+	  t = milliseconds ();
+	  model.reannotate (Relation::adjacent_mask | Relation::pairing_mask | Relation::stacking_mask | Relation::bhbond_mask, nthreads);
+	  ms = milliseconds () - t;
+
+	  if (1 == nthreads)
+	    {
+	      reference = edges (model);
+	      sequentialms = ms;
+	      gOut (0) << "H-bond candidates: " << Residue::getHBondCacheMisses ()
+		       << " scans, " << Residue::getHBondCacheHits () << " reuses" << endl
+		       << model.getAnnotationStats ();
+	    }
+	  else if (edges (model) != reference)
+	    {
+	      gErr (0) << argv[0] << ": " << nthreads << " threads disagree on "
+		       << model.size () << " residues" << endl;
+	      return EXIT_FAILURE;
+	    }
+
+	  gOut (0) << model.size () << "\t" << model.edgeSize () << "\t" << nthreads
+		   << "\t" << ms << "\t" << sequentialms / ms << endl;
+	}
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+//                              -*- Mode: C++ -*-
+// AnnotationStats.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cstdlib>
+#include <iostream>
+
+#include "AnnotationStats.h"
+#include "GraphModel.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Relation.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Prints the counts of annotation statistics, their times varying.
+ */
+static void
+counts (const AnnotationStats &stats)
+{
+  unsigned long rejects = (stats.getBoundsRejects () + stats.getSphereRejects ()
+			   + stats.getNormalRejects () + stats.getDonorRejects ());
+
+  gOut (0) << "contacts: " << stats.getContacts ()
+	   << " relations: " << stats.getRelations () << endl
+	   << "adjacent: " << stats.getRelations (Relation::adjacent_mask)
+	   << " stacking: " << stats.getRelations (Relation::stacking_mask)
+	   << " pairing: " << stats.getRelations (Relation::pairing_mask)
+	   << " bhbond: " << stats.getRelations (Relation::bhbond_mask) << endl
+	   << "pairing tested: " << stats.getPairingTested ()
+	   << " rejects: " << rejects << endl
+	   << "H-bonds evaluated: " << stats.getHBonds ()
+	   << " flow networks: " << stats.getFlows () << endl;
+}
+
+
+/**
+ * Tells whether two annotation statistics have the same counts.
+ */
+static bool
+sameCounts (const AnnotationStats &a, const AnnotationStats &b)
+{
+  return (a.getContacts () == b.getContacts ()
+	  && a.getRelations () == b.getRelations ()
+	  && a.getPairingTested () == b.getPairingTested ()
+	  && a.getBoundsRejects () == b.getBoundsRejects ()
+	  && a.getSphereRejects () == b.getSphereRejects ()
+	  && a.getNormalRejects () == b.getNormalRejects ()
+	  && a.getDonorRejects () == b.getDonorRejects ()
+	  && a.getHBonds () == b.getHBonds ()
+	  && a.getFlows () == b.getFlows ());
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  // -- nothing is gathered by default
+  model.annotate ();
+  gOut (0) << "Disabled" << endl;
+  counts (model.getAnnotationStats ());
+
+  model.setAnnotationStats (true);
+  model.reannotate ();
+  gOut (0) << "Annotation" << endl;
+  counts (model.getAnnotationStats ());
+  gOut (0) << "one relation per edge pair: "
+	   << (2 * model.getAnnotationStats ().getRelations () == model.edgeSize () ? "yes" : "no")
+	   << endl
+	   << "stage times add up: "
+	   << (0 <= model.getAnnotationStats ().getTime (AnnotationStats::hlp_stage)
+	       && 0 <= model.getAnnotationStats ().getTime (AnnotationStats::contact_stage)
+	       && 0 <= model.getAnnotationStats ().getTime (AnnotationStats::relation_stage)
+	       && (model.getAnnotationStats ().getTime ()
+		   == (model.getAnnotationStats ().getTime (AnnotationStats::hlp_stage)
+		       + model.getAnnotationStats ().getTime (AnnotationStats::contact_stage)
+		       + model.getAnnotationStats ().getTime (AnnotationStats::relation_stage)))
+	       ? "yes" : "no") << endl;
+
+  // -- the threads count into their own statistics, whatever the shared
+  //    Relation counters hold
+  AnnotationStats sequential = model.getAnnotationStats ();
+
+  Relation::resetPairingStats ();
+  model.reannotate (Relation::adjacent_mask | Relation::pairing_mask | Relation::stacking_mask | Relation::bhbond_mask, 4);
+  gOut (0) << "threaded: "
+	   << (sameCounts (model.getAnnotationStats (), sequential) ? "same" : "different")
+	   << " counts" << endl;
+
+  // -- the incremental annotation counts its own work
+  model.markDirty (*model.begin ());
+  model.annotateDirty ();
+  gOut (0) << "Incremental annotation" << endl;
+  counts (model.getAnnotationStats ());
+
+  return EXIT_SUCCESS;
+}
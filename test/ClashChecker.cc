@@ -0,0 +1,265 @@
+//                              -*- Mode: C++ -*-
+// ClashChecker.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "Atom.h"
+#include "AtomType.h"
+#include "ClashChecker.h"
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Tells whether the atoms of two residues are bonded.
+ */
+static bool
+bonded (const Residue &a, const AtomType *ta, const Residue &b, const AtomType *tb)
+{
+  Residue::const_iterator x = a.find (ta);
+  Residue::const_iterator y = b.find (tb);
+
+  return a.end () != x && b.end () != y && 4.0 >= x->squareDistance (*y);
+}
+
+
+/**
+ * Tells whether two atom types are around a link between their residues:
+ * the upstream atom types are listed first.
+ */
+static bool
+around (const AtomType *t, const AtomType **types, unsigned int n)
+{
+  unsigned int i;
+
+  for (i = 0; i < n; ++i)
+    if (types[i] == t)
+      return true;
+  return false;
+}
+
+
+/**
+ * Tells whether a pair of atoms of two residues is excluded by a
+ * phosphodiester or peptide bond between the residues.
+ */
+static bool
+excluded (const Residue &ra, const Atom &a, const Residue &rb, const Atom &b)
+{
+  static const AtomType *o3p[] = { AtomType::aO3p, AtomType::aC3p, AtomType::aC2p,
+				   AtomType::aC4p, AtomType::aH3p };
+  static const AtomType *p[] = { AtomType::aP, AtomType::aO1P, AtomType::aO2P,
+				 AtomType::aO3P, AtomType::aO5p, AtomType::aC5p };
+  static const AtomType *c[] = { AtomType::aC, AtomType::aCA, AtomType::aO };
+  static const AtomType *n[] = { AtomType::aN, AtomType::aCA, AtomType::aH };
+  const AtomType *ta = a.getType ();
+  const AtomType *tb = b.getType ();
+
+  return ((around (ta, o3p, 5) && around (tb, p, 6) && bonded (ra, AtomType::aO3p, rb, AtomType::aP))
+	  || (around (ta, p, 6) && around (tb, o3p, 5) && bonded (ra, AtomType::aP, rb, AtomType::aO3p))
+	  || (around (ta, c, 3) && around (tb, n, 3) && bonded (ra, AtomType::aC, rb, AtomType::aN))
+	  || (around (ta, n, 3) && around (tb, c, 3) && bonded (ra, AtomType::aN, rb, AtomType::aC)));
+}
+
+
+/**
+ * Tells whether the bounding boxes of two residues are farther apart than
+ * any clash: their atom pairs need no test.
+ */
+static bool
+apart (const Residue &a, const Residue &b)
+{
+  Vector3D la, ua, lb, ub;
+
+  if (! a.getBoundingBox (la, ua) || ! b.getBoundingBox (lb, ub))
+    return true;
+  return (la.getX () - ub.getX () > 10.0 || lb.getX () - ua.getX () > 10.0
+	  || la.getY () - ub.getY () > 10.0 || lb.getY () - ua.getY () > 10.0
+	  || la.getZ () - ub.getZ () > 10.0 || lb.getZ () - ua.getZ () > 10.0);
+}
+
+
+/**
+ * Computes the clash score of a residue by testing all its atom pairs
+ * with the placed residues.
+ * @param excludedPairs incremented by the clashing pairs excluded by a
+ * bond.
+ */
+static float
+scan (const ClashChecker &checker, const Residue &res, const vector< const Residue* > &placed, unsigned int &excludedPairs)
+{
+  vector< const Residue* >::const_iterator pIt;
+  float score = 0;
+
+  for (pIt = placed.begin (); placed.end () != pIt; ++pIt)
+    {
+      const Residue &other = **pIt;
+      Residue::const_iterator a;
+      Residue::const_iterator b;
+
+      if (&other == &res || apart (res, other))
+	continue;
+      for (a = res.begin (); res.end () != a; ++a)
+	{
+	  float ra = checker.getRadius (*a, res);
+
+	  if (0 < ra)
+	    for (b = other.begin (); other.end () != b; ++b)
+	      {
+		float rb = checker.getRadius (*b, other);
+		float limit = checker.getScale () * (ra + rb);
+		float d = a->distance (*b);
+
+		if (0 >= rb || d >= limit)
+		  continue;
+		if (excluded (res, *a, other, *b))
+		  ++excludedPairs;
+		else
+		  score += limit - d;
+	      }
+	}
+    }
+  return score;
+}
+
+
+/**
+ * Compares the checker with the scan on a residue.
+ * @return whether the score and the clash test agree with the scan.
+ */
+static bool
+agree (const ClashChecker &checker, const Residue &res, const vector< const Residue* > &placed, unsigned int &clashing, unsigned int &excludedPairs)
+{
+  float expected = scan (checker, res, placed, excludedPairs);
+  float score = checker.getClashScore (res);
+
+  if (0 < expected)
+    ++clashing;
+  return (fabs (score - expected) <= 1e-3 * (1 + expected)
+	  && checker.clashes (res) == (0 < expected));
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+  GraphModel::const_iterator mIt;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  const GraphModel &placedModel = model;
+  ClashChecker checker;
+  vector< const Residue* > placed;
+  vector< const Residue* > kept;
+  vector< const Residue* >::iterator it;
+  unsigned int mismatches = 0;
+  unsigned int clashing = 0;
+  unsigned int excludedPairs = 0;
+  unsigned int n;
+
+  for (mIt = placedModel.begin (); placedModel.end () != mIt; ++mIt)
+    {
+      checker.insert (*mIt);
+      placed.push_back (&*mIt);
+    }
+  gOut (0) << "Residues: " << checker.size ()
+	   << " Atoms: " << checker.atomSize () << endl;
+
+  // -- the model itself: bonded neighbours are excluded
+  for (it = placed.begin (); placed.end () != it; ++it)
+    if (! agree (checker, **it, placed, clashing, excludedPairs))
+      ++mismatches;
+  gOut (0) << "model: " << clashing << " clashing residues, "
+	   << (0 < excludedPairs ? "some" : "no") << " bonded pairs excluded, "
+	   << mismatches << " mismatches" << endl;
+
+  // -- backtracking: half of the residues erased, moved copies tested
+  for (it = placed.begin (), n = 0; placed.end () != it; ++it, ++n)
+    if (0 == n % 2)
+      checker.erase (**it);
+    else
+      kept.push_back (*it);
+
+  clashing = excludedPairs = mismatches = 0;
+  for (n = 0; n < 200; ++n)
+    {
+      Residue res (*placed[(n * 13) % placed.size ()]);
+
+      res.transform (HomogeneousTransfo::translation (n % 5 - 2.0, n % 3 - 1.0, n % 7 - 3.0));
+      if (! agree (checker, res, kept, clashing, excludedPairs))
+	++mismatches;
+    }
+  gOut (0) << "moved copies: " << clashing << " clashing, "
+	   << mismatches << " mismatches" << endl;
+
+  // -- ignored atom types, for the atoms placed afterwards
+  checker.clear ();
+  checker.setRadius (AtomType::aP, 0);
+  for (it = kept.begin (); kept.end () != it; ++it)
+    checker.insert (**it);
+  clashing = excludedPairs = mismatches = 0;
+  for (it = kept.begin (); kept.end () != it; ++it)
+    if (! agree (checker, **it, kept, clashing, excludedPairs))
+      ++mismatches;
+  gOut (0) << "without phosphorus: " << mismatches << " mismatches" << endl;
+
+  for (it = kept.begin (); kept.end () != it; ++it)
+    checker.erase (**it);
+  gOut (0) << "erased: " << checker.size () << " residues, "
+	   << checker.atomSize () << " atoms" << endl;
+
+  return EXIT_SUCCESS;
+}
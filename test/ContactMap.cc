@@ -0,0 +1,334 @@
+//                              -*- Mode: C++ -*-
+// ContactMap.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include "Algo.h"
+#include "Binstream.h"
+#include "ContactMap.h"
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Relation.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+typedef GraphModel::const_iterator ResIt;
+typedef set< pair< unsigned int, unsigned int > > ContactSet;
+
+
+
+/**
+ * Gets the contacts of a map as a set.
+ */
+static ContactSet
+contacts (const ContactMap &cmap)
+{
+  vector< pair< unsigned int, unsigned int > > v;
+
+  cmap.getContacts (v);
+  return ContactSet (v.begin (), v.end ());
+}
+
+
+/**
+ * Gets the relation types between two residues of an annotated model, in
+ * both directions.
+ */
+static unsigned char
+relationTypes (const GraphModel &model, unsigned int i, unsigned int j)
+{
+  unsigned char mask = 0;
+
+  if (model.internalAreConnected (i, j))
+    mask |= model.internalGetEdge (i, j)->getAnnotationType ();
+  if (model.internalAreConnected (j, i))
+    mask |= model.internalGetEdge (j, i)->getAnnotationType ();
+  return mask;
+}
+
+
+/**
+ * Checks a map built from an annotated model against its relations.
+ * @return the number of contacts that differ.
+ */
+static unsigned int
+checkRelations (const ContactMap &cmap, const GraphModel &model)
+{
+  unsigned int errors = 0;
+  unsigned int i;
+  unsigned int j;
+
+  for (i = 0; i < cmap.size (); ++i)
+    for (j = i + 1; j < cmap.size (); ++j)
+      {
+	unsigned char mask = relationTypes (model, i, j);
+
+	if (cmap.contains (i, j) != (0 != mask)
+	    || (0 != mask && cmap.getMask (j, i) != mask))
+	  ++errors;
+      }
+  return errors;
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  const GraphModel &cmodel = model;
+  RDATypeFilter< ResIt > filter;
+  vector< pair< ResIt, ResIt > > boxes;
+  vector< pair< ResIt, ResIt > > refined;
+  vector< float > dist;
+  map< const Residue*, unsigned int > position;
+  ResIt it;
+  unsigned int errors = 0;
+  unsigned int n;
+
+  for (it = cmodel.begin (), n = 0; cmodel.end () != it; ++it, ++n)
+    position[&*it] = n;
+
+  // -- building from extracted and refined contacts
+  Algo::extractContacts (boxes, cmodel.begin (), cmodel.end (), filter, 5.0, Algo::grid_engine);
+  refined = boxes;
+  Algo::refineContacts (refined, dist, 3.0);
+
+  ContactMap boxMap (cmodel.begin (), cmodel.end (), boxes);
+  ContactMap distMap (cmodel.begin (), cmodel.end (), refined, dist);
+
+  for (n = 0; n < refined.size (); ++n)
+    {
+      unsigned int i = position[&*refined[n].first];
+      unsigned int j = position[&*refined[n].second];
+
+      if (! distMap.contains (j, i)
+	  || distMap.getDistance (i, j) != dist[n]
+	  || distMap.getDistance (j, i) != dist[n])
+	++errors;
+    }
+  gOut (0) << "Residues: " << boxMap.size ()
+	   << " box contacts: " << boxMap.contactSize () << " of " << boxes.size ()
+	   << ", refined: " << distMap.contactSize () << " of " << refined.size ()
+	   << ", " << errors << " errors" << endl;
+
+  // -- a contact given twice keeps its smaller distance
+  vector< pair< ResIt, ResIt > > twice;
+  vector< float > twiceDist;
+
+  twice.push_back (refined.front ());
+  twiceDist.push_back (2.5);
+  twice.push_back (make_pair (refined.front ().second, refined.front ().first));
+  twiceDist.push_back (1.5);
+
+  ContactMap twiceMap (cmodel.begin (), cmodel.end (), twice, twiceDist);
+  unsigned int ti = position[&*refined.front ().first];
+  unsigned int tj = position[&*refined.front ().second];
+
+  gOut (0) << "contact given twice: " << twiceMap.contactSize () << " contact, distance "
+	   << twiceMap.getDistance (ti, tj) << endl;
+
+  // -- set operations on distances: the smaller one is kept
+  vector< pair< ResIt, ResIt > > firstContacts;
+  vector< pair< ResIt, ResIt > > secondContacts;
+  vector< float > firstDist;
+  vector< float > secondDist;
+
+  for (n = 0; n < boxes.size (); ++n)
+    {
+      if (0 != n % 2)
+	{
+	  firstContacts.push_back (boxes[n]);
+	  firstDist.push_back (n % 7);
+	}
+      if (0 != n % 3)
+	{
+	  secondContacts.push_back (boxes[n]);
+	  secondDist.push_back (n % 5);
+	}
+    }
+
+  ContactMap first (cmodel.begin (), cmodel.end (), firstContacts, firstDist);
+  ContactMap second (cmodel.begin (), cmodel.end (), secondContacts, secondDist);
+  ContactMap unionMap = first.getUnion (second);
+  ContactMap interMap = first.getIntersection (second);
+  ContactMap diffMap = first.getDifference (second);
+  ContactSet a = contacts (first);
+  ContactSet b = contacts (second);
+  ContactSet u;
+  ContactSet in;
+  ContactSet df;
+  ContactSet::iterator cit;
+
+  set_union (a.begin (), a.end (), b.begin (), b.end (), inserter (u, u.begin ()));
+  set_intersection (a.begin (), a.end (), b.begin (), b.end (), inserter (in, in.begin ()));
+  set_difference (a.begin (), a.end (), b.begin (), b.end (), inserter (df, df.begin ()));
+
+  errors = 0;
+  for (cit = u.begin (); u.end () != cit; ++cit)
+    {
+      float expected = (! first.contains (cit->first, cit->second)
+			? second.getDistance (cit->first, cit->second)
+			: ! second.contains (cit->first, cit->second)
+			? first.getDistance (cit->first, cit->second)
+			: min (first.getDistance (cit->first, cit->second),
+			       second.getDistance (cit->first, cit->second)));
+
+      if (unionMap.getDistance (cit->second, cit->first) != expected)
+	++errors;
+    }
+  for (cit = in.begin (); in.end () != cit; ++cit)
+    if (interMap.getDistance (cit->first, cit->second)
+	!= min (first.getDistance (cit->first, cit->second),
+		second.getDistance (cit->first, cit->second)))
+      ++errors;
+  for (cit = df.begin (); df.end () != cit; ++cit)
+    if (diffMap.getDistance (cit->second, cit->first) != first.getDistance (cit->first, cit->second))
+      ++errors;
+  gOut (0) << "union: " << unionMap.contactSize ()
+	   << (contacts (unionMap) == u ? " same" : " different")
+	   << ", intersection: " << interMap.contactSize ()
+	   << (contacts (interMap) == in ? " same" : " different")
+	   << ", difference: " << diffMap.contactSize ()
+	   << (contacts (diffMap) == df ? " same" : " different")
+	   << ", " << errors << " distance errors" << endl;
+
+  // -- relation types of annotated models: both directions, unions and
+  //    intersections of the masks
+  GraphModel moved (model);
+  GraphModel::iterator mit;
+
+  for (mit = moved.begin (), n = 0; moved.end () != mit; ++mit, ++n)
+    if (0 == n % 4)
+      mit->transform (HomogeneousTransfo::translation (0.8, -0.6, 0.4));
+  model.annotate ();
+  moved.annotate ();
+
+  ContactMap relations (model);
+  ContactMap movedRelations (moved);
+  ContactMap relUnion = relations.getUnion (movedRelations);
+  ContactMap relInter = relations.getIntersection (movedRelations);
+  unsigned int i;
+  unsigned int j;
+  unsigned int maskErrors = 0;
+
+  for (i = 0; i < relations.size (); ++i)
+    for (j = i + 1; j < relations.size (); ++j)
+      {
+	unsigned char ma = relationTypes (model, i, j);
+	unsigned char mb = relationTypes (moved, i, j);
+
+	if (relUnion.contains (i, j) != (0 != (ma | mb))
+	    || relInter.contains (i, j) != (0 != ma && 0 != mb)
+	    || (0 != (ma | mb) && relUnion.getMask (i, j) != (ma | mb))
+	    || (0 != ma && 0 != mb && relInter.getMask (i, j) != (ma & mb)))
+	  ++maskErrors;
+      }
+  gOut (0) << "relations: " << relations.contactSize ()
+	   << " and " << movedRelations.contactSize () << ", "
+	   << checkRelations (relations, model) + checkRelations (movedRelations, moved)
+	   << " errors, union: " << relUnion.contactSize ()
+	   << " intersection: " << relInter.contactSize ()
+	   << ", " << maskErrors << " mask errors" << endl;
+
+  ContactMap mixed = distMap.getUnion (relations);
+
+  gOut (0) << "distances and relation types merged: "
+	   << (mixed.hasDistances () ? "distances" : "no distances") << ", "
+	   << (mixed.hasMasks () ? "relation types" : "no relation types") << endl;
+
+  // -- binary stream round trip
+  stringbuf buffer;
+  oBinstream obs (&buffer);
+  iBinstream ibs (&buffer);
+  ContactMap readDist;
+  ContactMap readRelations;
+  ContactMap readEmpty;
+
+  obs << distMap << relations << ContactMap ();
+  ibs >> readDist >> readRelations >> readEmpty;
+  gOut (0) << "binstream: "
+	   << (readDist == distMap && readDist.hasDistances () && ! readDist.hasMasks ()
+	       ? "distances kept" : "distances lost") << ", "
+	   << (readRelations == relations && readRelations.hasMasks () && ! readRelations.hasDistances ()
+	       ? "relation types kept" : "relation types lost") << ", "
+	   << (readEmpty == ContactMap () ? "empty kept" : "empty lost") << endl;
+
+  try
+    {
+      distMap.getUnion (ContactMap ());
+      gOut (0) << "different residues merged" << endl;
+    }
+  catch (IntLibException &ex)
+    {
+      gOut (0) << "different residues rejected" << endl;
+    }
+
+  try
+    {
+      boxMap.getDistance (ti, tj);
+      gOut (0) << "missing distance found" << endl;
+    }
+  catch (NoSuchElementException &ex)
+    {
+      gOut (0) << "missing distance rejected" << endl;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,223 @@
+//                              -*- Mode: C++ -*-
+// ContactTracker.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <vector>
+
+#include "Algo.h"
+#include "ContactTracker.h"
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+typedef pair< const Residue*, const Residue* > Contact;
+
+
+
+/**
+ * Orders a contact on its residue addresses, the tracker and
+ * extractContacts order the pairs differently.
+ */
+static Contact
+normalize (const Contact &c)
+{
+  return c.first < c.second ? c : make_pair (c.second, c.first);
+}
+
+
+/**
+ * Extracts the contacts between the tracked residues.
+ */
+static set< Contact >
+extract (const vector< Residue > &residues, const vector< bool > &tracked, float cutoff)
+{
+  vector< pair< vector< Residue >::const_iterator, vector< Residue >::const_iterator > > contacts;
+  vector< pair< vector< Residue >::const_iterator, vector< Residue >::const_iterator > >::iterator it;
+  RDATypeFilter< vector< Residue >::const_iterator > filter;
+  set< Contact > result;
+
+  Algo::extractContacts (contacts, residues.begin (), residues.end (), filter, cutoff, Algo::grid_engine);
+  for (it = contacts.begin (); contacts.end () != it; ++it)
+    if (tracked[it->first - residues.begin ()] && tracked[it->second - residues.begin ()])
+      result.insert (normalize (make_pair (&*it->first, &*it->second)));
+  return result;
+}
+
+
+/**
+ * Applies reported contact changes to a contact set.
+ * @return the number of changes that do not apply.
+ */
+static unsigned int
+apply (set< Contact > &current, const vector< Contact > &added, const vector< Contact > &removed)
+{
+  vector< Contact >::const_iterator it;
+  unsigned int errors = 0;
+
+  for (it = removed.begin (); removed.end () != it; ++it)
+    if (0 == current.erase (normalize (*it)))
+      ++errors;
+  for (it = added.begin (); added.end () != it; ++it)
+    if (! current.insert (normalize (*it)).second)
+      ++errors;
+  return errors;
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+  GraphModel::const_iterator mIt;
+  vector< Residue > residues;
+  float cutoff = 3.0;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  for (mIt = model.begin (); model.end () != mIt; ++mIt)
+    if (mIt->getType ()->isNucleicAcid () || mIt->getType ()->isAminoAcid ())
+      residues.push_back (*mIt);
+
+  ContactTracker tracker (cutoff, 6.0);
+  vector< bool > tracked (residues.size (), true);
+  vector< Contact > added;
+  vector< Contact > removed;
+  set< Contact > current;
+  set< Contact > expected;
+  unsigned int errors = 0;
+  unsigned int moves = 0;
+  unsigned int erasures = 0;
+  unsigned int insertions = 0;
+  unsigned int step;
+  unsigned int i;
+
+  for (i = 0; i < residues.size (); ++i)
+    tracker.insert (residues[i], added);
+  errors += apply (current, added, removed);
+  expected = extract (residues, tracked, cutoff);
+  gOut (0) << "Residues: " << tracker.size ()
+	   << " Contacts: " << tracker.contactSize () << endl;
+  gOut (0) << "inserted: " << (current == expected ? "same" : "different")
+	   << " as extractContacts" << endl;
+
+  // -- moves, erasures and reinsertions, each checked against a full
+  //    extraction
+  for (step = 0; step < 600; ++step)
+    {
+      set< Contact > before (expected);
+      set< Contact > gained;
+      set< Contact > lost;
+
+      i = (step * 37) % residues.size ();
+      added.clear ();
+      removed.clear ();
+      if (! tracked[i])
+	{
+	  tracker.insert (residues[i], added);
+	  tracked[i] = true;
+	  ++insertions;
+	}
+      else if (0 == step % 9)
+	{
+	  tracker.erase (residues[i], removed);
+	  tracked[i] = false;
+	  ++erasures;
+	}
+      else
+	{
+	  float dx = (float) (step % 11) - 5.0f;
+	  float dy = (float) (step % 7) - 3.0f;
+	  float dz = (float) (step % 5) - 2.0f;
+
+	  residues[i].transform (HomogeneousTransfo::translation (dx / 2, dy / 2, dz / 2));
+	  tracker.move (residues[i], added, removed);
+	  ++moves;
+	}
+
+      errors += apply (current, added, removed);
+      expected = extract (residues, tracked, cutoff);
+      set_difference (expected.begin (), expected.end (), before.begin (), before.end (),
+		      inserter (gained, gained.begin ()));
+      set_difference (before.begin (), before.end (), expected.begin (), expected.end (),
+		      inserter (lost, lost.begin ()));
+      if (current != expected
+	  || gained.size () != added.size ()
+	  || lost.size () != removed.size ()
+	  || expected.size () != tracker.contactSize ())
+	++errors;
+    }
+  gOut (0) << "moves: " << moves << " erasures: " << erasures
+	   << " insertions: " << insertions << endl;
+  gOut (0) << "changes: " << errors << " errors" << endl;
+
+  // -- a residue without atom has no contact
+  Residue empty (residues.front ().getType (), ResId ('Z', 1));
+
+  added.clear ();
+  tracker.insert (empty, added);
+  gOut (0) << "empty residue: " << added.size () << " contacts" << endl;
+
+  try
+    {
+      tracker.move (Residue (empty), added, removed);
+      gOut (0) << "unknown residue moved" << endl;
+    }
+  catch (NoSuchElementException &ex)
+    {
+      gOut (0) << "unknown residue rejected" << endl;
+    }
+
+  return EXIT_SUCCESS;
+}
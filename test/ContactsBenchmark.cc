@@ -0,0 +1,280 @@
+//                              -*- Mode: C++ -*-
+// ContactsBenchmark.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cstdlib>
+#include <iostream>
+#include <sys/time.h>
+#include <vector>
+
+#include "Algo.h"
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "ResId.h"
+#include "Residue.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Largest model on which the sweep engine is timed.
+ */
+static const unsigned int SWEEP_LIMIT = 10000;
+
+
+static double
+milliseconds ()
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, 0);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+
+/**
+ * Builds a model of n residues by tiling translated copies of the source
+ * residues on a cubic lattice.
+ */
+static void
+tile (vector< Residue > &model, const vector< Residue > &source, unsigned int n, float spacing)
+{
+  unsigned int side = 1;
+  unsigned int c;
+
+  while (side * side * side * source.size () < n)
+    ++side;
+
+  model.clear ();
+  model.reserve (n);
+  for (c = 0; model.size () < n; ++c)
+    {
+      HomogeneousTransfo t = HomogeneousTransfo::translation (spacing * (c % side),
+							       spacing * (c / side % side),
+							       spacing * (c / side / side));
+      vector< Residue >::const_iterator it;
+
+      for (it = source.begin (); source.end () != it && model.size () < n; ++it)
+	{
+	  model.push_back (*it);
+	  model.back ().transform (t);
+	  model.back ().setResId (ResId ('A', model.size ()));
+	}
+    }
+}
+
+
+
+/**
+ * Runs an untimed extraction, so that the first engine timed is not
+ * charged for filling the residues' bounding box caches.
+ */
+static void
+warm (vector< Residue > &model)
+{
+  vector< pair< vector< Residue >::iterator, vector< Residue >::iterator > > contacts;
+  RDATypeFilter< vector< Residue >::iterator > filter;
+
+  Algo::extractContacts (contacts, model.begin (), model.end (), filter, 3.0, Algo::grid_engine);
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel pdb;
+  vector< Residue > source;
+  float spacing = 0;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> pdb;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  const GraphModel &cpdb = pdb;
+  GraphModel::const_iterator cit;
+  float lower[3] = { 1e30f, 1e30f, 1e30f };
+  float upper[3] = { -1e30f, -1e30f, -1e30f };
+
+  for (cit = cpdb.begin (); cpdb.end () != cit; ++cit)
+    if (cit->getType ()->isNucleicAcid () || cit->getType ()->isAminoAcid ())
+      {
+	Residue::const_iterator ait;
+
+	source.push_back (*cit);
+	for (ait = cit->begin (); cit->end () != ait; ++ait)
+	  {
+	    float xyz[3] = { ait->getX (), ait->getY (), ait->getZ () };
+
+	    for (unsigned int k = 0; k < 3; ++k)
+	      {
+		lower[k] = min (lower[k], xyz[k]);
+		upper[k] = max (upper[k], xyz[k]);
+	      }
+	  }
+      }
+  for (unsigned int k = 0; k < 3; ++k)
+    spacing = max (spacing, upper[k] - lower[k] + 10);
+
+  gOut (0) << "residues\tcontacts\tsweep (ms)\tgrid (ms)\tthreaded (ms)\trefined\trefine (ms)" << endl;
+  for (unsigned int n = 100; n <= 100000; n *= 10)
+    {
+      vector< Residue > model;
+      vector< pair< vector< Residue >::iterator, vector< Residue >::iterator > > sweep;
+      vector< pair< vector< Residue >::iterator, vector< Residue >::iterator > > grid;
+      vector< pair< vector< Residue >::iterator, vector< Residue >::iterator > > threaded;
+      RDATypeFilter< vector< Residue >::iterator > filter;
+      double t;
+      double sweepms = -1;
+      double gridms;
+      double threadedms;
+      double refinems;
+
+      tile (model, source, n, spacing);
+      warm (model);
+
+      t = milliseconds ();
+      Algo::extractContacts (grid, model.begin (), model.end (), filter, 3.0, Algo::grid_engine);
+      gridms = milliseconds () - t;
+
+      t = milliseconds ();
+      Algo::extractContacts (threaded, model.begin (), model.end (), filter, 3.0, Algo::grid_engine, 0);
+      threadedms = milliseconds () - t;
+
+      // -- the sweep map nodes freed afterwards would slow down the
+      //    allocations of the engines timed next
+      if (n <= SWEEP_LIMIT)
+	{
+	  t = milliseconds ();
+	  Algo::extractContacts (sweep, model.begin (), model.end (), filter, 3.0, Algo::sweep_engine);
+	  sweepms = milliseconds () - t;
+	}
+
+      if ((n <= SWEEP_LIMIT && sweep != grid) || threaded != grid)
+	{
+	  gErr (0) << argv[0] << ": engines disagree on " << n << " residues" << endl;
+	  return EXIT_FAILURE;
+	}
+
+      gOut (0) << n << "\t" << grid.size () << "\t";
+      if (0 <= sweepms)
+	gOut (0) << sweepms;
+      else
+	gOut (0) << "-";
+
+      t = milliseconds ();
+      Algo::refineContacts (grid, 3.0);
+      refinems = milliseconds () - t;
+
+      gOut (0) << "\t" << gridms << "\t" << threadedms << "\t" << grid.size () << "\t" << refinems << endl;
+    }
+
+  // -- many small models
+  vector< Residue > models;
+  vector< pair< vector< Residue >::iterator, vector< Residue >::iterator > > ranges;
+  vector< vector< pair< vector< Residue >::iterator, vector< Residue >::iterator > > > sequential;
+  vector< vector< pair< vector< Residue >::iterator, vector< Residue >::iterator > > > threaded;
+  RDATypeFilter< vector< Residue >::iterator > filter;
+  double t;
+  double sequentialms;
+  double threadedms;
+
+  tile (models, source, 100000, spacing);
+  warm (models);
+  for (unsigned int i = 0; i < models.size (); i += 1000)
+    ranges.push_back (make_pair (models.begin () + i, models.begin () + min (i + 1000, (unsigned int) models.size ())));
+
+  t = milliseconds ();
+  Algo::extractContacts (sequential, ranges, filter, 3.0, Algo::grid_engine, 1);
+  sequentialms = milliseconds () - t;
+
+  t = milliseconds ();
+  Algo::extractContacts (threaded, ranges, filter, 3.0, Algo::grid_engine, 0);
+  threadedms = milliseconds () - t;
+
+  if (sequential != threaded)
+    {
+      gErr (0) << argv[0] << ": threaded models disagree" << endl;
+      return EXIT_FAILURE;
+    }
+
+  gOut (0) << endl
+	   << "models\tsequential (ms)\tthreaded (ms)" << endl
+	   << ranges.size () << "\t" << sequentialms << "\t" << threadedms << endl;
+
+  // -- residue distance matrix
+  SymmetricalMatrix< float > sequentialMatrix;
+  SymmetricalMatrix< float > threadedMatrix;
+  vector< pair< pair< unsigned int, unsigned int >, float > > sparse;
+  double sparsems;
+
+  warm (source);
+  t = milliseconds ();
+  Algo::distanceMatrix (sequentialMatrix, source.begin (), source.end (), Algo::minimum_distance, 1);
+  sequentialms = milliseconds () - t;
+
+  t = milliseconds ();
+  Algo::distanceMatrix (threadedMatrix, source.begin (), source.end (), Algo::minimum_distance, 0);
+  threadedms = milliseconds () - t;
+
+  t = milliseconds ();
+  Algo::distanceMatrix (sparse, source.begin (), source.end (), 3.0, Algo::minimum_distance, 0);
+  sparsems = milliseconds () - t;
+
+  for (int i = 0; i < sequentialMatrix.size (1); ++i)
+    if (sequentialMatrix[i] != threadedMatrix[i])
+      {
+	gErr (0) << argv[0] << ": threaded distance matrix disagrees" << endl;
+	return EXIT_FAILURE;
+      }
+
+  gOut (0) << endl
+	   << "matrix\tsequential (ms)\tthreaded (ms)\twithin 3.0\tsparse (ms)" << endl
+	   << source.size () << "\t" << sequentialms << "\t" << threadedms << "\t"
+	   << sparse.size () << "\t" << sparsems << endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,254 @@
+//                              -*- Mode: C++ -*-
+// DistanceMatrix.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "Algo.h"
+#include "Atom.h"
+#include "GraphModel.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Residue.h"
+#include "SymmetricalMatrix.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+typedef vector< pair< pair< unsigned int, unsigned int >, float > > Sparse;
+
+
+
+/**
+ * Gets the atoms of residues, pseudo-atoms excluded.
+ */
+static vector< vector< Vector3D > >
+atoms (const vector< Residue > &residues)
+{
+  vector< vector< Vector3D > > result (residues.size ());
+  unsigned int n;
+
+  for (n = 0; n < residues.size (); ++n)
+    {
+      Residue::const_iterator it;
+
+      for (it = residues[n].begin (); residues[n].end () != it; ++it)
+	if (! it->getType ()->isPseudo ())
+	  result[n].push_back (*it);
+    }
+  return result;
+}
+
+
+/**
+ * Computes the distance between the closest atoms of two residues by
+ * testing every atom pair.
+ */
+static float
+minimumDistance (const vector< Vector3D > &a, const vector< Vector3D > &b)
+{
+  float best = numeric_limits< float >::max ();
+  unsigned int i;
+  unsigned int j;
+
+  for (i = 0; i < a.size (); ++i)
+    for (j = 0; j < b.size (); ++j)
+      best = min (best, a[i].distance (b[j]));
+  return best;
+}
+
+
+/**
+ * Computes the centroid of atoms.
+ */
+static Vector3D
+centroid (const vector< Vector3D > &a)
+{
+  Vector3D sum;
+  unsigned int i;
+
+  for (i = 0; i < a.size (); ++i)
+    sum += a[i];
+  return sum / a.size ();
+}
+
+
+/**
+ * Compares a distance matrix with the distances of every residue pair.
+ * @return the number of distances that differ by more than tolerance.
+ */
+static unsigned int
+compare (const SymmetricalMatrix< float > &matrix, const vector< vector< Vector3D > > &residues, unsigned char measure, float tolerance)
+{
+  unsigned int errors = 0;
+  unsigned int i;
+  unsigned int j;
+
+  for (i = 0; i < residues.size (); ++i)
+    for (j = i + 1; j < residues.size (); ++j)
+      {
+	float expected;
+
+	if (residues[i].empty () || residues[j].empty ())
+	  expected = numeric_limits< float >::max ();
+	else if (Algo::centroid_distance == measure)
+	  expected = centroid (residues[i]).distance (centroid (residues[j]));
+	else
+	  expected = minimumDistance (residues[i], residues[j]);
+	if (fabs (matrix (i, j) - expected) > tolerance
+	    || matrix (i, j) != matrix (j, i))
+	  ++errors;
+      }
+  return errors;
+}
+
+
+/**
+ * Tells whether two matrices hold the same distances.
+ */
+static bool
+same (const SymmetricalMatrix< float > &a, const SymmetricalMatrix< float > &b, unsigned int n)
+{
+  unsigned int i;
+  unsigned int j;
+
+  for (i = 0; i < n; ++i)
+    for (j = i + 1; j < n; ++j)
+      if (a (i, j) != b (i, j))
+	return false;
+  return true;
+}
+
+
+/**
+ * Gets the pairs of a matrix within cutoff, as the sparse overload
+ * reports them.
+ */
+static Sparse
+within (const SymmetricalMatrix< float > &matrix, unsigned int n, float cutoff)
+{
+  Sparse result;
+  unsigned int i;
+  unsigned int j;
+
+  for (i = 0; i < n; ++i)
+    for (j = i + 1; j < n; ++j)
+      if (matrix (i, j) <= cutoff)
+	result.push_back (make_pair (make_pair (i, j), matrix (i, j)));
+  return result;
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  const GraphModel &cmodel = model;
+  GraphModel::const_iterator it;
+  vector< Residue > residues;
+
+  // -- plain copies of the residues, and one without atoms
+  for (it = cmodel.begin (); cmodel.end () != it; ++it)
+    {
+      Residue res (it->getType (), it->getResId ());
+      Residue::const_iterator aIt;
+
+      for (aIt = it->begin (); it->end () != aIt; ++aIt)
+	res.insert (*aIt);
+      residues.push_back (res);
+    }
+  residues.insert (residues.begin () + 100, Residue (residues.front ().getType (), ResId ('Z', 1)));
+
+  unsigned char measures[] = { Algo::minimum_distance, Algo::centroid_distance };
+  const char *names[] = { "minimum", "centroid" };
+  float cutoffs[] = { 3.0, 8.0 };
+  float tolerances[] = { 1e-5, 1e-3 };
+  vector< vector< Vector3D > > scanned = atoms (residues);
+  unsigned int n = residues.size ();
+  unsigned int m;
+
+  gOut (0) << "Residues: " << n << endl;
+  for (m = 0; m < 2; ++m)
+    {
+      SymmetricalMatrix< float > sequential;
+      SymmetricalMatrix< float > threaded;
+      Sparse sparse;
+      Sparse sparseThreaded;
+      Sparse expected;
+
+      Algo::distanceMatrix (sequential, residues.begin (), residues.end (), measures[m], 1);
+      Algo::distanceMatrix (threaded, residues.begin (), residues.end (), measures[m], 4);
+      Algo::distanceMatrix (sparse, residues.begin (), residues.end (), cutoffs[m], measures[m], 1);
+      Algo::distanceMatrix (sparseThreaded, residues.begin (), residues.end (), cutoffs[m], measures[m], 4);
+      expected = within (sequential, n, cutoffs[m]);
+
+      gOut (0) << names[m] << ": " << compare (sequential, scanned, measures[m], tolerances[m])
+	       << " distances differ from the scan, threaded "
+	       << (same (sequential, threaded, n) ? "same" : "different") << endl
+	       << "  within " << cutoffs[m] << ": " << expected.size () << " pairs, sparse "
+	       << (sparse == expected ? "same" : "different") << ", threaded "
+	       << (sparseThreaded == expected ? "same" : "different") << endl;
+    }
+
+  // -- a pair at the cutoff is reported
+  Sparse atCutoff;
+  SymmetricalMatrix< float > matrix;
+
+  Algo::distanceMatrix (matrix, residues.begin (), residues.end ());
+  Algo::distanceMatrix (atCutoff, residues.begin (), residues.end (), matrix (0, 1));
+  gOut (0) << "cutoff at the first pair distance: "
+	   << (atCutoff == within (matrix, n, matrix (0, 1)) ? "same" : "different")
+	   << " as the matrix" << endl;
+
+  return EXIT_SUCCESS;
+}
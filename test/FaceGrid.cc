@@ -0,0 +1,217 @@
+//                              -*- Mode: C++ -*-
+// FaceGrid.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "ExtendedResidue.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "PropertyType.h"
+#include "Relation.h"
+#include "ResidueType.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+typedef vector< pair< Vector3D, const PropertyType* > > Faces;
+
+
+
+/**
+ * Gives access to the face lookup and to the face tables.
+ */
+class FaceLookup : public Relation
+{
+public:
+  using Relation::getFace;
+  using Relation::init;
+
+  static const Faces& faces (unsigned int base)
+  {
+    const Faces *tables[] = { &faces_A, &faces_C, &faces_G, &faces_U, &faces_T };
+
+    return *tables[base];
+  }
+};
+
+
+/**
+ * Finds the closest face by scanning every face, the first one of equal
+ * distances kept.
+ */
+static const PropertyType*
+scan (const Faces &faces, const Vector3D &p)
+{
+  unsigned int face_index = 0;
+  float dist = numeric_limits< float >::max ();
+  unsigned int k;
+
+  for (k = 0; k < faces.size (); ++k)
+    {
+      float tmp = p.distance (faces[k].first);
+
+      if (tmp < dist)
+	{
+	  face_index = k;
+	  dist = tmp;
+	}
+    }
+  return faces[face_index].second;
+}
+
+
+/**
+ * Compares the face of a point given in the base's local referential with
+ * the scan.
+ * @return whether they agree.
+ */
+static bool
+agree (const Residue &res, const Faces &faces, const Vector3D &local)
+{
+  Vector3D p = res.getReferential () * local;
+
+  return FaceLookup::getFace (&res, p) == scan (faces, res.getReferentialInverse () * p);
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  const ResidueType *types[] = { ResidueType::rRA, ResidueType::rRC, ResidueType::rRG,
+				 ResidueType::rRU, ResidueType::rDT };
+  const char *names[] = { "A", "C", "G", "U", "T" };
+  HomogeneousTransfo tfo = (HomogeneousTransfo::translation (12.0, -7.5, 3.25)
+			    * HomogeneousTransfo::rotation (Vector3D (1, 2, -1), 1.1));
+  unsigned int base;
+
+  try
+    {
+      FaceLookup::init ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  for (base = 0; base < 5; ++base)
+    {
+      const Faces &faces = FaceLookup::faces (base);
+      ExtendedResidue res (types[base], ResId ('A', 1));
+      float lower[3];
+      float upper[3];
+      int dim[3];
+      unsigned int inside = 0;
+      unsigned int boundaries = 0;
+      unsigned int outside = 0;
+      unsigned int mismatches = 0;
+      unsigned int k;
+      int d;
+      int x, y, z;
+
+      res.setTheoretical ();
+      res.transform (tfo);
+
+      // -- the grid spans the faces with a 3 Angstroms margin in 1
+      //    Angstrom cells
+      for (d = 0; d < 3; ++d)
+	{
+	  lower[d] = numeric_limits< float >::max ();
+	  upper[d] = -numeric_limits< float >::max ();
+	}
+      for (k = 0; k < faces.size (); ++k)
+	{
+	  float c[3] = { faces[k].first.getX (), faces[k].first.getY (), faces[k].first.getZ () };
+
+	  for (d = 0; d < 3; ++d)
+	    {
+	      lower[d] = min (lower[d], c[d] - 3.0f);
+	      upper[d] = max (upper[d], c[d] + 3.0f);
+	    }
+	}
+      for (d = 0; d < 3; ++d)
+	dim[d] = (int) ceil (upper[d] - lower[d]);
+
+      for (x = 0; x < dim[0]; ++x)
+	for (y = 0; y < dim[1]; ++y)
+	  for (z = 0; z < dim[2]; ++z)
+	    {
+	      Vector3D corner (lower[0] + x, lower[1] + y, lower[2] + z);
+
+	      // -- points inside the cell
+	      for (k = 0; k < 3; ++k)
+		{
+		  Vector3D offset (0.15 + 0.35 * k, 0.8 - 0.3 * k, 0.5 + 0.2 * (k % 2));
+
+		  mismatches += agree (res, faces, corner + offset) ? 0 : 1;
+		  ++inside;
+		}
+
+	      // -- points on the cell's lower corner and faces, and just
+	      //    around them
+	      for (k = 0; k < 3; ++k)
+		{
+		  float e = (float) k - 1.0f;
+
+		  mismatches += agree (res, faces, corner + Vector3D (e * 1e-4f, e * 1e-4f, e * 1e-4f)) ? 0 : 1;
+		  mismatches += agree (res, faces, corner + Vector3D (e * 1e-4f, 0.5, 0.5)) ? 0 : 1;
+		  mismatches += agree (res, faces, corner + Vector3D (0.5, e * 1e-4f, 0.5)) ? 0 : 1;
+		  mismatches += agree (res, faces, corner + Vector3D (0.5, 0.5, e * 1e-4f)) ? 0 : 1;
+		  boundaries += 4;
+		}
+	    }
+
+      // -- points past each side of the grid
+      for (k = 0; k < 200; ++k)
+	{
+	  float t = k / 200.0f;
+	  float past = 0.5 + k % 7;
+	  Vector3D span (lower[0] + t * (upper[0] - lower[0]),
+			 lower[1] + (1 - t) * (upper[1] - lower[1]),
+			 lower[2] + t * (upper[2] - lower[2]));
+
+	  mismatches += agree (res, faces, Vector3D (lower[0] - past, span.getY (), span.getZ ())) ? 0 : 1;
+	  mismatches += agree (res, faces, Vector3D (upper[0] + past, span.getY (), span.getZ ())) ? 0 : 1;
+	  mismatches += agree (res, faces, Vector3D (span.getX (), lower[1] - past, span.getZ ())) ? 0 : 1;
+	  mismatches += agree (res, faces, Vector3D (span.getX (), upper[1] + past, span.getZ ())) ? 0 : 1;
+	  mismatches += agree (res, faces, Vector3D (span.getX (), span.getY (), lower[2] - past)) ? 0 : 1;
+	  mismatches += agree (res, faces, Vector3D (span.getX (), span.getY (), upper[2] + past)) ? 0 : 1;
+	  outside += 6;
+	}
+
+      gOut (0) << names[base] << ": " << faces.size () << " faces, "
+	       << inside << " inside, " << boundaries << " on boundaries, "
+	       << outside << " outside, " << mismatches << " mismatches" << endl;
+    }
+
+  return EXIT_SUCCESS;
+}
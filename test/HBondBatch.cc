@@ -0,0 +1,191 @@
+//                              -*- Mode: C++ -*-
+// HBondBatch.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "Algo.h"
+#include "Atom.h"
+#include "AtomType.h"
+#include "GraphModel.h"
+#include "HBond.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+typedef vector< pair< const Atom*, const Atom* > > AtomCouples;
+
+
+
+/**
+ * The pairing H-bond candidates of residue pairs, as Relation::arePaired
+ * gathers them: the donor and acceptor residues, the atoms and their
+ * positions.
+ */
+struct Candidates
+{
+  vector< HBond > hbonds;
+  vector< pair< const Residue*, const Residue* > > residues;
+  vector< Vector3D > donors;
+  vector< Vector3D > hydrogens;
+  vector< Vector3D > acceptors;
+  vector< Vector3D > lonepairs;
+
+  void add (const Residue &rd, const Atom &d, const Atom &h,
+	    const Residue &ra, const Atom &a, const Atom &l)
+  {
+    // -- the hydrogen of a methyl donor is placed by the evaluation
+    if (AtomType::aC5M == d.getType ())
+      return;
+    hbonds.push_back (HBond (d.getType (), h.getType (), a.getType (), l.getType ()));
+    residues.push_back (make_pair (&rd, &ra));
+    donors.push_back (d);
+    hydrogens.push_back (h);
+    acceptors.push_back (a);
+    lonepairs.push_back (l);
+  }
+
+  void add (const Residue &ra, const Residue &rb)
+  {
+    const AtomCouples &ca = ra.getHBondCouples ();
+    const AtomCouples &cb = rb.getHBondCouples ();
+    AtomCouples::const_iterator x;
+    AtomCouples::const_iterator y;
+
+    for (x = ca.begin (); ca.end () != x; ++x)
+      for (y = cb.begin (); cb.end () != y; ++y)
+	if (x->second->getType ()->isHydrogen () && y->second->getType ()->isLonePair ())
+	  add (ra, *x->first, *x->second, rb, *y->first, *y->second);
+	else if (y->second->getType ()->isHydrogen () && x->second->getType ()->isLonePair ())
+	  add (rb, *y->first, *y->second, ra, *x->first, *x->second);
+  }
+};
+
+
+/**
+ * Compares the batched evaluation of candidates with the scalar one.
+ * @return the number of values that differ.
+ */
+static unsigned int
+compare (Candidates &cands, unsigned int &inrange, unsigned int &formed)
+{
+  vector< float > values;
+  unsigned int errors = 0;
+  unsigned int c;
+
+  HBond::evalStatistically (cands.donors, cands.hydrogens, cands.acceptors, cands.lonepairs, values);
+  if (values.size () != cands.hbonds.size ())
+    return cands.hbonds.size () + 1;
+  for (c = 0; c < values.size (); ++c)
+    {
+      float scalar = cands.hbonds[c].evalStatistically (cands.residues[c].first, cands.residues[c].second);
+
+      if (values[c] != scalar)
+	++errors;
+      if (0 != scalar)
+	++inrange;
+      if (0.01 < scalar)
+	++formed;
+    }
+  return errors;
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  model.addHLP ();
+
+  const GraphModel &cmodel = model;
+  vector< pair< GraphModel::const_iterator, GraphModel::const_iterator > > contacts;
+  vector< pair< GraphModel::const_iterator, GraphModel::const_iterator > >::iterator it;
+  RDATypeFilter< GraphModel::const_iterator > filter;
+  Candidates all;
+  Candidates single;
+  unsigned int inrange = 0;
+  unsigned int formed = 0;
+  unsigned int errors;
+  unsigned int largest = 0;
+
+  // -- every candidate of the contacts at once, over several blocks, and
+  //    the candidates of each contact apart
+  Algo::extractContacts (contacts, cmodel.begin (), cmodel.end (), filter, 3.0, Algo::grid_engine);
+  for (it = contacts.begin (); contacts.end () != it; ++it)
+    all.add (*it->first, *it->second);
+  errors = compare (all, inrange, formed);
+  gOut (0) << "Contacts: " << contacts.size ()
+	   << " candidates: " << all.hbonds.size ()
+	   << " in range: " << inrange
+	   << " formed: " << formed << endl;
+  gOut (0) << "batch: " << errors << " differences" << endl;
+
+  errors = 0;
+  for (it = contacts.begin (); contacts.end () != it; ++it)
+    {
+      Candidates cands;
+      unsigned int ignored = 0;
+
+      cands.add (*it->first, *it->second);
+      errors += compare (cands, ignored, ignored);
+      largest = max (largest, (unsigned int) cands.hbonds.size ());
+    }
+  gOut (0) << "per contact: " << errors << " differences, "
+	   << (64 < largest ? "some" : "no") << " contact over one block" << endl;
+
+  // -- an empty batch
+  errors = compare (single, inrange, formed);
+  gOut (0) << "empty: " << errors << " differences" << endl;
+
+  return EXIT_SUCCESS;
+}
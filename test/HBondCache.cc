@@ -0,0 +1,201 @@
+//                              -*- Mode: C++ -*-
+// HBondCache.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "Atom.h"
+#include "AtomType.h"
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Residue.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Copies the atoms of a residue in a new plain residue, with no cache.
+ */
+static Residue
+plain (const Residue &res)
+{
+  Residue copy (res.getType (), res.getResId ());
+  Residue::const_iterator it;
+
+  for (it = res.begin (); res.end () != it; ++it)
+    copy.insert (*it);
+  return copy;
+}
+
+
+/**
+ * Tells whether two atoms have the same type and position.
+ */
+static bool
+same (const Atom *a, const Atom *b)
+{
+  return a->getType () == b->getType () && *a == *b;
+}
+
+
+/**
+ * Tells whether the cached H-bond candidates of a residue are the ones
+ * found anew on a copy of its atoms, and within its H-bond sphere.
+ */
+static bool
+fresh (const Residue &res)
+{
+  Residue copy = plain (res);
+  const vector< pair< const Atom*, const Atom* > > &couples = res.getHBondCouples ();
+  const vector< pair< const Atom*, const Atom* > > &expected = copy.getHBondCouples ();
+  const vector< const Atom* > &atoms = res.getBHBondAtoms ();
+  const vector< const Atom* > &expectedAtoms = copy.getBHBondAtoms ();
+  Vector3D center;
+  float radius;
+  unsigned int n;
+
+  if (couples.size () != expected.size () || atoms.size () != expectedAtoms.size ())
+    return false;
+  res.getHBondSphere (center, radius);
+  for (n = 0; n < couples.size (); ++n)
+    if (! same (couples[n].first, expected[n].first)
+	|| ! same (couples[n].second, expected[n].second)
+	|| couples[n].first->distance (center) > radius
+	|| couples[n].second->distance (center) > radius)
+      return false;
+  for (n = 0; n < atoms.size (); ++n)
+    if (! same (atoms[n], expectedAtoms[n]))
+      return false;
+  return true;
+}
+
+
+/**
+ * Prints the cache statistics since the last call, then resets them.
+ */
+static void
+requests (const char *what)
+{
+  gOut (0) << what << ": " << Residue::getHBondCacheMisses () << " scans, "
+	   << Residue::getHBondCacheHits () << " reuses" << endl;
+  Residue::resetHBondCacheStats ();
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  const GraphModel &cmodel = model;
+  GraphModel::const_iterator it;
+  unsigned int wrong = 0;
+  unsigned long scans;
+  unsigned long reuses;
+
+  // -- annotate re-adds the H and LP atoms, so each residue scans its atoms
+  //    once per annotation and every other relation reuses the candidates
+  Residue::resetHBondCacheStats ();
+  model.annotate ();
+  requests ("first annotation");
+  model.reannotate ();
+  scans = Residue::getHBondCacheMisses ();
+  reuses = Residue::getHBondCacheHits ();
+  requests ("second annotation");
+  gOut (0) << "reuse ratio: " << 100 * reuses / (scans + reuses) << "%, "
+	   << (scans <= model.size () ? "each residue scanned once" : "residues scanned again")
+	   << endl;
+
+  for (it = cmodel.begin (); cmodel.end () != it; ++it)
+    if (! fresh (*it))
+      ++wrong;
+  gOut (0) << "cached candidates: " << wrong << " residues differ" << endl;
+
+  // -- moved or modified residues scan their atoms again
+  HomogeneousTransfo tfo = (HomogeneousTransfo::translation (3.0, -2.0, 1.0)
+			    * HomogeneousTransfo::rotation (Vector3D (0, 1, 1), 0.7));
+  Residue &res = *model.begin ();
+  Residue copy = plain (res);
+  Residue *residues[] = { &copy, &res };
+  const char *names[] = { "plain", "extended" };
+  unsigned int r;
+
+  for (r = 0; r < 2; ++r)
+    {
+      Residue &moved = *residues[r];
+      const Residue &cmoved = moved;
+      Vector3D before;
+
+      gOut (0) << names[r] << ":" << endl;
+      cmoved.getHBondCouples ();
+      Residue::resetHBondCacheStats ();
+      cmoved.getHBondCouples ();
+      cmoved.getBHBondAtoms ();
+      requests ("  unchanged");
+      before = *cmoved.getHBondCouples ().front ().first;
+      moved.transform (tfo);
+      cmoved.getHBondCouples ();
+      cmoved.getBHBondAtoms ();
+      requests ("  after transform");
+      gOut (0) << "  moved candidates: "
+	       << (fresh (cmoved) && !(before == *cmoved.getHBondCouples ().front ().first)
+		   ? "rescanned" : "stale") << endl;
+      Residue::resetHBondCacheStats ();
+      moved.erase (cmoved.getHBondCouples ().front ().second->getType ());
+      gOut (0) << "  after erase: " << (fresh (cmoved) ? "rescanned" : "stale") << endl;
+    }
+  Residue::resetHBondCacheStats ();
+  requests ("reset");
+
+  return EXIT_SUCCESS;
+}
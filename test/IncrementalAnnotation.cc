@@ -0,0 +1,208 @@
+//                              -*- Mode: C++ -*-
+// IncrementalAnnotation.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Relation.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Prints the edges sorted, to compare annotations whose edge orders
+ * differ.
+ */
+static string
+edges (const GraphModel &model)
+{
+  vector< string > lines;
+  GraphModel::edge_size_type label;
+  string result;
+
+  for (label = 0; label < model.edgeSize (); ++label)
+    {
+      const Relation *rel = model.internalGetEdge (label);
+      ostringstream oss;
+
+      oss << rel->getRef ()->getResId () << " " << rel->getRes ()->getResId () << " ";
+      rel->write (oss);
+      lines.push_back (oss.str ());
+    }
+  sort (lines.begin (), lines.end ());
+  for (label = 0; label < lines.size (); ++label)
+    result += lines[label] + "\n";
+  return result;
+}
+
+
+/**
+ * Tells whether each relation is found from its residues.
+ */
+static bool
+consistent (const GraphModel &model)
+{
+  GraphModel::edge_size_type label;
+
+  for (label = 0; label < model.edgeSize (); ++label)
+    {
+      const Relation *rel = model.internalGetEdge (label);
+      GraphModel::label ref = model.getVertexLabel (const_cast< Residue* > (rel->getRef ()));
+      GraphModel::label res = model.getVertexLabel (const_cast< Residue* > (rel->getRes ()));
+
+      if (! model.internalAreConnected (ref, res)
+	  || model.internalGetEdge (ref, res) != rel)
+	return false;
+    }
+  return true;
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+  GraphModel::iterator it;
+  unsigned int n;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  unsigned long tested;
+
+  Relation::resetPairingStats ();
+  model.annotate ();
+  tested = Relation::getPairingTested ();
+  gOut (0) << "Size: " << model.size ()
+	   << " Edge size: " << model.edgeSize () << endl;
+
+  // -- the threads find the relations of one thread and count the same
+  //    pairing tests
+  GraphModel threaded (model);
+
+  Relation::resetPairingStats ();
+  threaded.reannotate (Relation::adjacent_mask | Relation::pairing_mask | Relation::stacking_mask | Relation::bhbond_mask, 4);
+  gOut (0) << "threaded: " << (edges (threaded) == edges (model) ? "same" : "different")
+	   << " as the sequential annotation, "
+	   << (Relation::getPairingTested () == tested ? "same" : "different")
+	   << " pairing tests" << endl;
+
+  // -- an unmoved residue gets its relations back
+  string reference = edges (model);
+
+  model.markDirty (*model.begin ());
+  model.annotateDirty ();
+  gOut (0) << "unmoved: " << (edges (model) == reference ? "unchanged" : "changed") << endl;
+
+  // -- a few moved residues are reannotated as the whole model
+  HomogeneousTransfo tfo = (HomogeneousTransfo::translation (0.5, -0.4, 0.2)
+			    * HomogeneousTransfo::rotation (Vector3D (1, 1, 0), 0.3));
+
+  for (it = model.begin (), n = 0; model.end () != it && n < 40; ++it, ++n)
+    if (0 == n % 10)
+      {
+	it->transform (tfo);
+	model.markDirty (*it);
+      }
+  model.annotateDirty ();
+
+  GraphModel full (model);
+
+  full.reannotate ();
+  gOut (0) << "moved: " << (edges (model) == reference ? "unchanged" : "changed")
+	   << ", " << (edges (model) == edges (full) ? "same" : "different")
+	   << " as the full annotation" << endl;
+
+  // -- successive rounds move residues out of and into contacts, an
+  //    erased residue takes its relations along
+  unsigned int round;
+  unsigned int differences = 0;
+  unsigned int inconsistencies = 0;
+
+  for (round = 0; round < 5; ++round)
+    {
+      for (it = model.begin (), n = 0; model.end () != it; ++it, ++n)
+	if (0 == (n + round * 7) % 37)
+	  {
+	    it->transform (HomogeneousTransfo::translation (0 == round % 2 ? 2.5 : -2.0, 1.0, round - 2.0));
+	    model.markDirty (*it);
+	  }
+      if (2 == round)
+	model.erase (model.begin () + 5);
+      model.annotateDirty ();
+
+      GraphModel again (model);
+
+      again.reannotate ();
+      if (edges (model) != edges (again))
+	++differences;
+      if (! consistent (model))
+	++inconsistencies;
+    }
+  gOut (0) << "rounds: " << round << ", " << differences << " differ from the full annotation, "
+	   << inconsistencies << " inconsistent" << endl;
+
+  try
+    {
+      model.markDirty (ResId ('Z', 9999));
+      gOut (0) << "unknown residue marked" << endl;
+    }
+  catch (NoSuchElementException &ex)
+    {
+      gOut (0) << "unknown residue rejected" << endl;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,193 @@
+//                              -*- Mode: C++ -*-
+// ModelCopy.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "AtomType.h"
+#include "ExtendedResidue.h"
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Model.h"
+#include "Molecule.h"
+#include "Pdbstream.h"
+#include "Relation.h"
+#include "ResidueFactoryMethod.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Number of dynamic allocations made by the program.
+ */
+static unsigned long allocations = 0;
+
+
+void*
+operator new (size_t size) throw (bad_alloc)
+{
+  void *p;
+
+  ++allocations;
+  if (0 == (p = malloc (0 == size ? 1 : size)))
+    throw bad_alloc ();
+  return p;
+}
+
+
+void
+operator delete (void *p) throw ()
+{
+  free (p);
+}
+
+
+static const char*
+yesno (bool b)
+{
+  return b ? "yes" : "no";
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+  unsigned long atoms = 0;
+  unsigned long count;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  const GraphModel &cmodel = model;
+  GraphModel::const_iterator cit;
+
+  for (cit = cmodel.begin (); cmodel.end () != cit; ++cit)
+    atoms += cit->size ();
+  gOut (0) << "Size: " << model.size () << endl;
+
+  // -- residue copies share their atoms
+  const Residue &first = *cmodel.begin ();
+
+  count = allocations;
+  ExtendedResidue copy (first);
+  gOut (0) << "residue copy allocates atoms: "
+	   << yesno (first.size () <= allocations - count) << endl
+	   << "residue copy shares atoms: " << yesno (copy.isShared ()) << endl;
+
+  copy.transform (HomogeneousTransfo::translation (1, 0, 0));
+  copy.place ();
+  gOut (0) << "modified copy shares atoms: " << yesno (copy.isShared ()) << endl
+	   << "original unchanged: "
+	   << yesno (copy.safeFind (AtomType::aC1p)->getX ()
+		     != first.safeFind (AtomType::aC1p)->getX ()) << endl;
+
+  // -- residue swap
+  ExtendedResidue other (first);
+
+  count = allocations;
+  other.swap (copy);
+  gOut (0) << "residue swap allocations: " << allocations - count << endl;
+
+  // -- model copies share their atoms
+  count = allocations;
+  Model mcopy (cmodel);
+  gOut (0) << "model copy allocates atoms: "
+	   << yesno (atoms <= allocations - count) << endl;
+
+  // -- model swap
+  Model mother;
+  GraphModel gother;
+
+  count = allocations;
+  mother.swap (mcopy);
+  gother.swap (model);
+  gOut (0) << "model swap allocations: " << allocations - count << endl
+	   << "Size after swap: " << mcopy.size () << " " << mother.size ()
+	   << " " << model.size () << " " << gother.size () << endl;
+
+  // -- insertion without copy
+  Residue *res = mother.getResidueFM ()->createResidue (first);
+
+  count = allocations;
+  mcopy.insert (res);
+  gOut (0) << "adopting insert allocates atoms: "
+	   << yesno (res->size () <= allocations - count) << endl
+	   << "inserted residue is the same object: "
+	   << yesno (&*mcopy.begin () == res) << endl;
+
+  // -- molecule insertion without copy
+  Molecule mol;
+  AbstractModel *mptr = new Model ();
+
+  static_cast< Model* > (mptr)->swap (mother);
+  count = allocations;
+  mol.insert (mptr);
+  gOut (0) << "molecule adopting insert allocates atoms: "
+	   << yesno (atoms <= allocations - count) << endl
+	   << "Molecule size: " << mol.size () << " " << mol.begin ()->size () << endl;
+
+  // -- relation swap
+  const GraphModel &cgother = gother;
+  const Residue *r1;
+
+  cit = cgother.begin ();
+  r1 = &*cit;
+  ++cit;
+
+  Relation rel (r1, &*cit);
+  Relation rother;
+
+  count = allocations;
+  rother.swap (rel);
+  gOut (0) << "relation swap allocations: " << allocations - count << endl
+	   << "relation swapped: " << yesno (0 == rel.getRef () && 0 != rother.getRef ()) << endl;
+
+  return EXIT_SUCCESS;
+}
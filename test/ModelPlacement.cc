@@ -0,0 +1,196 @@
+//                              -*- Mode: C++ -*-
+// ModelPlacement.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "Atom.h"
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Residue.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Gets the transfo applied to the nth residue.
+ */
+static HomogeneousTransfo
+motion (unsigned int n)
+{
+  return (HomogeneousTransfo::translation (n % 5 - 2.0, n % 3 - 1.0, n % 7 - 3.0)
+	  * HomogeneousTransfo::rotation (Vector3D (n % 2, 1, n % 3), 0.1 * (n % 11)));
+}
+
+
+/**
+ * Counts the residues of a model that are not placed.
+ */
+static unsigned int
+unplaced (const GraphModel &model)
+{
+  GraphModel::const_iterator it;
+  unsigned int count = 0;
+
+  for (it = model.begin (); model.end () != it; ++it)
+    if (! it->isPlaced ())
+      ++count;
+  return count;
+}
+
+
+/**
+ * Compares the atoms of a placed model with expected residues.
+ * @param tolerance the largest coordinate difference accepted.
+ * @return the number of atoms that differ.
+ */
+static unsigned int
+compare (const GraphModel &model, const vector< Residue > &expected, float tolerance)
+{
+  GraphModel::const_iterator it;
+  vector< Residue >::const_iterator eIt;
+  unsigned int errors = 0;
+
+  for (it = model.begin (), eIt = expected.begin (); model.end () != it; ++it, ++eIt)
+    {
+      Residue::const_iterator a;
+      Residue::const_iterator b;
+
+      if (it->size () != eIt->size ())
+	{
+	  errors += it->size ();
+	  continue;
+	}
+      for (a = it->begin (), b = eIt->begin (); it->end () != a; ++a, ++b)
+	if (a->getType () != b->getType ()
+	    || fabs (a->getX () - b->getX ()) > tolerance
+	    || fabs (a->getY () - b->getY ()) > tolerance
+	    || fabs (a->getZ () - b->getZ ()) > tolerance)
+	  ++errors;
+    }
+  return errors;
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  GraphModel sequential (model);
+  GraphModel threaded (model);
+  GraphModel lazy (model);
+  GraphModel *models[] = { &sequential, &threaded, &lazy };
+  vector< Residue > perAtom;
+  vector< Residue > placedSequential;
+  GraphModel::const_iterator cIt;
+  unsigned int m;
+  unsigned int n;
+
+  // -- the reference: plain residues moved atom by atom
+  for (cIt = ((const GraphModel&) model).begin (), n = 0; model.end () != cIt; ++cIt, ++n)
+    {
+      Residue res (cIt->getType (), cIt->getResId ());
+      Residue::const_iterator a;
+
+      for (a = cIt->begin (); cIt->end () != a; ++a)
+	res.insert (*a);
+      res.transform (motion (n));
+      perAtom.push_back (res);
+    }
+
+  // -- the extended residues only keep their new referential
+  for (m = 0; m < 3; ++m)
+    {
+      GraphModel::iterator it;
+
+      for (it = models[m]->begin (), n = 0; models[m]->end () != it; ++it, ++n)
+	if (0 == n % 3)
+	  it->setReferential (motion (n) * it->getReferential ());
+	else
+	  it->transform (motion (n));
+    }
+  gOut (0) << "Residues: " << model.size () << " unplaced: " << unplaced (sequential)
+	   << " " << unplaced (threaded) << " " << unplaced (lazy) << endl;
+
+  // -- placed in one pass, with one thread or several, or one residue at
+  //    a time when its atoms are read
+  sequential.place ();
+  threaded.place (4);
+  gOut (0) << "placed: unplaced left " << unplaced (sequential) << " " << unplaced (threaded) << endl;
+
+  for (cIt = ((const GraphModel&) sequential).begin (); sequential.end () != cIt; ++cIt)
+    {
+      Residue res (cIt->getType (), cIt->getResId ());
+      Residue::const_iterator a;
+
+      for (a = cIt->begin (); cIt->end () != a; ++a)
+	res.insert (*a);
+      placedSequential.push_back (res);
+    }
+
+  gOut (0) << "batched vs per atom: " << compare (sequential, perAtom, 1e-3)
+	   << " atoms differ" << endl
+	   << "threaded vs sequential: " << compare (threaded, placedSequential, 0)
+	   << " atoms differ" << endl
+	   << "lazy vs sequential: " << compare (lazy, placedSequential, 0)
+	   << " atoms differ" << endl;
+
+  // -- a placed model has nothing left to place
+  threaded.place (4);
+  gOut (0) << "placed again: " << compare (threaded, placedSequential, 0)
+	   << " atoms differ" << endl;
+
+  return EXIT_SUCCESS;
+}
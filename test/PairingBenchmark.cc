@@ -0,0 +1,192 @@
+//                              -*- Mode: C++ -*-
+// PairingBenchmark.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <vector>
+#include <sys/time.h>
+
+#include "GraphModel.h"
+#include "HBond.h"
+#include "Messagestream.h"
+#include "PairingPattern.h"
+#include "Pdbstream.h"
+#include "PropertyType.h"
+#include "Relation.h"
+#include "Residue.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+static double
+milliseconds ()
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, 0);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+
+/**
+ * The arguments of a pairing label translation.
+ */
+struct Query
+{
+  const Residue *ra;
+  const Residue *rb;
+  const PropertyType *bpo;
+  list< HBondFlow > hbf;
+  unsigned int size_hint;
+};
+
+
+/**
+ * Opens the pairing label translation of the annotation.
+ */
+class Translator : public Relation
+{
+public:
+  using Relation::translatePairing;
+};
+
+
+/**
+ * Translates a pairing by evaluating every pattern, as the pattern list
+ * was walked before the index.
+ */
+static const PropertyType*
+translateAll (const Query &q, list< HBondFlow > &hbf)
+{
+  list< PairingPattern >::const_iterator i;
+  const PropertyType *type;
+  const PropertyType *best_type = 0;
+  unsigned int best_size = 0;
+
+  for (i = PairingPattern::patternList ().begin (); PairingPattern::patternList ().end () != i; ++i)
+    if (q.size_hint >= i->size ()
+	&& 0 != (type = i->evaluate (q.ra, q.rb, q.bpo, hbf))
+	&& i->size () > best_size)
+      {
+	best_size = i->size ();
+	best_type = type;
+      }
+  return best_type;
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+  vector< Query > queries;
+  vector< Query >::iterator q;
+  GraphModel::edge_size_type label;
+  unsigned int labelled = 0;
+  unsigned int rounds = 10;
+  unsigned int r;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+      model.addHLP ();
+      model.annotate ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  // -- the flows of each pairing, truncated to each size hint
+  for (label = 0; label < model.edgeSize (); ++label)
+    {
+      const Relation *rel = model.internalGetEdge (label);
+      list< HBondFlow > hbf (rel->getHBondFlows ().begin (), rel->getHBondFlows ().end ());
+
+      if (! rel->is (PropertyType::pPairing) || hbf.empty ())
+	continue;
+      hbf.sort ();
+      for (unsigned int hint = 1; hint <= 3 && hint <= hbf.size (); ++hint)
+	{
+	  Query query;
+
+	  query.ra = rel->getRef ();
+	  query.rb = rel->getRes ();
+	  query.bpo = (rel->is (PropertyType::pParallel)
+		       ? PropertyType::pParallel
+		       : PropertyType::pAntiparallel);
+	  query.hbf = hbf;
+	  while (query.hbf.size () != hint)
+	    query.hbf.pop_front ();
+	  query.size_hint = hint;
+	  queries.push_back (query);
+	}
+    }
+
+  for (q = queries.begin (); queries.end () != q; ++q)
+    {
+      list< HBondFlow > hbf = q->hbf;
+
+      if (0 != Translator::translatePairing (q->ra, q->rb, q->bpo, hbf, 0, q->size_hint))
+	++labelled;
+    }
+
+  gOut (0) << queries.size () << " pairing flows, " << labelled << " labelled" << endl
+	   << "lookup\ttime (ms)\tlabels/s" << endl;
+  for (int indexed = 0; indexed < 2; ++indexed)
+    {
+      double t = milliseconds ();
+      double ms;
+
+      for (r = 0; r < rounds; ++r)
+	for (q = queries.begin (); queries.end () != q; ++q)
+	  if (indexed)
+	    Translator::translatePairing (q->ra, q->rb, q->bpo, q->hbf, 0, q->size_hint);
+	  else
+	    translateAll (*q, q->hbf);
+      ms = milliseconds () - t;
+      gOut (0) << (indexed ? "index" : "scan") << "\t" << ms << "\t"
+	       << rounds * queries.size () / ms * 1000.0 << endl;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+//                              -*- Mode: C++ -*-
+// PairingPatternIndex.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <map>
+#include <vector>
+
+#include "GraphModel.h"
+#include "HBond.h"
+#include "Messagestream.h"
+#include "PairingPattern.h"
+#include "Pdbstream.h"
+#include "PropertyType.h"
+#include "Relation.h"
+#include "Residue.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Opens the pairing label translation of the annotation.
+ */
+class Translator : public Relation
+{
+public:
+  using Relation::translatePairing;
+};
+
+
+/**
+ * Translates a pairing by evaluating every pattern, as the pattern list
+ * was walked before the index.
+ */
+static const PropertyType*
+translateAll (const Residue *ra, const Residue *rb, const PropertyType *bpo, list< HBondFlow > &hbf, unsigned int size_hint)
+{
+  list< PairingPattern >::const_iterator i;
+  const PropertyType *type;
+  const PropertyType *best_type = 0;
+  unsigned int best_size = 0;
+
+  for (i = PairingPattern::patternList ().begin (); PairingPattern::patternList ().end () != i; ++i)
+    if (size_hint >= i->size ()
+	&& 0 != (type = i->evaluate (ra, rb, bpo, hbf))
+	&& i->size () > best_size)
+      {
+	best_size = i->size ();
+	best_type = type;
+      }
+  return best_type;
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+      model.addHLP ();
+      model.annotate ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  const PropertyType *orientations[] = { PropertyType::pParallel, PropertyType::pAntiparallel };
+  map< const PropertyType*, unsigned int > labels;
+  map< const PropertyType*, unsigned int >::iterator lIt;
+  GraphModel::edge_size_type label;
+  unsigned int queries = 0;
+  unsigned int labelled = 0;
+  unsigned int disagreements = 0;
+
+  // -- the flows of each pairing, truncated to each size hint, in both
+  //    orientations and both residue orders
+  for (label = 0; label < model.edgeSize (); ++label)
+    {
+      const Relation *rel = model.internalGetEdge (label);
+      list< HBondFlow > flows (rel->getHBondFlows ().begin (), rel->getHBondFlows ().end ());
+      unsigned int hint;
+      unsigned int o;
+
+      if (! rel->is (PropertyType::pPairing) || flows.empty ())
+	continue;
+      flows.sort ();
+      for (hint = 1; hint <= 3 && hint <= flows.size (); ++hint)
+	for (o = 0; o < 4; ++o)
+	  {
+	    const Residue *ra = 0 == o / 2 ? rel->getRef () : rel->getRes ();
+	    const Residue *rb = 0 == o / 2 ? rel->getRes () : rel->getRef ();
+	    list< HBondFlow > hbf = flows;
+	    list< HBondFlow > scanned;
+	    const PropertyType *indexed;
+
+	    while (hbf.size () != hint)
+	      hbf.pop_front ();
+	    scanned = hbf;
+	    indexed = Translator::translatePairing (ra, rb, orientations[o % 2], hbf, 0, hint);
+	    if (indexed != translateAll (ra, rb, orientations[o % 2], scanned, hint))
+	      ++disagreements;
+	    if (0 != indexed)
+	      {
+		++labelled;
+		++labels[indexed];
+	      }
+	    ++queries;
+	  }
+    }
+
+  gOut (0) << "Pairing flows: " << queries << " labelled: " << labelled
+	   << ", " << disagreements << " disagreements with the scan" << endl;
+  for (lIt = labels.begin (); labels.end () != lIt; ++lIt)
+    gOut (0) << "  " << lIt->first << ": " << lIt->second << endl;
+
+  return EXIT_SUCCESS;
+}
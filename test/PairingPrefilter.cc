@@ -0,0 +1,126 @@
+//                              -*- Mode: C++ -*-
+// PairingPrefilter.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "GraphModel.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Relation.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Prints the edges by label, to compare the annotations.
+ */
+static string
+edges (const GraphModel &model)
+{
+  ostringstream oss;
+  GraphModel::edge_size_type label;
+
+  for (label = 0; label < model.edgeSize (); ++label)
+    model.internalGetEdge (label)->write (oss) << endl;
+  return oss.str ();
+}
+
+
+/**
+ * Annotates the model with the given prefilter settings.
+ */
+static string
+annotate (GraphModel &model, bool sphere, float normal, bool donor)
+{
+  Relation::setPairingSphereTest (sphere);
+  Relation::setPairingNormalCutoff (normal);
+  Relation::setPairingDonorTest (donor);
+  Relation::resetPairingStats ();
+  model.reannotate ();
+  return edges (model);
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+  string reference;
+  string filtered;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+      model.addHLP ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  // -- the full evaluation of every pair within the residue bounds
+  reference = annotate (model, false, M_PI / 2, false);
+  gOut (0) << "Size: " << model.size ()
+	   << " Edge size: " << model.edgeSize () << endl
+	   << "tested: " << Relation::getPairingTested ()
+	   << " bounds rejects: " << Relation::getPairingBoundsRejects () << endl;
+
+  // -- the default stages must not change the annotations
+  filtered = annotate (model, true, M_PI / 2, true);
+  gOut (0) << "default stages: " << (filtered == reference ? "unchanged" : "changed") << endl
+	   << "tested: " << Relation::getPairingTested ()
+	   << " bounds rejects: " << Relation::getPairingBoundsRejects ()
+	   << " sphere rejects: " << Relation::getPairingSphereRejects ()
+	   << " normal rejects: " << Relation::getPairingNormalRejects ()
+	   << " donor rejects: " << Relation::getPairingDonorRejects () << endl;
+
+  // -- a normal angle cutoff rejects more pairs
+  annotate (model, true, M_PI / 4, true);
+  gOut (0) << "normal angle cutoff rejects pairs: "
+	   << (0 < Relation::getPairingNormalRejects () ? "yes" : "no") << endl;
+
+  Relation::setPairingNormalCutoff (M_PI / 2);
+  return EXIT_SUCCESS;
+}
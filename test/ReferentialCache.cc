@@ -0,0 +1,203 @@
+//                              -*- Mode: C++ -*-
+// ReferentialCache.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "Atom.h"
+#include "AtomType.h"
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Residue.h"
+#include "ResidueType.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Tells whether two transfos are equal within rounding.
+ */
+static bool
+same (const HomogeneousTransfo &a, const HomogeneousTransfo &b)
+{
+  unsigned int i;
+  unsigned int j;
+
+  for (i = 0; i < 4; ++i)
+    for (j = 0; j < 4; ++j)
+      if (fabs (a.elementAt (i, j) - b.elementAt (i, j)) > 1e-4)
+	return false;
+  return true;
+}
+
+
+/**
+ * Copies the atoms of a residue in a new plain residue, with no cache.
+ */
+static Residue
+plain (const Residue &res)
+{
+  Residue copy (res.getType (), res.getResId ());
+  Residue::const_iterator it;
+
+  for (it = res.begin (); res.end () != it; ++it)
+    copy.insert (*it);
+  return copy;
+}
+
+
+/**
+ * Computes the referential of a residue anew, from an uncached copy of its
+ * atoms.
+ */
+static HomogeneousTransfo
+fresh (const Residue &res)
+{
+  return plain (res).getReferential ();
+}
+
+
+/**
+ * Prints the cache statistics since the last call, then resets them.
+ */
+static void
+requests (const char *what)
+{
+  gOut (0) << what << ": " << Residue::getReferentialCacheHits () << " hits "
+	   << Residue::getReferentialCacheMisses () << " misses" << endl;
+  Residue::resetReferentialCacheStats ();
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  GraphModel::iterator it;
+
+  for (it = model.begin (); model.end () != it; ++it)
+    if (it->getType ()->isA ())
+      break;
+
+  // -- a plain residue: the model's extended residues keep their own
+  //    referential
+  Residue res = plain (*it);
+  HomogeneousTransfo tfo = (HomogeneousTransfo::translation (3.0, -2.0, 1.0)
+			    * HomogeneousTransfo::rotation (Vector3D (0, 1, 1), 0.7));
+  HomogeneousTransfo ref;
+  HomogeneousTransfo moved;
+  bool valid;
+
+  // -- a repeated request is served from the cache, the inverse is cached
+  //    with its own flag
+  Residue::resetReferentialCacheStats ();
+  ref = res.getReferential ();
+  valid = same (res.getReferential (), ref);
+  requests ("repeated referential");
+  res.getReferentialInverse ();
+  res.getReferentialInverse ();
+  requests ("repeated inverse");
+  gOut (0) << "cached referential is the computed one: "
+	   << (valid && same (ref, fresh (res)) ? "yes" : "no") << endl;
+  Residue::resetReferentialCacheStats ();
+
+  // -- any change of the atoms or the type invalidates both
+  res.transform (tfo);
+  moved = res.getReferential ();
+  valid = same (res.getReferentialInverse (), moved.invert ());
+  requests ("after transform");
+  gOut (0) << "moved referential: "
+	   << (same (moved, tfo * ref) && same (moved, fresh (res)) && valid ? "right" : "wrong")
+	   << endl;
+  Residue::resetReferentialCacheStats ();
+
+  res.setReferential (ref);
+  moved = res.getReferential ();
+  res.getReferentialInverse ();
+  requests ("after setReferential");
+  gOut (0) << "set referential: " << (same (moved, ref) ? "right" : "wrong") << endl;
+  Residue::resetReferentialCacheStats ();
+
+  res.setType (ResidueType::rRG);
+  moved = res.getReferential ();
+  requests ("after setType");
+  gOut (0) << "retyped referential: " << (same (moved, fresh (res)) ? "right" : "wrong") << endl;
+  Residue::resetReferentialCacheStats ();
+
+  // -- only the atoms the referential is built from invalidate it
+  const Residue &cres = res;
+  Atom c1p = *cres.find (AtomType::aC1p);
+  Atom pso = *cres.find (AtomType::aPSO);
+
+  res.erase (AtomType::aC1p);
+  c1p.set (c1p + Vector3D (0.5, 0, 0));
+  res.insert (c1p);
+  moved = res.getReferential ();
+  requests ("after a ribose atom erase and insert");
+  gOut (0) << "kept referential: " << (same (moved, fresh (res)) ? "right" : "wrong") << endl;
+  Residue::resetReferentialCacheStats ();
+
+  res.erase (AtomType::aPSO);
+  pso.set (pso + Vector3D (0.5, 0, 0));
+  res.insert (pso);
+  moved = res.getReferential ();
+  requests ("after a referential atom erase and insert");
+  gOut (0) << "rebuilt referential: " << (same (moved, fresh (res)) ? "right" : "wrong") << endl;
+
+  // -- the statistics are reset
+  Residue::resetReferentialCacheStats ();
+  requests ("reset");
+
+  return EXIT_SUCCESS;
+}
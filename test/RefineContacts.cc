@@ -0,0 +1,214 @@
+//                              -*- Mode: C++ -*-
+// RefineContacts.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "Algo.h"
+#include "Atom.h"
+#include "AtomType.h"
+#include "GraphModel.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Residue.h"
+#include "ResidueType.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+typedef GraphModel::const_iterator ResIt;
+
+
+
+/**
+ * Computes the minimum squared distance between the atoms of two residues
+ * by testing every atom pair, pseudo-atoms excluded.
+ */
+static float
+minDistance2 (const Residue &a, const Residue &b)
+{
+  Residue::const_iterator i;
+  Residue::const_iterator j;
+  float best = numeric_limits< float >::max ();
+
+  for (i = a.begin (); a.end () != i; ++i)
+    if (! i->getType ()->isPseudo ())
+      for (j = b.begin (); b.end () != j; ++j)
+	if (! j->getType ()->isPseudo ())
+	  {
+	    float dx = j->getX () - i->getX ();
+	    float dy = j->getY () - i->getY ();
+	    float dz = j->getZ () - i->getZ ();
+	    float d2 = dx * dx + dy * dy + dz * dz;
+
+	    if (d2 < best)
+	      best = d2;
+	  }
+  return best;
+}
+
+
+/**
+ * Refines contacts with and without distances and compares them with the
+ * minimum distances of every atom pair.
+ * @param kept incremented by the contacts kept.
+ * @return the number of contacts kept, dropped or measured wrongly.
+ */
+template< class iter_type >
+static unsigned int
+compare (const vector< pair< iter_type, iter_type > > &contacts, float cutoff, unsigned int &kept)
+{
+  vector< pair< iter_type, iter_type > > refined (contacts);
+  vector< pair< iter_type, iter_type > > measured (contacts);
+  vector< float > distances;
+  map< pair< const Residue*, const Residue* >, float > expected;
+  typename vector< pair< iter_type, iter_type > >::const_iterator it;
+  unsigned int errors = 0;
+  unsigned int n;
+
+  for (it = contacts.begin (); contacts.end () != it; ++it)
+    {
+      float d2 = minDistance2 (*it->first, *it->second);
+
+      if (d2 <= cutoff * cutoff || sqrt (d2) <= cutoff)
+	expected[make_pair (&*it->first, &*it->second)] = sqrt (d2);
+    }
+
+  Algo::refineContacts (refined, cutoff);
+  Algo::refineContacts (measured, distances, cutoff);
+  if (refined.size () != expected.size () || measured.size () != expected.size ()
+      || distances.size () != measured.size ())
+    return expected.size () + 1;
+  for (n = 0; n < measured.size (); ++n)
+    {
+      pair< const Residue*, const Residue* > key (&*measured[n].first, &*measured[n].second);
+
+      if (expected.end () == expected.find (key)
+	  || expected[key] != distances[n]
+	  || expected.end () == expected.find (make_pair (&*refined[n].first, &*refined[n].second)))
+	++errors;
+    }
+  kept += measured.size ();
+  return errors;
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  const GraphModel &cmodel = model;
+  RDATypeFilter< ResIt > filter;
+  vector< pair< ResIt, ResIt > > boxes;
+  unsigned int errors = 0;
+  unsigned int kept = 0;
+  unsigned int n;
+
+  // -- the box contacts of 1L8V, refined at their cutoff and below
+  Algo::extractContacts (boxes, cmodel.begin (), cmodel.end (), filter, 5.0, Algo::grid_engine);
+
+  errors = compare (boxes, 5.0, kept);
+  gOut (0) << "box contacts: " << boxes.size () << ", " << kept << " within 5.0, "
+	   << errors << " errors" << endl;
+  kept = 0;
+  errors = compare (boxes, 2.5, kept) + compare (boxes, 4.0, kept);
+  gOut (0) << "box contacts: " << kept << " within 2.5 or 4.0, "
+	   << errors << " errors" << endl;
+
+  // -- cutoffs at the minimum distance of some contacts: the pairs at the
+  //    cutoff are kept
+  vector< pair< ResIt, ResIt > > measured (boxes);
+  vector< float > distances;
+  unsigned int atCutoff = 0;
+
+  Algo::refineContacts (measured, distances, 5.0);
+  errors = kept = 0;
+  for (n = 0; n < measured.size (); n += 97)
+    {
+      vector< pair< ResIt, ResIt > > refined (boxes);
+      vector< pair< ResIt, ResIt > >::iterator it;
+
+      errors += compare (boxes, distances[n], kept);
+      Algo::refineContacts (refined, distances[n]);
+      for (it = refined.begin (); refined.end () != it; ++it)
+	if (*it == measured[n])
+	  ++atCutoff;
+    }
+  gOut (0) << "cutoffs at contact distances: " << atCutoff << " of "
+	   << (measured.size () + 96) / 97 << " contacts at the cutoff kept, "
+	   << errors << " errors" << endl;
+
+  // -- atoms exactly at the cutoff
+  vector< Residue > placed;
+  vector< pair< vector< Residue >::const_iterator, vector< Residue >::const_iterator > > exact;
+  float cutoffs[] = { 3.0, 2.999, 5.0 };
+
+  for (n = 0; n < 2; ++n)
+    {
+      Residue res (ResidueType::rRA, ResId ('A', n + 1));
+
+      res.insert (Atom (3.0 * n, 0, 0, AtomType::aC1p));
+      placed.push_back (res);
+    }
+  exact.push_back (make_pair (placed.begin (), placed.begin () + 1));
+  for (n = 0; n < 3; ++n)
+    {
+      kept = 0;
+      errors = compare (exact, cutoffs[n], kept);
+      gOut (0) << "atoms 3.0 apart, cutoff " << cutoffs[n] << ": "
+	       << (1 == kept ? "kept" : "dropped") << ", " << errors << " errors" << endl;
+    }
+
+  return EXIT_SUCCESS;
+}
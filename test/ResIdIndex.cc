@@ -0,0 +1,207 @@
+//                              -*- Mode: C++ -*-
+// ResIdIndex.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "AbstractModel.h"
+#include "GraphModel.h"
+#include "Messagestream.h"
+#include "Model.h"
+#include "Pdbstream.h"
+#include "ResId.h"
+#include "Residue.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Finds a residue by a linear scan, the first of a duplicated id.
+ */
+static AbstractModel::size_type
+scan (const AbstractModel &model, const ResId &id)
+{
+  AbstractModel::size_type pos;
+
+  for (pos = 0; pos < model.size () && model[pos].getResId () != id; ++pos)
+    ;
+  return pos;
+}
+
+
+/**
+ * Compares the lookups through the index with a scan, for the residues of
+ * the model and for ids that are not there.
+ * @return the number of lookups that differ.
+ */
+static unsigned int
+check (const AbstractModel &model)
+{
+  AbstractModel::const_iterator it;
+  unsigned int errors = 0;
+  int n;
+
+  for (it = model.begin (); model.end () != it; ++it)
+    if (model.find (it->getResId ()) - model.begin () != (int) scan (model, it->getResId ()))
+      ++errors;
+  for (n = 0; n < 20; ++n)
+    if (model.end () != model.find (ResId ('Z', n)))
+      ++errors;
+  return errors;
+}
+
+
+/**
+ * Checks the index of a model through erasures, insertions, a sort and
+ * renamed residues.
+ * @param duplicates whether the model may hold residues of the same id, a
+ * GraphModel tells its residues apart by their ids.
+ */
+static void
+run (const char *name, AbstractModel &model, bool duplicates)
+{
+  vector< Residue > erased;
+  AbstractModel::iterator it;
+  unsigned int errors = 0;
+  unsigned int n;
+
+  gOut (0) << name << ": " << model.size () << " residues, "
+	   << check (model) << " errors" << endl;
+
+  // -- erasures here and there, looked up in between
+  for (it = model.begin (), n = 0; model.end () != it; ++n)
+    if (0 == n % 3)
+      {
+	erased.push_back (*it);
+	it = model.erase (it);
+	if (0 == n % 21)
+	  errors += check (model);
+      }
+    else
+      ++it;
+  gOut (0) << "erased: " << model.size () << " left, "
+	   << errors + check (model) << " errors, "
+	   << (model.end () == model.find (erased.back ().getResId ()) ? "erased not found" : "erased found")
+	   << endl;
+
+  // -- reinserted at the end, in reverse
+  errors = 0;
+  while (! erased.empty ())
+    {
+      model.insert (erased.back ());
+      erased.pop_back ();
+      if (0 == erased.size () % 37)
+	errors += check (model);
+    }
+  gOut (0) << "reinserted: " << model.size () << " residues, "
+	   << errors + check (model) << " errors" << endl;
+
+  model.sort ();
+  gOut (0) << "sorted: " << check (model) << " errors" << endl;
+
+  // -- erasures shift the indexed positions without a rebuild, which a
+  //    residue renamed in place and still missed shows
+  ResId hidden ('Y', 1);
+  AbstractModel::size_type pos;
+
+  errors = check (model);
+  model[model.size () - 1].setResId (hidden);
+  for (n = 0; n < 5; ++n)
+    {
+      model.erase (model.begin () + 2 * n);
+      for (pos = 2 * n; pos + 1 < model.size (); pos += 17)
+	if (model.find (model[pos].getResId ()) - model.begin () != (int) pos)
+	  ++errors;
+    }
+  gOut (0) << "shifted: " << errors << " errors, renamed residue "
+	   << (model.end () == model.find (hidden) ? "missed" : "found") << endl;
+  model.reindex ();
+
+  // -- an id modified in place is only found once the index is rebuilt,
+  //    its old id is not found
+  ResId old = model[10].getResId ();
+  ResId renamed ('Z', 100);
+
+  model[10].setResId (renamed);
+  gOut (0) << "renamed: new id " << (model.end () == model.find (renamed) ? "missed" : "found")
+	   << ", old id " << (model.end () == model.find (old) ? "missed" : "found") << endl;
+  model.reindex ();
+  gOut (0) << "reindexed: new id at " << model.find (renamed) - model.begin ()
+	   << ", " << check (model) << " errors" << endl;
+
+  if (! duplicates)
+    return;
+
+  // -- the first of a duplicated id is found, the other once it is erased
+  ResId twice = model[40].getResId ();
+
+  model[30].setResId (twice);
+  model.reindex ();
+  it = model.find (twice);
+  gOut (0) << "duplicated: found at " << it - model.begin () << endl;
+  model.erase (it);
+  gOut (0) << "first erased: found at " << model.find (twice) - model.begin ()
+	   << ", " << check (model) << " errors" << endl;
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  Model plain (model);
+
+  run ("GraphModel", model, false);
+  run ("Model", plain, true);
+
+  return EXIT_SUCCESS;
+}
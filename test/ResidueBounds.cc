@@ -0,0 +1,243 @@
+//                              -*- Mode: C++ -*-
+// ResidueBounds.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "Atom.h"
+#include "AtomType.h"
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Residue.h"
+#include "ResidueType.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Tells whether the cached bounds of a residue enclose its atoms,
+ * pseudo-atoms excluded, the box touching them on every side.
+ */
+static bool
+bounded (const Residue &res)
+{
+  Residue::const_iterator it;
+  Vector3D lower;
+  Vector3D upper;
+  Vector3D center;
+  float radius;
+  float low[3];
+  float up[3];
+  bool inside = true;
+
+  low[0] = low[1] = low[2] = numeric_limits< float >::max ();
+  up[0] = up[1] = up[2] = -numeric_limits< float >::max ();
+  res.getBoundingBox (lower, upper);
+  res.getBoundingSphere (center, radius);
+  for (it = res.begin (); res.end () != it; ++it)
+    if (! it->getType ()->isPseudo ())
+      {
+	low[0] = min (low[0], it->getX ());
+	low[1] = min (low[1], it->getY ());
+	low[2] = min (low[2], it->getZ ());
+	up[0] = max (up[0], it->getX ());
+	up[1] = max (up[1], it->getY ());
+	up[2] = max (up[2], it->getZ ());
+	inside = inside && it->distance (center) <= radius;
+      }
+  return (inside
+	  && lower == Vector3D (low[0], low[1], low[2])
+	  && upper == Vector3D (up[0], up[1], up[2])
+	  && center == (lower + upper) / 2);
+}
+
+
+/**
+ * Copies the atom coordinates of residues in contiguous arrays,
+ * pseudo-atoms excluded: residue r holds [start[r], start[r+1]).
+ */
+static void
+pack (const GraphModel &model, vector< float > &x, vector< float > &y, vector< float > &z, vector< unsigned int > &start)
+{
+  GraphModel::const_iterator rIt;
+
+  for (rIt = model.begin (); model.end () != rIt; ++rIt)
+    {
+      Residue::const_iterator it;
+
+      start.push_back (x.size ());
+      for (it = rIt->begin (); rIt->end () != it; ++it)
+	if (! it->getType ()->isPseudo ())
+	  {
+	    x.push_back (it->getX ());
+	    y.push_back (it->getY ());
+	    z.push_back (it->getZ ());
+	  }
+    }
+  start.push_back (x.size ());
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  const GraphModel &cmodel = model;
+  GraphModel::const_iterator it;
+  unsigned int errors = 0;
+
+  for (it = cmodel.begin (); cmodel.end () != it; ++it)
+    if (! bounded (*it))
+      ++errors;
+  gOut (0) << "Residues: " << model.size () << ", " << errors << " wrong bounds" << endl;
+
+  // -- the bounds follow the atoms, of a plain residue and of an extended
+  //    one placed on demand
+  HomogeneousTransfo tfo = (HomogeneousTransfo::translation (3.0, -2.0, 1.0)
+			    * HomogeneousTransfo::rotation (Vector3D (0, 1, 1), 0.7));
+  Residue plain (cmodel.begin ()->getType (), cmodel.begin ()->getResId ());
+  Residue *residues[] = { &plain, &*model.begin () };
+  const char *names[] = { "plain", "extended" };
+  Residue::const_iterator aIt;
+  unsigned int r;
+
+  for (aIt = cmodel.begin ()->begin (); cmodel.begin ()->end () != aIt; ++aIt)
+    plain.insert (*aIt);
+  for (r = 0; r < 2; ++r)
+    {
+      Residue &res = *residues[r];
+      const Residue &cres = res;
+      Vector3D lower;
+      Vector3D upper;
+      Atom far (*cres.find (AtomType::aC1p));
+
+      res.getBoundingBox (lower, upper);
+      far.set (upper + Vector3D (5, 5, 5));
+      res.insert (far);
+      gOut (0) << names[r] << ": insert " << (bounded (res) ? "bounded" : "unbounded");
+      res.erase (AtomType::aC1p);
+      gOut (0) << ", erase " << (bounded (res) ? "bounded" : "unbounded");
+      res.transform (tfo);
+      gOut (0) << ", transform " << (bounded (res) ? "bounded" : "unbounded");
+      res.setReferential (HomogeneousTransfo ());
+      gOut (0) << ", setReferential " << (bounded (res) ? "bounded" : "unbounded");
+      res.setType (ResidueType::rRG);
+      gOut (0) << ", setType " << (bounded (res) ? "bounded" : "unbounded") << endl;
+    }
+
+  // -- no pair within a cutoff is rejected, the bounding distance is a
+  //    lower bound
+  vector< float > x;
+  vector< float > y;
+  vector< float > z;
+  vector< unsigned int > start;
+  vector< const Residue* > order;
+  float cutoffs[] = { 0.0, 2.0, 3.5, 5.0 };
+  unsigned int within[4] = { 0, 0, 0, 0 };
+  unsigned int rejected[4] = { 0, 0, 0, 0 };
+  unsigned int missed = 0;
+  unsigned int above = 0;
+  unsigned int pairs = 0;
+  unsigned int i;
+  unsigned int j;
+  unsigned int c;
+
+  pack (cmodel, x, y, z, start);
+  for (it = cmodel.begin (); cmodel.end () != it; ++it)
+    order.push_back (&*it);
+  for (i = 0; i < order.size (); ++i)
+    for (j = i + 1; j < order.size (); ++j)
+      {
+	float best = numeric_limits< float >::max ();
+	float d;
+	unsigned int a;
+	unsigned int b;
+
+	if (start[i] == start[i + 1] || start[j] == start[j + 1])
+	  continue;
+	for (a = start[i]; a < start[i + 1]; ++a)
+	  for (b = start[j]; b < start[j + 1]; ++b)
+	    {
+	      float dx = x[b] - x[a];
+	      float dy = y[b] - y[a];
+	      float dz = z[b] - z[a];
+
+	      best = min (best, dx * dx + dy * dy + dz * dz);
+	    }
+	d = sqrt (best);
+	++pairs;
+	for (c = 0; c < 4; ++c)
+	  if (d <= cutoffs[c])
+	    {
+	      ++within[c];
+	      if (! order[i]->mayBeWithin (*order[j], cutoffs[c]))
+		++rejected[c];
+	    }
+	// -- the pair at its own distance
+	if (! order[i]->mayBeWithin (*order[j], d))
+	  ++missed;
+	if (order[i]->getBoundingDistance (*order[j]) > d)
+	  ++above;
+      }
+  gOut (0) << "pairs: " << pairs << endl;
+  for (c = 0; c < 4; ++c)
+    gOut (0) << "cutoff " << cutoffs[c] << ": " << within[c] << " within, "
+	     << rejected[c] << " rejected" << endl;
+  gOut (0) << "at their own distance: " << missed << " rejected" << endl
+	   << "bounding distance above the distance: " << above << endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,194 @@
+//                              -*- Mode: C++ -*-
+// RingCache.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "Atom.h"
+#include "AtomType.h"
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Residue.h"
+#include "ResidueType.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Copies the atoms of a residue in a new plain residue, with no cache.
+ */
+static Residue
+plain (const Residue &res)
+{
+  Residue copy (res.getType (), res.getResId ());
+  Residue::const_iterator it;
+
+  for (it = res.begin (); res.end () != it; ++it)
+    copy.insert (*it);
+  return copy;
+}
+
+
+/**
+ * Tells whether two vectors are equal within rounding.
+ */
+static bool
+same (const Vector3D &a, const Vector3D &b)
+{
+  return a.distance (b) < 1e-4;
+}
+
+
+/**
+ * Compares the cached ring centers and normals of a purine with the ones
+ * of an uncached copy of its atoms, the centers also with the mean of the
+ * ring atoms.
+ */
+static bool
+fresh (const Residue &res)
+{
+  Residue copy = plain (res);
+  const AtomType *pyrimidine[] = { AtomType::aN1, AtomType::aC2, AtomType::aN3,
+				   AtomType::aC4, AtomType::aC5, AtomType::aC6 };
+  const AtomType *imidazole[] = { AtomType::aC4, AtomType::aC5, AtomType::aN7,
+				  AtomType::aC8, AtomType::aN9 };
+  Vector3D pyrCenter;
+  Vector3D imidCenter;
+  unsigned int i;
+
+  for (i = 0; i < 6; ++i)
+    pyrCenter += *res.safeFind (pyrimidine[i]);
+  for (i = 0; i < 5; ++i)
+    imidCenter += *res.safeFind (imidazole[i]);
+  return (same (res.getPyrimidineRingCenter (), pyrCenter / 6.0)
+	  && same (res.getImidazoleRingCenter (), imidCenter / 5.0)
+	  && same (res.getPyrimidineRingCenter (), copy.getPyrimidineRingCenter ())
+	  && same (res.getPyrimidineRingNormal (), copy.getPyrimidineRingNormal ())
+	  && same (res.getImidazoleRingCenter (), copy.getImidazoleRingCenter ())
+	  && same (res.getImidazoleRingNormal (), copy.getImidazoleRingNormal ()));
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  GraphModel::iterator it;
+
+  for (it = model.begin (); model.end () != it; ++it)
+    if (it->getType ()->isG ())
+      break;
+
+  HomogeneousTransfo tfo = (HomogeneousTransfo::translation (3.0, -2.0, 1.0)
+			    * HomogeneousTransfo::rotation (Vector3D (0, 1, 1), 0.7));
+  Residue copy = plain (*it);
+  Residue *residues[] = { &copy, &*it };
+  const char *names[] = { "plain", "extended" };
+  unsigned int r;
+
+  for (r = 0; r < 2; ++r)
+    {
+      Residue &res = *residues[r];
+      const Residue &cres = res;
+      Vector3D center;
+      Vector3D normal;
+      Atom n1;
+
+      gOut (0) << names[r] << ":" << endl;
+
+      // -- the rings are cached once computed
+      gOut (0) << "  cached rings: " << (fresh (cres) ? "right" : "wrong") << endl;
+
+      // -- a transform moves the rings
+      center = cres.getPyrimidineRingCenter ();
+      res.transform (tfo);
+      gOut (0) << "  after transform: "
+	       << (fresh (cres) && same (cres.getPyrimidineRingCenter (), tfo * center)
+		   ? "recomputed" : "stale") << endl;
+
+      // -- the pyrimidine normal of a purine is reversed
+      normal = cres.getPyrimidineRingNormal ();
+      res.setType (ResidueType::rRC);
+      gOut (0) << "  after setType: "
+	       << (fresh (cres) && same (cres.getPyrimidineRingNormal (), -normal)
+		   ? "recomputed" : "stale") << endl;
+      res.setType (ResidueType::rRG);
+
+      // -- a replaced ring atom moves the ring
+      center = cres.getPyrimidineRingCenter ();
+      n1 = *cres.safeFind (AtomType::aN1);
+      n1.set (n1 + Vector3D (0.6, 0, 0));
+      res.insert (n1);
+      gOut (0) << "  after insert: "
+	       << (fresh (cres) && same (cres.getPyrimidineRingCenter (), center + Vector3D (0.1, 0, 0))
+		   ? "recomputed" : "stale") << endl;
+
+      // -- an erased ring atom leaves no ring
+      cres.getImidazoleRingCenter ();
+      res.erase (AtomType::aN7);
+      gOut (0) << "  after erase: ";
+      try
+	{
+	  cres.getImidazoleRingCenter ();
+	  gOut (0) << "stale" << endl;
+	}
+      catch (NoSuchAtomException &ex)
+	{
+	  gOut (0) << "no ring" << endl;
+	}
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+//                              -*- Mode: C++ -*-
+// Sasa.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "Atom.h"
+#include "AtomType.h"
+#include "GraphModel.h"
+#include "Messagestream.h"
+#include "Model.h"
+#include "Pdbstream.h"
+#include "ResidueType.h"
+#include "Sasa.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Tells whether an area is within a relative tolerance of its expected
+ * value.
+ */
+static const char*
+within (float area, float expected, float tolerance)
+{
+  return fabs (area - expected) <= tolerance * expected ? "yes" : "no";
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  gOut (0) << fixed << setprecision (1);
+
+  // -- an isolated atom exposes its whole sphere
+  Model single;
+  Residue res (ResidueType::rC, ResId ('A', 1));
+  Sasa sasa (1.4, 2000);
+  float rc = 1.70 + 1.4;
+  float ro = 1.52 + 1.4;
+  float d = 4.0;
+
+  res.insert (Atom (0, 0, 0, AtomType::aC1p));
+  single.insert (res);
+  sasa.compute (single);
+  gOut (0) << "isolated atom: " << sasa.getArea ()
+	   << " expected " << 4 * M_PI * rc * rc << endl;
+
+  // -- two overlapping atoms each lose a spherical cap
+  Model couple;
+  float hc = rc - (d * d + rc * rc - ro * ro) / (2 * d);
+  float ho = ro - (d * d + ro * ro - rc * rc) / (2 * d);
+  float ec = 4 * M_PI * rc * rc - 2 * M_PI * rc * hc;
+  float eo = 4 * M_PI * ro * ro - 2 * M_PI * ro * ho;
+
+  res.insert (Atom (d, 0, 0, AtomType::aO2p));
+  couple.insert (res);
+  sasa.compute (couple);
+  gOut (0) << "overlapping atoms: "
+	   << "carbon within 1% of " << ec << ": "
+	   << within (sasa.getArea (*couple.begin (), AtomType::aC1p), ec, 0.01)
+	   << ", oxygen within 1% of " << eo << ": "
+	   << within (sasa.getArea (*couple.begin (), AtomType::aO2p), eo, 0.01) << endl;
+
+  // -- the residues of 1L8V, one thread or several
+  const GraphModel &cmodel = model;
+  GraphModel::const_iterator it;
+  Sasa areas;
+  Sasa threaded;
+  float sum = 0;
+  unsigned int n;
+  bool same = true;
+
+  areas.compute (cmodel);
+  threaded.compute (cmodel, 3);
+  gOut (0) << "1L8V: " << areas.getArea () << endl;
+  for (it = cmodel.begin (), n = 0; cmodel.end () != it; ++it, ++n)
+    {
+      sum += areas.getArea (*it);
+      same = same && areas.getArea (*it) == threaded.getArea (*it);
+      if (0 == n % 80)
+	gOut (0) << "  " << it->getResId () << " " << *it->getType ()
+		 << ": " << areas.getArea (*it) << endl;
+    }
+  gOut (0) << "residue sum within 0.01% of the total: "
+	   << within (sum, areas.getArea (), 1e-4) << endl;
+  gOut (0) << "threaded: " << (same ? "same" : "different") << " residue areas" << endl;
+
+  try
+    {
+      areas.getArea (res);
+      gOut (0) << "unknown residue found" << endl;
+    }
+  catch (NoSuchElementException &ex)
+    {
+      gOut (0) << "unknown residue rejected" << endl;
+    }
+
+  return EXIT_SUCCESS;
+}
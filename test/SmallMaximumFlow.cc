@@ -0,0 +1,222 @@
+//                              -*- Mode: C++ -*-
+// SmallMaximumFlow.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Exception.h"
+#include "GraphModel.h"
+#include "HBond.h"
+#include "MaximumFlowGraph.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "Relation.h"
+#include "SmallMaximumFlow.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * A linear congruential generator, for the same networks on every
+ * platform.
+ */
+static unsigned int
+draw (unsigned int &seed, unsigned int n)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) % n;
+}
+
+
+/**
+ * Solves a source/sink network of donors and acceptors with both solvers
+ * and compares the flows of every edge.
+ * @return whether the flows are the same.
+ */
+static bool
+compare (unsigned int ndonors, unsigned int nacceptors, const vector< unsigned int > &heads, const vector< unsigned int > &tails, const vector< float > &values, bool print)
+{
+  MaximumFlowGraph< unsigned int, HBond > graph;
+  SmallMaximumFlow< 32, 96 > network;
+  unsigned int v;
+  unsigned int e;
+  bool same = true;
+
+  for (v = 0; v < 2 + ndonors + nacceptors; ++v)
+    {
+      graph.insert (v, 1);
+      network.insert ();
+    }
+  for (v = 0; v < ndonors; ++v)
+    {
+      graph.internalConnect (0, 2 + v, HBond (1), 0);
+      network.connect (0, 2 + v, 1);
+    }
+  for (v = 0; v < nacceptors; ++v)
+    {
+      graph.internalConnect (2 + ndonors + v, 1, HBond (1), 0);
+      network.connect (2 + ndonors + v, 1, 1);
+    }
+  for (e = 0; e < heads.size (); ++e)
+    {
+      graph.internalConnect (heads[e], tails[e], HBond (values[e]), 0);
+      network.connect (heads[e], tails[e], values[e]);
+    }
+
+  graph.preFlowPush (0, 1);
+  if (! network.preFlowPush (0, 1))
+    {
+      gOut (0) << "active queue overflow" << endl;
+      return false;
+    }
+  for (e = 0; e < network.edgeSize (); ++e)
+    {
+      if (print)
+	gOut (0) << e << ": " << network.getFlow (e) << endl;
+      if (graph.internalGetEdgeWeight (e) != network.getFlow (e))
+	same = false;
+    }
+  return same;
+}
+
+
+
+/**
+ * Annotates the model with the given pairing flow solver and prints the
+ * edges with their flow sums, to compare the annotations.
+ */
+static string
+annotate (GraphModel &model, bool small)
+{
+  ostringstream oss;
+  GraphModel::edge_size_type label;
+
+  Relation::setPairingSmallFlow (small);
+  model.reannotate ();
+  for (label = 0; label < model.edgeSize (); ++label)
+    {
+      const Relation *rel = model.internalGetEdge (label);
+
+      rel->write (oss) << " " << rel->getFlowSum () << endl;
+    }
+  return oss.str ();
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  unsigned int seed = 1;
+  unsigned int n;
+  unsigned int identical = 0;
+  unsigned int networks = 2000;
+
+  // -- a bifurcated donor and a shared acceptor
+  {
+    vector< unsigned int > heads;
+    vector< unsigned int > tails;
+    vector< float > values;
+
+    heads.push_back (2); tails.push_back (4); values.push_back (0.6);
+    heads.push_back (2); tails.push_back (5); values.push_back (0.5);
+    heads.push_back (3); tails.push_back (5); values.push_back (0.9);
+    gOut (0) << "Bifurcated network flows" << endl;
+    gOut (0) << (compare (2, 2, heads, tails, values, true) ? "same" : "different")
+	     << " as MaximumFlowGraph" << endl;
+  }
+
+  // -- random H-bond like networks
+  for (n = 0; n < networks; ++n)
+    {
+      unsigned int ndonors = 1 + draw (seed, 8);
+      unsigned int nacceptors = 1 + draw (seed, 10);
+      unsigned int nbonds = 1 + draw (seed, 3 * (ndonors + nacceptors));
+      vector< unsigned int > heads;
+      vector< unsigned int > tails;
+      vector< float > values;
+      unsigned int b;
+
+      for (b = 0; b < nbonds; ++b)
+	{
+	  unsigned int d = 2 + draw (seed, ndonors);
+	  unsigned int a = 2 + ndonors + draw (seed, nacceptors);
+	  unsigned int k;
+
+	  for (k = 0; k < heads.size () && (heads[k] != d || tails[k] != a); ++k)
+	    ;
+	  if (heads.size () == k)
+	    {
+	      heads.push_back (d);
+	      tails.push_back (a);
+	      values.push_back (0.01f + draw (seed, 1000) / 1000.0f);
+	    }
+	}
+      if (compare (ndonors, nacceptors, heads, tails, values, false))
+	++identical;
+    }
+  gOut (0) << "Random networks: " << networks << " identical flows: " << identical << endl;
+
+  // -- the annotations of both solvers
+  {
+    GraphModel model;
+    string reference;
+    string small;
+
+    try
+      {
+	izfPdbstream ifs;
+
+	ifs.open ("1L8V.pdb.gz");
+
+	if (! ifs)
+	  {
+	    IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	    throw ex;
+	  }
+
+	ifs >> model;
+	ifs.close ();
+      }
+    catch (Exception& ex)
+      {
+	gErr (0) << argv[0] << ": " << ex << endl;
+	return EXIT_FAILURE;
+      }
+
+    reference = annotate (model, false);
+    small = annotate (model, true);
+    gOut (0) << "Annotation flows: " << (small == reference ? "same" : "different")
+	     << " as MaximumFlowGraph" << endl;
+  }
+
+  return identical == networks ? EXIT_SUCCESS : EXIT_FAILURE;
+}
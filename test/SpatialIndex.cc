@@ -0,0 +1,211 @@
+//                              -*- Mode: C++ -*-
+// SpatialIndex.cc
+// Copyright © 2011 Laboratoire d'ingénierie des ARN
+//                  Université de Montréal.
+//
+// This file is part of mccore.
+//
+// mccore is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// mccore is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with mccore; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// cmake generated defines
+#include <config.h>
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "Atom.h"
+#include "AtomType.h"
+#include "GraphModel.h"
+#include "HomogeneousTransfo.h"
+#include "Messagestream.h"
+#include "Pdbstream.h"
+#include "SpatialIndex.h"
+#include "Exception.h"
+
+using namespace mccore;
+using namespace std;
+
+
+
+/**
+ * Compares the index queries around a few points with a scan of every
+ * atom of the model.
+ * @return the number of queries whose answers differ.
+ */
+static unsigned int
+compare (const GraphModel &model, const SpatialIndex &index)
+{
+  GraphModel::const_iterator qIt;
+  unsigned int mismatches = 0;
+  unsigned int n;
+
+  for (qIt = model.begin (), n = 0; model.end () != qIt; ++qIt, ++n)
+    {
+      if (0 != n % 7 || qIt->empty ())
+	continue;
+
+      Vector3D p = *qIt->begin () + Vector3D (n % 5 - 2.0, 1.5, n % 3 - 1.0);
+      float radius = 2.0 + n % 8;
+      unsigned int k = 1 + n % 20;
+      vector< const Atom* > scanned;
+      vector< const Residue* > scannedRes;
+      vector< float > d2;
+      vector< SpatialIndex::AtomRef > atoms;
+      vector< SpatialIndex::AtomRef >::iterator aIt;
+      vector< const Atom* > found;
+      vector< const Residue* > foundRes;
+      vector< SpatialIndex::AtomRef > nearest;
+      GraphModel::const_iterator rIt;
+      unsigned int i;
+
+      for (rIt = model.begin (); model.end () != rIt; ++rIt)
+	{
+	  Residue::const_iterator it;
+	  bool inside = false;
+
+	  for (it = rIt->begin (); rIt->end () != it; ++it)
+	    if (! it->getType ()->isPseudo () && ! it->getType ()->isLonePair ())
+	      {
+		d2.push_back (it->squareDistance (p));
+		if (d2.back () <= radius * radius)
+		  {
+		    scanned.push_back (&*it);
+		    inside = true;
+		  }
+	      }
+	  if (inside)
+	    scannedRes.push_back (&*rIt);
+	}
+      sort (scanned.begin (), scanned.end ());
+      sort (d2.begin (), d2.end ());
+
+      index.findAtoms (p, radius, atoms);
+      for (aIt = atoms.begin (); atoms.end () != aIt; ++aIt)
+	found.push_back (aIt->second);
+      sort (found.begin (), found.end ());
+      index.findResidues (p, radius, foundRes);
+      index.findNearest (p, k, nearest);
+
+      if (found != scanned || foundRes != scannedRes || k != nearest.size ())
+	++mismatches;
+      else
+	for (i = 0; i < k; ++i)
+	  if (nearest[i].second->squareDistance (p) != d2[i])
+	    {
+	      ++mismatches;
+	      break;
+	    }
+    }
+  return mismatches;
+}
+
+
+
+int
+main (int argc, char *argv[])
+{
+  GraphModel model;
+  GraphModel::iterator it;
+  unsigned int n;
+
+  try
+    {
+      izfPdbstream ifs;
+
+      ifs.open ("1L8V.pdb.gz");
+
+      if (! ifs)
+	{
+	  IntLibException ex ("failed to open \"1L8V.pdb.gz\"", __FILE__, __LINE__);
+	  throw ex;
+	}
+
+      ifs >> model;
+      ifs.close ();
+    }
+  catch (Exception& ex)
+    {
+      gErr (0) << argv[0] << ": " << ex << endl;
+      return EXIT_FAILURE;
+    }
+
+  SpatialIndex index (model);
+
+  gOut (0) << "Atoms: " << index.size ()
+	   << " Residues: " << index.residueSize () << endl;
+  gOut (0) << "built: " << compare (model, index) << " mismatches" << endl;
+
+  // -- moved residues are refitted in place
+  HomogeneousTransfo tfo = (HomogeneousTransfo::translation (3.0, -2.0, 1.0)
+			    * HomogeneousTransfo::rotation (Vector3D (0, 1, 1), 0.7));
+
+  for (it = model.begin (), n = 0; model.end () != it; ++it, ++n)
+    if (0 == n % 3)
+      {
+	it->transform (tfo);
+	index.refit (*it);
+      }
+  gOut (0) << "refitted: " << compare (model, index) << " mismatches" << endl;
+
+  // -- a residue that lost an atom, in its middle or its last indexed
+  //    one, is rejected and the index kept
+  Residue &res = *model.begin ();
+  Residue copy (res);
+  Residue::const_iterator cIt;
+  unsigned int lost[2] = { res.size () / 2, 0 };
+
+  for (cIt = copy.begin (), n = 0; copy.end () != cIt; ++cIt, ++n)
+    if (! cIt->getType ()->isPseudo () && ! cIt->getType ()->isLonePair ())
+      lost[1] = n;
+
+  for (n = 0; n < 2; ++n)
+    {
+      Residue::iterator aIt = res.begin ();
+      unsigned int i;
+
+      for (i = 0; i < lost[n]; ++i)
+	++aIt;
+      res.transform (tfo);
+      res.erase (aIt);
+      try
+	{
+	  index.refit (res);
+	  gOut (0) << "shrunk residue refitted" << endl;
+	}
+      catch (IntLibException &ex)
+	{
+	  gOut (0) << "shrunk residue rejected" << endl;
+	}
+      res = copy;
+      gOut (0) << "after rejection: " << compare (model, index) << " mismatches" << endl;
+    }
+
+  try
+    {
+      Residue other (res);
+
+      index.refit (other);
+      gOut (0) << "unknown residue refitted" << endl;
+    }
+  catch (NoSuchElementException &ex)
+    {
+      gOut (0) << "unknown residue rejected" << endl;
+    }
+
+  return EXIT_SUCCESS;
+}